@@ -0,0 +1,131 @@
+#ifndef _ALL_VS_ALL_HPP_
+#define _ALL_VS_ALL_HPP_
+
+#include "signature_comparison.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+// tile size such that the two blocks of signatures of a tile fit into 256 kB, which is a typical L2 cache size
+template<typename T>
+uint64_t getDefaultTileSize(uint32_t m) {
+    return std::max(UINT64_C(4), (UINT64_C(256) << 10) / (2 * static_cast<uint64_t>(m) * sizeof(T)));
+}
+
+// All-vs-all comparison of n signatures of size m stored contiguously (signature i starts at signatures + i * m).
+// The upper triangle of the n x n matrix is divided into tiles of tileSize x tileSize signature pairs. As both
+// blocks of signatures of a tile fit into the cache, every signature is loaded from memory only once per tile.
+// The tiles are distributed dynamically over the threads, hence threads that finish early take over remaining tiles.
+// Within a tile, every signature of the row block is compared with the column block using the one-to-many kernel.
+//
+// For every row i and tile the consumer is called as consumer(i, jBegin, jEnd, counts), where counts[j - jBegin] is the
+// number of equal components of the signatures i and j, for i < jBegin <= j < jEnd. The consumer is called concurrently
+// from different threads.
+template<typename T, typename C>
+void computeAllVsAll(const T* signatures, uint64_t n, uint32_t m, C&& consumer, uint64_t tileSize = 0) {
+    if (n < 2) return;
+    if (tileSize == 0) tileSize = getDefaultTileSize<T>(m);
+    const uint64_t numBlocks = (n + tileSize - 1) / tileSize;
+    std::vector<std::pair<uint64_t, uint64_t>> tiles;
+    for(uint64_t bi = 0; bi < numBlocks; ++bi) {
+        for(uint64_t bj = bi; bj < numBlocks; ++bj) tiles.emplace_back(bi, bj);
+    }
+    const int64_t numTiles = tiles.size();
+    OMP_PRAGMA(omp parallel)
+    {
+        std::vector<uint32_t> counts(tileSize);
+        OMP_PRAGMA(omp for schedule(dynamic, 1))
+        for(int64_t t = 0; t < numTiles; ++t) {
+            const uint64_t iBegin = tiles[t].first * tileSize;
+            const uint64_t iEnd = std::min(iBegin + tileSize, n);
+            const uint64_t jBegin = tiles[t].second * tileSize;
+            const uint64_t jEnd = std::min(jBegin + tileSize, n);
+            for(uint64_t i = iBegin; i < iEnd; ++i) {
+                const uint64_t jFirst = std::max(jBegin, i + 1);
+                if (jFirst >= jEnd) continue;
+                countEqualComponentsOneToMany(signatures + i * m, signatures + jFirst * m, jEnd - jFirst, m, counts.data());
+                consumer(i, jFirst, jEnd, counts.data());
+            }
+        }
+    }
+}
+
+// Index of the pair (i, j) with j < i in the lower triangle of a matrix in row-major order, row i consists of the
+// pairs with j = 0, ..., i - 1. Unlike the condensed upper triangle, the index does not depend on the number of rows.
+inline uint64_t getLowerTriangleIndex(uint64_t i, uint64_t j) {
+    assert(j < i);
+    return i * (i - 1) / 2 + j;
+}
+
+// All-vs-all comparison as computeAllVsAll, but the lower triangle is produced in blocks of tileSize consecutive rows
+// in ascending order, such that the result can be streamed to a file without keeping the matrix in memory. The tiles
+// (bi, bj) with bj <= bi of a row block are distributed dynamically over the threads. Then consumer(iBegin, iEnd, counts)
+// is called from the calling thread, where row i of the block, the numbers of equal components of signature i and the
+// signatures j = 0, ..., i - 1, starts at counts + getLowerTriangleIndex(i, 0) - getLowerTriangleIndex(iBegin, 0)
+// (with row 0 being empty). The buffer holds about tileSize * n counts and is reused for the next block.
+template<typename T, typename C>
+void computeAllVsAllRowBlocks(const T* signatures, uint64_t n, uint32_t m, C&& consumer, uint64_t tileSize = 0) {
+    if (n == 0) return;
+    if (tileSize == 0) tileSize = getDefaultTileSize<T>(m);
+    std::vector<uint32_t> counts;
+    for(uint64_t iBegin = 0; iBegin < n; iBegin += tileSize) {
+        const uint64_t iEnd = std::min(iBegin + tileSize, n);
+        const uint64_t offset = iBegin * (iBegin - 1) / 2;
+        counts.resize(iEnd * (iEnd - 1) / 2 - offset);
+        const int64_t numTiles = (iEnd + tileSize - 1) / tileSize;
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for(int64_t t = 0; t < numTiles; ++t) {
+            const uint64_t jBegin = t * tileSize;
+            for(uint64_t i = std::max(iBegin, jBegin + 1); i < iEnd; ++i) {
+                const uint64_t jEnd = std::min(jBegin + tileSize, i);
+                countEqualComponentsOneToMany(signatures + i * m, signatures + jBegin * m, jEnd - jBegin, m, counts.data() + getLowerTriangleIndex(i, jBegin) - offset);
+            }
+        }
+        consumer(iBegin, iEnd, static_cast<const uint32_t*>(counts.data()));
+    }
+}
+
+// Position of the first pair (i, i + 1) of row i in the condensed upper triangle of an n x n matrix in row-major order,
+// for i = n the number of pairs n(n-1)/2.
+inline uint64_t getCondensedRowOffset(uint64_t i, uint64_t n) {
+    assert(i <= n);
+    return i * n - (i * (i + 1)) / 2;
+}
+
+// Index of the pair (i, j) with i < j in the condensed upper triangle of an n x n matrix in row-major order.
+inline uint64_t getCondensedIndex(uint64_t i, uint64_t j, uint64_t n) {
+    assert(i < j && j < n);
+    return getCondensedRowOffset(i, n) + (j - i - 1);
+}
+
+// All-vs-all comparison as computeAllVsAllRowBlocks, but for the condensed upper triangle, i.e. row i consists of the
+// pairs with j = i + 1, ..., n - 1. The tiles (bi, bj) with bj >= bi of a row block are distributed dynamically over the
+// threads, then consumer(iBegin, iEnd, counts) is called from the calling thread, where the counts of row i start at
+// counts + getCondensedRowOffset(i, n) - getCondensedRowOffset(iBegin, n). The buffer holds about tileSize * n counts.
+template<typename T, typename C>
+void computeAllVsAllCondensedRowBlocks(const T* signatures, uint64_t n, uint32_t m, C&& consumer, uint64_t tileSize = 0) {
+    if (n == 0) return;
+    if (tileSize == 0) tileSize = getDefaultTileSize<T>(m);
+    std::vector<uint32_t> counts;
+    for(uint64_t iBegin = 0; iBegin < n; iBegin += tileSize) {
+        const uint64_t iEnd = std::min(iBegin + tileSize, n);
+        const uint64_t offset = getCondensedRowOffset(iBegin, n);
+        counts.resize(getCondensedRowOffset(iEnd, n) - offset);
+        const int64_t numTiles = (n - iBegin + tileSize - 1) / tileSize;
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for(int64_t t = 0; t < numTiles; ++t) {
+            const uint64_t jBegin = iBegin + t * tileSize;
+            const uint64_t jEnd = std::min(jBegin + tileSize, n);
+            for(uint64_t i = iBegin; i < iEnd && i + 1 < jEnd; ++i) {
+                const uint64_t jFirst = std::max(jBegin, i + 1);
+                countEqualComponentsOneToMany(signatures + i * m, signatures + jFirst * m, jEnd - jFirst, m, counts.data() + getCondensedIndex(i, jFirst, n) - offset);
+            }
+        }
+        consumer(iBegin, iEnd, static_cast<const uint32_t*>(counts.data()));
+    }
+}
+
+#endif // _ALL_VS_ALL_HPP_
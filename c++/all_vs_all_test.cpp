@@ -0,0 +1,130 @@
+#include "all_vs_all.hpp"
+#include "distance_writer.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+// Checks the tiled all-vs-all comparison, the row blocks of the lower and the condensed upper triangle, and the binary
+// condensed matrix output against a naive double loop, and reports the throughput in pairs per second for different tile sizes.
+
+int main(int argc, char* argv[]) {
+
+    mt19937_64 rng(UINT64_C(0x6b0d93e2f15a47c8));
+
+    const uint64_t n = 1001;
+    const uint32_t m = 100;
+    vector<uint64_t> signatures(n * m);
+    for(auto& x : signatures) x = rng() & 0x3;
+
+    vector<uint32_t> expected(n * (n - 1) / 2);
+    for(uint64_t i = 0; i < n; ++i) {
+        for(uint64_t j = i + 1; j < n; ++j) {
+            uint32_t count = 0;
+            for(uint32_t k = 0; k < m; ++k) if (signatures[i * m + k] == signatures[j * m + k]) count += 1;
+            expected[getCondensedIndex(i, j, n)] = count;
+        }
+    }
+
+    for(uint64_t tileSize : {0, 1, 7, 64, 1001, 5000}) {
+        vector<uint32_t> result(n * (n - 1) / 2, UINT32_MAX);
+        computeAllVsAll(signatures.data(), n, m, [&](uint64_t i, uint64_t jBegin, uint64_t jEnd, const uint32_t* counts) {
+            assert(i < jBegin && jBegin < jEnd && jEnd <= n);
+            for(uint64_t j = jBegin; j < jEnd; ++j) {
+                uint32_t& r = result[getCondensedIndex(i, j, n)];
+                assert(r == UINT32_MAX); // every pair exactly once
+                r = counts[j - jBegin];
+            }
+        }, tileSize);
+        assert(result == expected);
+    }
+
+    // lower triangle in row blocks
+    for(uint64_t tileSize : {0, 1, 7, 64, 1001, 5000}) {
+        vector<uint32_t> result(n * (n - 1) / 2, UINT32_MAX);
+        uint64_t nextRow = 0;
+        computeAllVsAllRowBlocks(signatures.data(), n, m, [&](uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+            assert(iBegin == nextRow && iBegin < iEnd && iEnd <= n);
+            nextRow = iEnd;
+            for(uint64_t i = iBegin; i < iEnd; ++i) {
+                for(uint64_t j = 0; j < i; ++j) result[getCondensedIndex(j, i, n)] = counts[getLowerTriangleIndex(i, j) - iBegin * (iBegin - 1) / 2];
+            }
+        }, tileSize);
+        assert(nextRow == n);
+        assert(result == expected);
+    }
+
+    // condensed upper triangle in row blocks
+    for(uint64_t tileSize : {0, 1, 7, 64, 1001, 5000}) {
+        vector<uint32_t> result;
+        uint64_t nextRow = 0;
+        computeAllVsAllCondensedRowBlocks(signatures.data(), n, m, [&](uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+            assert(iBegin == nextRow && iBegin < iEnd && iEnd <= n);
+            nextRow = iEnd;
+            result.insert(result.end(), counts, counts + (getCondensedRowOffset(iEnd, n) - getCondensedRowOffset(iBegin, n)));
+        }, tileSize);
+        assert(nextRow == n);
+        assert(result == expected);
+    }
+
+    // binary output
+    const string fileName = (argc > 1) ? string(argv[1]) : string("all_vs_all_test.bin");
+    for(uint64_t tileSize : {1, 64, 5000}) {
+        {
+            CondensedMatrixWriter writer(fileName, n, m);
+            computeAllVsAllCondensedRowBlocks(signatures.data(), n, m, writer, tileSize);
+            assert(writer.finish());
+        }
+        {
+            ifstream in(fileName, ios::binary);
+            char magic[8];
+            uint64_t fileN;
+            uint32_t fileM;
+            in.read(magic, 8);
+            in.read(reinterpret_cast<char*>(&fileN), sizeof(uint64_t));
+            in.read(reinterpret_cast<char*>(&fileM), sizeof(uint32_t));
+            assert(string(magic, 8) == "PMHMAT01" && fileN == n && fileM == m);
+            vector<uint16_t> values(n * (n - 1) / 2);
+            in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(uint16_t));
+            assert(in.good());
+            assert(equal(values.begin(), values.end(), expected.begin()));
+            assert(in.peek() == EOF);
+        }
+    }
+    remove(fileName.c_str());
+
+    // throughput
+#ifdef _OPENMP
+    cout << "threads = " << omp_get_max_threads() << endl;
+#endif
+    for(uint32_t benchmarkM : {128, 1024}) {
+        const uint64_t benchmarkN = (benchmarkM == 128) ? 8000 : 3000;
+        vector<uint64_t> benchmarkSignatures(benchmarkN * benchmarkM);
+        for(auto& x : benchmarkSignatures) x = rng() & 0xF;
+        for(uint64_t tileSize : {benchmarkN, getDefaultTileSize<uint64_t>(benchmarkM)}) {
+            uint64_t checksum = 0;
+            auto start = chrono::steady_clock::now();
+            computeAllVsAll(benchmarkSignatures.data(), benchmarkN, benchmarkM, [&](uint64_t i, uint64_t jBegin, uint64_t jEnd, const uint32_t* counts) {
+                uint64_t sum = 0;
+                for(uint64_t j = jBegin; j < jEnd; ++j) sum += counts[j - jBegin];
+                OMP_PRAGMA(omp atomic)
+                checksum += sum;
+            }, tileSize);
+            auto end = chrono::steady_clock::now();
+            const double numPairs = static_cast<double>(benchmarkN) * (benchmarkN - 1) / 2;
+            cout << "n = " << benchmarkN << ", m = " << benchmarkM << ", tile size = " << tileSize;
+            cout << ", pairs/s = " << numPairs / chrono::duration<double>(end - start).count() << " (checksum = " << checksum << ")" << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef _BATCH_QUERY_HPP_
+#define _BATCH_QUERY_HPP_
+
+#include "all_vs_all.hpp"
+#include "signature_comparison.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+struct BatchQueryHit {
+    uint64_t id;
+    uint32_t count; // number of equal components
+};
+
+namespace batch_query {
+
+// true if a is a better hit than b, more equal components or the same number and a smaller id
+inline bool isBetter(const BatchQueryHit& a, const BatchQueryHit& b) {
+    return a.count > b.count || (a.count == b.count && a.id < b.id);
+}
+
+// Top-k hits of one query as binary heap with the worst hit at the front. Once the heap is full, a new hit is
+// only compared with the front, hence most signatures are rejected by a single comparison. At most capacity hits are
+// reserved up front, such that a huge k does not allocate more than the number of signatures that can be added.
+class TopK {
+    std::vector<BatchQueryHit> heap;
+    uint64_t k;
+
+public:
+    TopK(uint64_t k, uint64_t capacity) : k(k) {
+        heap.reserve(std::min(k, capacity));
+    }
+
+    void add(uint64_t id, uint32_t count) {
+        const BatchQueryHit hit{id, count};
+        if (heap.size() < k) {
+            heap.push_back(hit);
+            std::push_heap(heap.begin(), heap.end(), isBetter);
+        }
+        else if (k > 0 && isBetter(hit, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), isBetter);
+            heap.back() = hit;
+            std::push_heap(heap.begin(), heap.end(), isBetter);
+        }
+    }
+
+    void merge(const TopK& other) {
+        for (const auto& hit : other.heap) add(hit.id, hit.count);
+    }
+
+    // returns the hits ordered by decreasing count and increasing id
+    std::vector<BatchQueryHit> getHits() const {
+        std::vector<BatchQueryHit> hits(heap);
+        std::sort(hits.begin(), hits.end(), isBetter);
+        return hits;
+    }
+};
+
+} // namespace batch_query
+
+// Returns for each of the numQueries queries the at most k of the n signatures with the most equal components, at least
+// minCount, ordered by decreasing count and increasing id. Queries and signatures of size m are stored contiguously.
+// k may exceed n, e.g. if it comes from a client, then all hits with at least minCount equal components are returned.
+//
+// Scanning the signatures once per query reads the whole database from memory for every query. Instead, the signatures
+// are processed in blocks of blockSize signatures that fit into the cache, and all queries are compared with a block
+// before moving on to the next block. Hence, every signature is loaded from memory only once per batch, and the traffic
+// drops by the number of queries, while the queries are read from the cache again for every block. This requires the
+// batch of queries to fit into the last-level cache, e.g. hundreds of queries with m = 1024, larger batches should be
+// split by the caller. The blocks are distributed dynamically over the threads, every thread keeps its own top-k
+// heaps, which are merged at the end.
+template<typename T>
+std::vector<std::vector<BatchQueryHit>> computeBatchTopK(const T* queries, uint64_t numQueries, const T* signatures, uint64_t n, uint32_t m,
+        uint64_t k, uint32_t minCount = 0, uint64_t blockSize = 0) {
+    if (blockSize == 0) blockSize = getDefaultTileSize<T>(m);
+    const int64_t numBlocks = (n + blockSize - 1) / blockSize;
+    std::vector<batch_query::TopK> topK(numQueries, batch_query::TopK(k, n));
+    OMP_PRAGMA(omp parallel)
+    {
+        std::vector<batch_query::TopK> threadTopK(numQueries, batch_query::TopK(k, n));
+        std::vector<uint32_t> counts(blockSize);
+        OMP_PRAGMA(omp for schedule(dynamic, 1) nowait)
+        for (int64_t b = 0; b < numBlocks; ++b) {
+            const uint64_t begin = b * blockSize;
+            const uint64_t end = std::min(begin + blockSize, n);
+            for (uint64_t q = 0; q < numQueries; ++q) {
+                countEqualComponentsOneToMany(queries + q * m, signatures + begin * m, end - begin, m, counts.data());
+                for (uint64_t j = begin; j < end; ++j) {
+                    if (counts[j - begin] >= minCount) threadTopK[q].add(j, counts[j - begin]);
+                }
+            }
+        }
+        OMP_PRAGMA(omp critical)
+        for (uint64_t q = 0; q < numQueries; ++q) topK[q].merge(threadTopK[q]);
+    }
+    std::vector<std::vector<BatchQueryHit>> hits(numQueries);
+    for (uint64_t q = 0; q < numQueries; ++q) hits[q] = topK[q].getHits();
+    return hits;
+}
+
+#endif // _BATCH_QUERY_HPP_
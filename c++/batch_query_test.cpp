@@ -0,0 +1,91 @@
+#include "batch_query.hpp"
+#include "signature_comparison.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+// Checks the batched top-k queries against a naive comparison of every query with all signatures, and compares the
+// time with scanning the database once per query for a database that does not fit into the cache.
+
+// top-k of one query by sorting all signatures
+vector<BatchQueryHit> getNaiveTopK(const uint64_t* query, const vector<uint64_t>& signatures, uint64_t n, uint32_t m, uint64_t k, uint32_t minCount) {
+    vector<BatchQueryHit> hits;
+    for(uint64_t j = 0; j < n; ++j) {
+        const uint32_t count = countEqualComponents(query, signatures.data() + j * m, m);
+        if (count >= minCount) hits.push_back(BatchQueryHit{j, count});
+    }
+    sort(hits.begin(), hits.end(), batch_query::isBetter);
+    if (hits.size() > k) hits.resize(k);
+    return hits;
+}
+
+// top-k of one query by a scan of all signatures
+vector<BatchQueryHit> scanTopK(const uint64_t* query, const vector<uint64_t>& signatures, uint64_t n, uint32_t m, uint64_t k, vector<uint32_t>& counts) {
+    countEqualComponentsOneToMany(query, signatures.data(), n, m, counts.data());
+    batch_query::TopK topK(k, n);
+    for(uint64_t j = 0; j < n; ++j) topK.add(j, counts[j]);
+    return topK.getHits();
+}
+
+int main() {
+
+    mt19937_64 rng(UINT64_C(0x5d0e3a8c71f2b946));
+
+    for(uint64_t n : {0, 1, 5, 100, 1000}) {
+        for(uint32_t m : {1, 7, 64}) {
+            // small alphabet such that there are many ties
+            vector<uint64_t> signatures(n * m);
+            for(auto& x : signatures) x = rng() % 3;
+            const uint64_t numQueries = 13;
+            vector<uint64_t> queries(numQueries * m);
+            for(auto& x : queries) x = rng() % 3;
+            for(uint64_t k : {0, 1, 10, 2000}) {
+                for(uint32_t minCount : {UINT32_C(0), UINT32_C(1), m / 2}) {
+                    for(uint64_t blockSize : {0, 1, 3, 64}) {
+                        const auto hits = computeBatchTopK(queries.data(), numQueries, signatures.data(), n, m, k, minCount, blockSize);
+                        assert(hits.size() == numQueries);
+                        for(uint64_t q = 0; q < numQueries; ++q) {
+                            const auto expected = getNaiveTopK(queries.data() + q * m, signatures, n, m, k, minCount);
+                            assert(hits[q].size() == expected.size());
+                            for(uint64_t h = 0; h < expected.size(); ++h) assert(hits[q][h].id == expected[h].id && hits[q][h].count == expected[h].count);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // time of batched queries compared to one scan per query, the database of 160 MB does not fit into the cache
+    {
+        const uint64_t n = 20000;
+        const uint32_t m = 1024;
+        const uint64_t k = 10;
+        const uint64_t numQueries = 64;
+        vector<uint64_t> signatures(n * m);
+        for(auto& x : signatures) x = rng() % 4;
+        vector<uint64_t> queries(signatures.begin(), signatures.begin() + numQueries * m);
+
+        auto start = chrono::steady_clock::now();
+        vector<uint32_t> counts(n);
+        uint64_t checksumScan = 0;
+        for(uint64_t q = 0; q < numQueries; ++q) {
+            for(const auto& hit : scanTopK(queries.data() + q * m, signatures, n, m, k, counts)) checksumScan += hit.id * hit.count;
+        }
+        auto scanned = chrono::steady_clock::now();
+        const auto hits = computeBatchTopK(queries.data(), numQueries, signatures.data(), n, m, k);
+        auto end = chrono::steady_clock::now();
+        uint64_t checksumBatch = 0;
+        for(const auto& queryHits : hits) for(const auto& hit : queryHits) checksumBatch += hit.id * hit.count;
+        assert(checksumScan == checksumBatch);
+        cout << "n = " << n << ", m = " << m << ", queries = " << numQueries << ", scan per query = " << chrono::duration<double>(scanned - start).count() << " s";
+        cout << ", batched = " << chrono::duration<double>(end - scanned).count() << " s (checksum = " << checksumBatch << ")" << endl;
+    }
+
+    return 0;
+}
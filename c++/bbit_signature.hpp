@@ -0,0 +1,145 @@
+#ifndef _BBIT_SIGNATURE_HPP_
+#define _BBIT_SIGNATURE_HPP_
+
+#include "wyhash/wyhash.h"
+#include "signature_comparison.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+// b-bit minwise signatures as described in
+// Ping Li and Arnd Christian König. 2010. b-Bit Minwise Hashing. In Proc. 19th International Conference on World Wide Web. 671–680
+// https://doi.org/10.1145/1772690.1772759
+//
+// Every component of a signature computed by any of the algorithms in minhash.hpp is hashed and only the lowest b bits
+// are kept, b in {1, 2, 4, 8, 16}. As b divides 64, the components are packed into 64-bit words without crossing word
+// boundaries, component i occupies the bits [b * (i % (64 / b)), b * (i % (64 / b) + 1)) of word i / (64 / b).
+// Two components are equal if the Jaccard sample collides or, with probability 2^-b, by chance, which is
+// corrected by the estimator.
+class BBitSignature {
+    uint32_t b;
+    uint32_t m;
+    std::vector<uint64_t> words;
+
+    static uint32_t getComponentsPerWord(uint32_t b) {
+        return 64 / b;
+    }
+
+public:
+
+    static bool isValidNumBits(uint32_t b) {
+        return b == 1 || b == 2 || b == 4 || b == 8 || b == 16;
+    }
+
+    // the seed must be the same for all signatures that are compared
+    template<typename D>
+    BBitSignature(const std::vector<D>& signature, uint32_t b, uint64_t seed = UINT64_C(0x4f2b8e6d13a7c095)) :
+            b(b), m(signature.size()), words((signature.size() + getComponentsPerWord(b) - 1) / getComponentsPerWord(b), 0) {
+        assert(isValidNumBits(b));
+        const uint64_t mask = (UINT64_C(1) << b) - 1;
+        const uint32_t componentsPerWord = getComponentsPerWord(b);
+        for(uint32_t i = 0; i < m; ++i) {
+            const uint64_t bits = wyhash64(static_cast<uint64_t>(signature[i]), seed) & mask;
+            words[i / componentsPerWord] |= bits << (b * (i % componentsPerWord));
+        }
+    }
+
+    BBitSignature() : b(1), m(0) {}
+
+    uint32_t getNumBits() const {
+        return b;
+    }
+
+    uint32_t size() const {
+        return m;
+    }
+
+    uint64_t getComponent(uint32_t i) const {
+        assert(i < m);
+        const uint32_t componentsPerWord = getComponentsPerWord(b);
+        return (words[i / componentsPerWord] >> (b * (i % componentsPerWord))) & ((UINT64_C(1) << b) - 1);
+    }
+
+    const std::vector<uint64_t>& getWords() const {
+        return words;
+    }
+
+    uint64_t getSizeInBytes() const {
+        return words.size() * sizeof(uint64_t);
+    }
+};
+
+// Reduces the XOR of two words to one bit per component, which is set if the components differ.
+template<uint32_t B>
+inline uint64_t getDifferentComponentBits(uint64_t x) {
+    if constexpr(B == 1) {
+        return x;
+    }
+    else if constexpr(B == 2) {
+        return (x | (x >> 1)) & UINT64_C(0x5555555555555555);
+    }
+    else if constexpr(B == 4) {
+        x |= x >> 1;
+        x |= x >> 2;
+        return x & UINT64_C(0x1111111111111111);
+    }
+    else if constexpr(B == 8) {
+        x |= x >> 1;
+        x |= x >> 2;
+        x |= x >> 4;
+        return x & UINT64_C(0x0101010101010101);
+    }
+    else {
+        static_assert(B == 16, "Require B to be 1, 2, 4, 8, or 16!");
+        x |= x >> 1;
+        x |= x >> 2;
+        x |= x >> 4;
+        x |= x >> 8;
+        return x & UINT64_C(0x0001000100010001);
+    }
+}
+
+template<uint32_t B>
+inline uint32_t countDifferentComponents(const uint64_t* wordsA, const uint64_t* wordsB, uint64_t numWords) {
+    uint32_t numDifferent = 0;
+    for(uint64_t i = 0; i < numWords; ++i) {
+        numDifferent += __builtin_popcountll(getDifferentComponentBits<B>(wordsA[i] ^ wordsB[i]));
+    }
+    return numDifferent;
+}
+
+// Returns the number of equal b-bit components. The unused bits of the last word are zero in both signatures
+// and therefore never counted as different.
+inline uint32_t countEqualComponents(const BBitSignature& sigA, const BBitSignature& sigB) {
+    assert(sigA.getNumBits() == sigB.getNumBits());
+    assert(sigA.size() == sigB.size());
+    const uint64_t* wordsA = sigA.getWords().data();
+    const uint64_t* wordsB = sigB.getWords().data();
+    const uint64_t numWords = sigA.getWords().size();
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // on little-endian machines the words of 16-bit signatures are arrays of uint16_t, which allows SIMD comparison
+    if (sigA.getNumBits() == 16) return countEqualComponents(reinterpret_cast<const uint16_t*>(wordsA), reinterpret_cast<const uint16_t*>(wordsB), sigA.size());
+#endif
+    uint32_t numDifferent;
+    switch(sigA.getNumBits()) {
+        case 1: numDifferent = countDifferentComponents<1>(wordsA, wordsB, numWords); break;
+        case 2: numDifferent = countDifferentComponents<2>(wordsA, wordsB, numWords); break;
+        case 4: numDifferent = countDifferentComponents<4>(wordsA, wordsB, numWords); break;
+        case 8: numDifferent = countDifferentComponents<8>(wordsA, wordsB, numWords); break;
+        default: numDifferent = countDifferentComponents<16>(wordsA, wordsB, numWords); break;
+    }
+    return sigA.size() - numDifferent;
+}
+
+// Bias-corrected estimator of the Jaccard similarity. The fraction of equal components P satisfies
+// E[P] = J + (1 - J) * 2^-b, as the lowest b bits of the hashed components are uniformly distributed,
+// hence J is estimated by (P - 2^-b) / (1 - 2^-b). The estimate is unbiased but may be slightly negative
+// for dissimilar signatures.
+inline double estimateJaccardBBit(const BBitSignature& sigA, const BBitSignature& sigB) {
+    const double collisionProbability = 1. / static_cast<double>(UINT64_C(1) << sigA.getNumBits());
+    const double p = static_cast<double>(countEqualComponents(sigA, sigB)) / sigA.size();
+    return (p - collisionProbability) / (1. - collisionProbability);
+}
+
+#endif // _BBIT_SIGNATURE_HPP_
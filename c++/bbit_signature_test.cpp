@@ -0,0 +1,131 @@
+#include "bbit_signature.hpp"
+#include "bitstream_random.hpp"
+#include "minhash.hpp"
+#include "data_generation.hpp"
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+using namespace std;
+
+// Checks the packing and the comparison kernels of b-bit signatures against a naive implementation,
+// checks that the bias-corrected estimator is unbiased, and reports the comparison throughput
+// compared to full 64-bit signatures.
+
+struct ExtractFunction {
+    uint64_t operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<0>(d);
+    }
+};
+
+class RNGFunction {
+    const uint64_t seed;
+public:
+
+    RNGFunction(uint64_t seed) : seed(seed) {}
+
+    WyrandBitStream operator()(const uint64_t& x) const {
+        return WyrandBitStream(x, seed);
+    }
+};
+
+struct WeightFunction {
+    double operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<1>(d);
+    }
+};
+
+int main(int argc, char* argv[]) {
+
+    mt19937_64 rng(UINT64_C(0xa7c2e91f5d30b486));
+    const uint64_t seed = UINT64_C(0x4f2b8e6d13a7c095);
+
+    for(uint32_t b : {1, 2, 4, 8, 16}) {
+        for(uint32_t m : {1, 3, 63, 64, 65, 1024, 1031}) {
+            for(double p : {0., 0.3, 0.9, 1.}) {
+                vector<uint64_t> sigA(m);
+                vector<uint64_t> sigB(m);
+                for(uint32_t i = 0; i < m; ++i) {
+                    sigA[i] = rng();
+                    sigB[i] = (uniform_real_distribution<double>(0., 1.)(rng) < p) ? sigA[i] : rng();
+                }
+                const BBitSignature bbitA(sigA, b, seed);
+                const BBitSignature bbitB(sigB, b, seed);
+                assert(bbitA.size() == m);
+                assert(bbitA.getSizeInBytes() == ((m * b + 63) / 64) * 8);
+
+                uint32_t numEqual = 0;
+                for(uint32_t i = 0; i < m; ++i) {
+                    const uint64_t componentA = wyhash64(sigA[i], seed) & ((UINT64_C(1) << b) - 1);
+                    const uint64_t componentB = wyhash64(sigB[i], seed) & ((UINT64_C(1) << b) - 1);
+                    assert(bbitA.getComponent(i) == componentA);
+                    assert(bbitB.getComponent(i) == componentB);
+                    if (componentA == componentB) numEqual += 1;
+                }
+                assert(countEqualComponents(bbitA, bbitB) == numEqual);
+                assert(countEqualComponents(bbitA, bbitA) == m);
+            }
+        }
+    }
+
+    // mean of the bias-corrected estimates must match the true Jaccard similarity
+    const uint32_t m = 1024;
+    const uint64_t numIterations = 500;
+    const Weights w = getWeightsCase_0a92d95c38b0bec5();
+    ProbMinHash2<uint64_t, ExtractFunction, RNGFunction, WeightFunction> h(m, ExtractFunction(), RNGFunction(UINT64_C(0x930bb771b6666420)));
+    vector<double> sumEstimates(5);
+    vector<double> sumSquaredEstimates(5);
+    double sumFullEstimates = 0;
+    for(uint64_t i = 0; i < numIterations; ++i) {
+        const auto data = generateData(rng, w);
+        const vector<uint64_t> sigA = h(get<0>(data));
+        const vector<uint64_t> sigB = h(get<1>(data));
+        uint32_t numEqual = 0;
+        for(uint32_t j = 0; j < m; ++j) if (sigA[j] == sigB[j]) numEqual += 1;
+        sumFullEstimates += static_cast<double>(numEqual) / m;
+        uint32_t k = 0;
+        for(uint32_t b : {1, 2, 4, 8, 16}) {
+            const double estimate = estimateJaccardBBit(BBitSignature(sigA, b, seed ^ i), BBitSignature(sigB, b, seed ^ i));
+            sumEstimates[k] += estimate;
+            sumSquaredEstimates[k] += estimate * estimate;
+            k += 1;
+        }
+    }
+    cout << "case = " << w.getId() << ", Jp = " << w.getJp() << ", m = " << m << ", mean estimate 64 bits = " << sumFullEstimates / numIterations << endl;
+    uint32_t k = 0;
+    for(uint32_t b : {1, 2, 4, 8, 16}) {
+        const double mean = sumEstimates[k] / numIterations;
+        const double variance = sumSquaredEstimates[k] / numIterations - mean * mean;
+        cout << "b = " << b << ", mean estimate = " << mean << ", variance = " << variance << endl;
+        assert(abs(mean - w.getJp()) <= 5 * sqrt(variance / numIterations));
+        k += 1;
+    }
+
+    // comparison throughput, one query against many signatures
+    const uint64_t numSignatures = 10000;
+    vector<vector<uint64_t>> signatures(numSignatures, vector<uint64_t>(m));
+    for(auto& s : signatures) for(auto& x : s) x = rng() & 0xFF;
+    uint64_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for(const auto& s : signatures) {
+        uint32_t numEqual = 0;
+        for(uint32_t j = 0; j < m; ++j) if (signatures[0][j] == s[j]) numEqual += 1;
+        checksum += numEqual;
+    }
+    auto end = chrono::steady_clock::now();
+    cout << "b = 64, " << numSignatures * m * 8 / 1024 / 1024 << " MB, ";
+    cout << numSignatures / chrono::duration<double>(end - start).count() << " comparisons/s" << endl;
+    for(uint32_t b : {1, 2, 4, 8, 16}) {
+        vector<BBitSignature> bbitSignatures;
+        for(const auto& s : signatures) bbitSignatures.emplace_back(s, b, seed);
+        start = chrono::steady_clock::now();
+        for(const auto& s : bbitSignatures) checksum += countEqualComponents(bbitSignatures[0], s);
+        end = chrono::steady_clock::now();
+        cout << "b = " << b << ", " << numSignatures * bbitSignatures[0].getSizeInBytes() / 1024 << " kB, ";
+        cout << numSignatures / chrono::duration<double>(end - start).count() << " comparisons/s" << endl;
+    }
+    cout << "checksum = " << checksum << endl;
+
+    return 0;
+}
@@ -8,11 +8,14 @@
 
 #include "wyhash/wyhash.h"
 #include "exponential_distribution.hpp"
+#include "size_policy.hpp"
 
 #include <cmath>
 #include <cassert>
 #include <limits>
 #include <memory>
+#include <algorithm>
+#include <type_traits>
 
 static_assert(std::numeric_limits<double>::is_iec559, "Require std::numeric_limits<double>::is_iec559 to be true!");
 
@@ -222,6 +225,58 @@ public:
     }
 };
 
+// Generates the same bit sequence as WyrandBitStream, but refills 256 bits at once.
+// Except for the rare refill, a draw of numBits bits needs no branches.
+class BufferedWyrandBitStream {
+
+    static constexpr uint32_t numBufferWords = 4;
+    static constexpr uint32_t numBufferBits = numBufferWords * 64;
+
+    uint64_t state;
+    uint64_t buffer[numBufferWords + 1]; // last word is padding and always 0
+    uint32_t position; // number of bits already consumed from the buffer
+
+    // only called if more than 192 bits are consumed, keeps the last word
+    void refill() {
+        buffer[0] = buffer[numBufferWords - 1];
+        for(uint32_t i = 1; i < numBufferWords; ++i) {
+            buffer[i] = wyrand(&state);
+        }
+        position -= numBufferBits - 64;
+    }
+
+public:
+
+    BufferedWyrandBitStream(const BufferedWyrandBitStream& p) = delete;
+    BufferedWyrandBitStream& operator=(const BufferedWyrandBitStream&) = delete;
+    BufferedWyrandBitStream(BufferedWyrandBitStream&& p) = default;
+    BufferedWyrandBitStream& operator=(BufferedWyrandBitStream&&) = default;
+
+    BufferedWyrandBitStream(uint64_t value, uint64_t seed) : state(wyhash64(value, seed)), buffer{0, 0, 0, 0, 0}, position(numBufferBits) {}
+
+    BufferedWyrandBitStream(uint64_t value1, uint64_t value2, uint64_t seed) : buffer{0, 0, 0, 0, 0}, position(numBufferBits) {
+        uint64_t data[2];
+        data[0] = value1;
+        data[1] = value2;
+        state = wyhash(data, 2*sizeof(uint64_t), seed);
+    }
+
+    bool operator()() {
+        return operator()(1);
+    }
+
+    uint64_t operator()(uint8_t numBits) {
+        assert(numBits >= 1);
+        assert(numBits <= 64);
+        if (position + numBits > numBufferBits) refill();
+        const uint32_t wordIdx = position >> 6;
+        const uint32_t offset = position & UINT32_C(0x3F);
+        const uint64_t bits = (buffer[wordIdx] << offset) | (buffer[wordIdx + 1] >> 1 >> (63 - offset));
+        position += numBits;
+        return bits >> (64 - numBits);
+    }
+};
+
 class TruncatedExponentialDistribution {
     double rate;
     double c1; // (exp(r) - 1) / r = expm1(r) / r
@@ -266,22 +321,41 @@ public:
     }
 };
 
+// Index type used by PermutationStream. If the size is fixed and not larger than 65536,
+// 16-bit indices and versions are used, which halves the memory footprint.
+template<typename S>
+using PermutationIndexType = typename std::conditional<(S::fixedValue > 0 && S::fixedValue <= 65536), uint16_t, uint32_t>::type;
+
 // based on Fisher-Yates shuffling
+template<typename S = DynamicSize, typename I = PermutationIndexType<S>>
 class PermutationStream {
+    static_assert(std::is_same<I, uint16_t>::value || std::is_same<I, uint32_t>::value, "Require I to be uint16_t or uint32_t!");
 
-    const uint32_t size;
+    // version in the upper half, permutation index in the lower half
+    typedef typename std::conditional<std::is_same<I, uint16_t>::value, uint32_t, uint64_t>::type EntryType;
+    static constexpr int indexBits = std::numeric_limits<I>::digits;
+
+    const S size;
 	uint32_t idx;
-	uint32_t versionCounter;
+	I versionCounter;
+
+    RegisterArray<EntryType, S::fixedValue> permutationAndVersion;
 
-    const std::unique_ptr<std::pair<uint32_t, uint32_t>[]> permutationAndVersion;
+    // all entries become invalid, as version 0 is never used
+    void bulkReset() {
+        std::fill_n(permutationAndVersion.get(), static_cast<uint32_t>(size), EntryType(0));
+    }
 
 public:
 
-	PermutationStream(uint32_t _size) :
+	PermutationStream(S _size) :
         size(_size), 
         idx(0), 
         versionCounter(0), 
-        permutationAndVersion(new std::pair<uint32_t, uint32_t>[_size]) {}
+        permutationAndVersion(_size) {
+        assert(size - 1 <= std::numeric_limits<I>::max());
+        bulkReset();
+    }
 
 	bool hasNext() const {
 		return idx < size;
@@ -290,11 +364,11 @@ public:
 	template <typename H>
     uint32_t next(H& hashBitStream) {
 		const uint32_t k = idx + getUniformLemire(size - idx, hashBitStream);
-        auto& permutationAndVersionK = permutationAndVersion[k];
-        const auto& permutationAndVersionIdx = permutationAndVersion[idx];
-        const uint32_t result = (permutationAndVersionK.second != versionCounter)?k:permutationAndVersionK.first;
-        const uint32_t x = (permutationAndVersionIdx.second != versionCounter)?idx:permutationAndVersionIdx.first;
-		permutationAndVersionK = std::make_pair(x, versionCounter);
+        EntryType& permutationAndVersionK = permutationAndVersion[k];
+        const EntryType permutationAndVersionIdx = permutationAndVersion[idx];
+        const uint32_t result = (static_cast<I>(permutationAndVersionK >> indexBits) != versionCounter)?k:static_cast<I>(permutationAndVersionK);
+        const uint32_t x = (static_cast<I>(permutationAndVersionIdx >> indexBits) != versionCounter)?idx:static_cast<I>(permutationAndVersionIdx);
+		permutationAndVersionK = (static_cast<EntryType>(versionCounter) << indexBits) | x;
 		idx += 1;
         return result;
 	}
@@ -302,10 +376,11 @@ public:
     // must be called first before iterating over a new permutation using next-method
 	void reset() {
 		idx = 0;
+		versionCounter += 1;
 		if (versionCounter == 0) {
-            std::fill_n(permutationAndVersion.get(), size, std::make_pair(0,0));
+            bulkReset();
+            versionCounter = 1;
 		}
-		versionCounter += 1;
 	}
 };
 
@@ -18,6 +18,8 @@ int main(int argc, char* argv[]) {
 
     WyrandBitStream s1(UINT64_C(0xc2881c5d6c802af7), (0x26a2b296e4474346));
     WyrandBitStream s2(UINT64_C(0xc2881c5d6c802af7), (0x26a2b296e4474346));
+    BufferedWyrandBitStream s3(UINT64_C(0xc2881c5d6c802af7), (0x26a2b296e4474346));
+    BufferedWyrandBitStream s4(UINT64_C(0xc2881c5d6c802af7), (0x26a2b296e4474346));
 
     uint64_t numIterations = 1000000;
 
@@ -31,8 +33,16 @@ int main(int argc, char* argv[]) {
             v2 <<= 1;
             v2 |= s2();
         }
+        uint64_t v3 = s3(numBits);
+        uint64_t v4 = 0;
+        for (uint8_t k = 0; k < numBits; ++k) {
+            v4 <<= 1;
+            v4 |= s4();
+        }
 
         assert(v1 == v2);
+        assert(v1 == v3); // BufferedWyrandBitStream must be bit-exact
+        assert(v1 == v4);
 
     }
     
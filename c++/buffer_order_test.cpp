@@ -0,0 +1,117 @@
+#include "minhash.hpp"
+#include "bitstream_random.hpp"
+
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+// Checks that processing the buffer in ascending order of the hash values (ProbMinHash1b/3b)
+// gives the same signatures as sweeping the whole buffer repeatedly (ProbMinHash1a/3a), and that
+// a signature size fixed at compile time (FixedSize) gives the same signatures as DynamicSize.
+
+struct ExtractFunction {
+    uint64_t operator()(const uint64_t& d) const {
+        return d;
+    }
+    uint64_t operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<0>(d);
+    }
+};
+
+class RNGFunction {
+    const uint64_t seed;
+public:
+
+    RNGFunction(uint64_t seed) : seed(seed) {}
+
+    WyrandBitStream operator()(uint64_t x) const {
+        return WyrandBitStream(x, seed);
+    }
+};
+
+struct WeightFunction {
+    double operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<1>(d);
+    }
+};
+
+template <typename GEN> double generatePareto(GEN& rng, double scale, double shape) {
+    return scale * pow(1. - uniform_real_distribution<double>(0., 1.)(rng), -1. / shape);
+}
+
+// compares the signatures of H with FixedSize<M> and DynamicSize for all sizes supported by dispatchSize
+template<template<typename, typename, typename, typename, typename> typename H, typename W, typename D>
+void checkFixedSize(uint32_t hashSize, const RNGFunction& rngFunction, const D& data) {
+    dispatchSize(hashSize, [&](auto size) {
+        assert(decltype(size)::fixedValue == hashSize);
+        H<uint64_t, ExtractFunction, RNGFunction, W, DynamicSize> dynamicH(hashSize, ExtractFunction(), rngFunction);
+        H<uint64_t, ExtractFunction, RNGFunction, W, decltype(size)> fixedH(size, ExtractFunction(), rngFunction);
+        assert(dynamicH(data) == fixedH(data));
+    });
+}
+
+int main(int argc, char* argv[]) {
+
+    mt19937_64 rng(UINT64_C(0x6c1b0e94d3a27f58));
+    RNGFunction rngFunction(UINT64_C(0xe0a4d7b9152c63f8));
+    exponential_distribution<double> exponentialDistribution(1.);
+
+    for(uint32_t hashSize : {2, 3, 256, 1024}) {
+        for(uint64_t dataSize : {1, 10, 1000, 100000}) {
+            for(uint32_t distribution = 0; distribution < 3; ++distribution) {
+                vector<tuple<uint64_t,double>> weightedData;
+                vector<uint64_t> unweightedData;
+                for(uint64_t i = 0; i < dataSize; ++i) {
+                    double weight;
+                    if (distribution == 0) weight = exponentialDistribution(rng);
+                    else if (distribution == 1) weight = generatePareto(rng, 1, 0.5);
+                    else weight = generatePareto(rng, 1, 2);
+                    weightedData.emplace_back(rng(), weight);
+                    unweightedData.push_back(rng());
+                }
+
+                ProbMinHash1a<uint64_t, ExtractFunction, RNGFunction, WeightFunction> probMinHash1a(hashSize, ExtractFunction(), rngFunction, WeightFunction());
+                ProbMinHash1b<uint64_t, ExtractFunction, RNGFunction, WeightFunction> probMinHash1b(hashSize, ExtractFunction(), rngFunction, WeightFunction());
+                ProbMinHash3a<uint64_t, ExtractFunction, RNGFunction, WeightFunction> probMinHash3a(hashSize, ExtractFunction(), rngFunction, WeightFunction());
+                ProbMinHash3b<uint64_t, ExtractFunction, RNGFunction, WeightFunction> probMinHash3b(hashSize, ExtractFunction(), rngFunction, WeightFunction());
+                assert(probMinHash1a(weightedData) == probMinHash1b(weightedData));
+                assert(probMinHash3a(weightedData) == probMinHash3b(weightedData));
+                assert(probMinHash1a.getMaxBufferSize() == probMinHash1b.getMaxBufferSize());
+                assert(probMinHash3a.getMaxBufferSize() == probMinHash3b.getMaxBufferSize());
+
+                ProbMinHash1a<uint64_t, ExtractFunction, RNGFunction> unweightedProbMinHash1a(hashSize, ExtractFunction(), rngFunction);
+                ProbMinHash1b<uint64_t, ExtractFunction, RNGFunction> unweightedProbMinHash1b(hashSize, ExtractFunction(), rngFunction);
+                ProbMinHash3a<uint64_t, ExtractFunction, RNGFunction> unweightedProbMinHash3a(hashSize, ExtractFunction(), rngFunction);
+                ProbMinHash3b<uint64_t, ExtractFunction, RNGFunction> unweightedProbMinHash3b(hashSize, ExtractFunction(), rngFunction);
+                assert(unweightedProbMinHash1a(unweightedData) == unweightedProbMinHash1b(unweightedData));
+                assert(unweightedProbMinHash3a(unweightedData) == unweightedProbMinHash3b(unweightedData));
+            }
+        }
+    }
+
+    for(uint32_t hashSize : {128, 256, 1024, 4096}) {
+        for(uint64_t dataSize : {1, 10, 1000, 20000}) {
+            vector<tuple<uint64_t,double>> weightedData;
+            vector<uint64_t> unweightedData;
+            for(uint64_t i = 0; i < dataSize; ++i) {
+                weightedData.emplace_back(rng(), generatePareto(rng, 1, 0.5));
+                unweightedData.push_back(rng());
+            }
+            checkFixedSize<ProbMinHash1, WeightFunction>(hashSize, rngFunction, weightedData);
+            checkFixedSize<ProbMinHash1a, WeightFunction>(hashSize, rngFunction, weightedData);
+            checkFixedSize<ProbMinHash2, WeightFunction>(hashSize, rngFunction, weightedData);
+            checkFixedSize<ProbMinHash3, WeightFunction>(hashSize, rngFunction, weightedData);
+            checkFixedSize<ProbMinHash3a, WeightFunction>(hashSize, rngFunction, weightedData);
+            checkFixedSize<ProbMinHash4, WeightFunction>(hashSize, rngFunction, weightedData);
+            checkFixedSize<ProbMinHash1, UnaryWeightFunction>(hashSize, rngFunction, unweightedData);
+            checkFixedSize<ProbMinHash1a, UnaryWeightFunction>(hashSize, rngFunction, unweightedData);
+            checkFixedSize<ProbMinHash2, UnaryWeightFunction>(hashSize, rngFunction, unweightedData);
+            checkFixedSize<ProbMinHash3, UnaryWeightFunction>(hashSize, rngFunction, unweightedData);
+            checkFixedSize<ProbMinHash3a, UnaryWeightFunction>(hashSize, rngFunction, unweightedData);
+            checkFixedSize<ProbMinHash4, UnaryWeightFunction>(hashSize, rngFunction, unweightedData);
+        }
+    }
+
+    return 0;
+}
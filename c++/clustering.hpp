@@ -0,0 +1,121 @@
+#ifndef _CLUSTERING_HPP_
+#define _CLUSTERING_HPP_
+
+#include "signature_comparison.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+// Single-linkage clustering of signatures from the stream of pairs that reach a similarity threshold, e.g. the pairs
+// reported by computeAllVsAll (see all_vs_all.hpp), such that the clusters are the connected components of the graph
+// of similar pairs. Only one parent per signature is stored, the distance matrix is never kept in memory.
+
+// Union-find that can be updated concurrently by many threads without locks. The parents are atomic, a root is always
+// linked below the smaller of both roots by compare-and-swap, which fails and is retried if another thread changed the
+// root in between, and find() shortens the paths by path halving. Since a parent is never larger than its child, no
+// cycles can arise, the root of a set is its smallest element, and the final sets do not depend on the order of unite().
+class ConcurrentUnionFind {
+    uint64_t n;
+    std::unique_ptr<std::atomic<uint64_t>[]> parents;
+
+public:
+
+    explicit ConcurrentUnionFind(uint64_t n) : n(n), parents(new std::atomic<uint64_t>[n]) {
+        for (uint64_t i = 0; i < n; ++i) parents[i].store(i, std::memory_order_relaxed);
+    }
+
+    uint64_t size() const {
+        return n;
+    }
+
+    // returns the smallest element of the set of x
+    uint64_t find(uint64_t x) {
+        while (true) {
+            uint64_t parent = parents[x].load(std::memory_order_acquire);
+            if (parent == x) return x;
+            const uint64_t grandparent = parents[parent].load(std::memory_order_acquire);
+            // path halving, may fail if the parent has changed, which is harmless
+            if (grandparent != parent) parents[x].compare_exchange_weak(parent, grandparent, std::memory_order_acq_rel);
+            x = grandparent;
+        }
+    }
+
+    // merges the sets of a and b, returns false if they were already in the same set
+    bool unite(uint64_t a, uint64_t b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return false;
+            if (a < b) std::swap(a, b);
+            uint64_t expected = a;
+            if (parents[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel)) return true;
+        }
+    }
+
+    // returns the cluster id of every element, clusters are numbered 0, 1, ... in the order of their smallest element,
+    // must not be called concurrently with unite()
+    std::vector<uint64_t> getClusterIds() {
+        std::vector<uint64_t> clusterIds(n);
+        uint64_t numClusters = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            const uint64_t root = find(i);
+            clusterIds[i] = (root == i) ? numClusters++ : clusterIds[root];
+        }
+        return clusterIds;
+    }
+};
+
+// Returns the medoid of every cluster, the member with the largest mean number of equal components with the other
+// members, ties are broken by the smaller id. For clusters with more than maxSampleSize members, the members are
+// compared with an evenly spaced sample of maxSampleSize members instead, which bounds the time to
+// O(n * maxSampleSize * m). The signatures of a sample are copied into a contiguous buffer and compared with
+// countEqualComponentsOneToMany, the members of a large cluster are processed in parallel.
+template<typename T>
+std::vector<uint64_t> computeMedoids(const T* signatures, uint32_t m, const std::vector<uint64_t>& clusterIds, uint64_t maxSampleSize = 1000) {
+    const uint64_t numClusters = clusterIds.empty() ? 0 : *std::max_element(clusterIds.begin(), clusterIds.end()) + 1;
+    std::vector<std::vector<uint64_t>> members(numClusters);
+    for (uint64_t i = 0; i < clusterIds.size(); ++i) members[clusterIds[i]].push_back(i);
+
+    std::vector<uint64_t> medoids(numClusters);
+    std::vector<T> sampleSignatures;
+    std::vector<uint64_t> sample;
+    for (uint64_t c = 0; c < numClusters; ++c) {
+        const std::vector<uint64_t>& clusterMembers = members[c];
+        const int64_t size = clusterMembers.size();
+        medoids[c] = clusterMembers[0];
+        if (size <= 2) continue;
+        const uint64_t sampleSize = std::min<uint64_t>(size, std::max<uint64_t>(maxSampleSize, 2));
+        sample.resize(sampleSize);
+        sampleSignatures.resize(sampleSize * m);
+        for (uint64_t s = 0; s < sampleSize; ++s) {
+            sample[s] = clusterMembers[s * size / sampleSize];
+            std::copy(signatures + sample[s] * m, signatures + (sample[s] + 1) * m, sampleSignatures.begin() + s * m);
+        }
+        std::vector<double> meanCounts(size);
+        OMP_PRAGMA(omp parallel if(size * sampleSize * m > 1000000))
+        {
+            std::vector<uint32_t> counts(sampleSize);
+            OMP_PRAGMA(omp for schedule(static))
+            for (int64_t x = 0; x < size; ++x) {
+                countEqualComponentsOneToMany(signatures + clusterMembers[x] * m, sampleSignatures.data(), sampleSize, m, counts.data());
+                uint64_t sum = 0;
+                uint64_t numCompared = 0;
+                for (uint64_t s = 0; s < sampleSize; ++s) {
+                    if (sample[s] == clusterMembers[x]) continue;
+                    sum += counts[s];
+                    numCompared += 1;
+                }
+                meanCounts[x] = static_cast<double>(sum) / numCompared;
+            }
+        }
+        // the first maximum is the one with the smallest id since the members are sorted
+        medoids[c] = clusterMembers[std::max_element(meanCounts.begin(), meanCounts.end()) - meanCounts.begin()];
+    }
+    return medoids;
+}
+
+#endif // _CLUSTERING_HPP_
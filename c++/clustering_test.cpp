@@ -0,0 +1,153 @@
+#include "clustering.hpp"
+#include "all_vs_all.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+
+using namespace std;
+
+// Checks the concurrent union-find against a serial one, the clusters of the all-vs-all stream against the known
+// clusters of generated signatures, and the medoids against a naive computation.
+
+// serial union-find with the smallest element as root
+vector<uint64_t> getNaiveClusterIds(uint64_t n, const vector<pair<uint64_t, uint64_t>>& edges) {
+    vector<uint64_t> parents(n);
+    iota(parents.begin(), parents.end(), 0);
+    auto find = [&](uint64_t x) {
+        while (parents[x] != x) x = parents[x];
+        return x;
+    };
+    for(const auto& edge : edges) {
+        const uint64_t a = find(edge.first);
+        const uint64_t b = find(edge.second);
+        parents[max(a, b)] = min(a, b);
+    }
+    vector<uint64_t> clusterIds(n);
+    uint64_t numClusters = 0;
+    for(uint64_t i = 0; i < n; ++i) clusterIds[i] = (find(i) == i) ? numClusters++ : clusterIds[find(i)];
+    return clusterIds;
+}
+
+// member with the largest sum of equal components with all other members, the smallest id in case of ties
+uint64_t getNaiveMedoid(const vector<uint64_t>& signatures, uint32_t m, const vector<uint64_t>& members) {
+    uint64_t medoid = members[0];
+    uint64_t bestSum = 0;
+    for(uint64_t x : members) {
+        uint64_t sum = 0;
+        for(uint64_t y : members) if (x != y) sum += countEqualComponents(signatures.data() + x * m, signatures.data() + y * m, m);
+        if (sum > bestSum) {
+            bestSum = sum;
+            medoid = x;
+        }
+    }
+    return medoid;
+}
+
+// signatures of numClusters clusters whose members differ from the center of their cluster in about 10% of the
+// components, the centers are unrelated, members of different clusters are shuffled
+void generateClusters(mt19937_64& rng, uint64_t n, uint32_t m, uint64_t numClusters, vector<uint64_t>& signatures, vector<uint64_t>& trueClusters) {
+    vector<uint64_t> centers(numClusters * m);
+    for(auto& x : centers) x = rng();
+    signatures.resize(n * m);
+    trueClusters.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        trueClusters[i] = rng() % numClusters;
+        for(uint32_t k = 0; k < m; ++k) signatures[i * m + k] = (rng() % 10 == 0) ? rng() : centers[trueClusters[i] * m + k];
+    }
+}
+
+int main() {
+
+    mt19937_64 rng(UINT64_C(0x4a7d02e9c53b816f));
+
+    // concurrent union-find
+    for(uint64_t n : {1, 10, 1000, 100000}) {
+        for(uint64_t numEdges : {uint64_t(0), n / 2, n, 2 * n}) {
+            vector<pair<uint64_t, uint64_t>> edges(numEdges);
+            for(auto& edge : edges) edge = make_pair(rng() % n, rng() % n);
+            ConcurrentUnionFind unionFind(n);
+            OMP_PRAGMA(omp parallel for schedule(dynamic, 64))
+            for(int64_t e = 0; e < static_cast<int64_t>(numEdges); ++e) unionFind.unite(edges[e].first, edges[e].second);
+            assert(unionFind.getClusterIds() == getNaiveClusterIds(n, edges));
+            for(const auto& edge : edges) assert(!unionFind.unite(edge.first, edge.second));
+        }
+    }
+
+    // clusters from the stream of pairs of the all-vs-all comparison, and medoids
+    {
+        const uint64_t n = 2000;
+        const uint32_t m = 128;
+        const uint64_t numClusters = 37;
+        vector<uint64_t> signatures;
+        vector<uint64_t> trueClusters;
+        generateClusters(rng, n, m, numClusters, signatures, trueClusters);
+
+        const uint32_t minCount = m / 2;
+        ConcurrentUnionFind unionFind(n);
+        computeAllVsAll(signatures.data(), n, m, [&](uint64_t i, uint64_t jBegin, uint64_t jEnd, const uint32_t* counts) {
+            for(uint64_t j = jBegin; j < jEnd; ++j) if (counts[j - jBegin] >= minCount) unionFind.unite(i, j);
+        }, 64);
+        const vector<uint64_t> clusterIds = unionFind.getClusterIds();
+        // same partition, the ids are given in the order of the first member
+        vector<uint64_t> expectedIds(numClusters, UINT64_MAX);
+        uint64_t nextId = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            if (expectedIds[trueClusters[i]] == UINT64_MAX) expectedIds[trueClusters[i]] = nextId++;
+            assert(clusterIds[i] == expectedIds[trueClusters[i]]);
+        }
+
+        const vector<uint64_t> medoids = computeMedoids(signatures.data(), m, clusterIds);
+        assert(medoids.size() == nextId);
+        vector<vector<uint64_t>> members(nextId);
+        for(uint64_t i = 0; i < n; ++i) members[clusterIds[i]].push_back(i);
+        for(uint64_t c = 0; c < nextId; ++c) assert(medoids[c] == getNaiveMedoid(signatures, m, members[c]));
+
+        // with samples, the medoid is still a good representative
+        const vector<uint64_t> sampledMedoids = computeMedoids(signatures.data(), m, clusterIds, 10);
+        for(uint64_t c = 0; c < nextId; ++c) {
+            assert(clusterIds[sampledMedoids[c]] == c);
+            assert(countEqualComponents(signatures.data() + sampledMedoids[c] * m, signatures.data() + medoids[c] * m, m) >= minCount);
+        }
+
+        // singletons and pairs
+        assert(computeMedoids(signatures.data(), m, vector<uint64_t>{0, 1, 1}) == (vector<uint64_t>{0, 1}));
+        assert(computeMedoids(signatures.data(), m, vector<uint64_t>()).empty());
+    }
+
+    // time of the clustering compared with the plain all-vs-all comparison
+    {
+        const uint64_t n = 20000;
+        const uint32_t m = 128;
+        vector<uint64_t> signatures;
+        vector<uint64_t> trueClusters;
+        generateClusters(rng, n, m, 500, signatures, trueClusters);
+        auto start = chrono::steady_clock::now();
+        uint64_t numPairs = 0;
+        computeAllVsAll(signatures.data(), n, m, [&](uint64_t i, uint64_t jBegin, uint64_t jEnd, const uint32_t* counts) {
+            uint64_t num = 0;
+            for(uint64_t j = jBegin; j < jEnd; ++j) num += (counts[j - jBegin] >= m / 2);
+            OMP_PRAGMA(omp atomic)
+            numPairs += num;
+        });
+        auto compared = chrono::steady_clock::now();
+        ConcurrentUnionFind unionFind(n);
+        computeAllVsAll(signatures.data(), n, m, [&](uint64_t i, uint64_t jBegin, uint64_t jEnd, const uint32_t* counts) {
+            for(uint64_t j = jBegin; j < jEnd; ++j) if (counts[j - jBegin] >= m / 2) unionFind.unite(i, j);
+        });
+        const vector<uint64_t> clusterIds = unionFind.getClusterIds();
+        auto clustered = chrono::steady_clock::now();
+        const vector<uint64_t> medoids = computeMedoids(signatures.data(), m, clusterIds);
+        auto end = chrono::steady_clock::now();
+        assert(medoids.size() == 500);
+        cout << "n = " << n << ", m = " << m << ", similar pairs = " << numPairs << ", clusters = " << medoids.size();
+        cout << ", all-vs-all = " << chrono::duration<double>(compared - start).count() << " s, with clustering = " << chrono::duration<double>(clustered - compared).count() << " s";
+        cout << ", medoids = " << chrono::duration<double>(end - clustered).count() << " s" << endl;
+    }
+
+    return 0;
+}
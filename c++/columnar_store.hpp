@@ -0,0 +1,221 @@
+#ifndef _COLUMNAR_STORE_HPP_
+#define _COLUMNAR_STORE_HPP_
+
+#include "signature_comparison.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+#include <new>
+
+// Register-major store of signatures for scanning a database with one query at a time.
+//
+// The signatures are divided into groups of W = 64 / sizeof(T) signatures, such that the values of one register of
+// all signatures of a group fill exactly one 64-byte cache line. Within a group the registers are stored one after
+// the other, the value of register i of signature j is located at
+//     data[((j / W) * m + i) * W + j % W].
+// A scan compares the broadcasted query register i with one cache line, which gives W comparisons per AVX-512
+// instruction (W / 2 per AVX2 instruction), and accumulates the counts of the W signatures in vector registers.
+// Hence, memory is read strictly sequentially and the counts are written only once per group, whereas the
+// row-major layout requires a horizontal reduction for every signature.
+
+namespace columnar_store {
+
+template<typename T>
+void countEqualGroupScalar(const T* query, const T* group, uint32_t m, uint32_t* counts) {
+    constexpr uint32_t W = 64 / sizeof(T);
+    uint32_t c[W] = {};
+    for(uint32_t i = 0; i < m; ++i) {
+        const T q = query[i];
+        for(uint32_t l = 0; l < W; ++l) c[l] += (group[i * W + l] == q);
+    }
+    std::copy(c, c + W, counts);
+}
+
+#ifdef SIGNATURE_COMPARISON_X86
+
+// the equal lanes are -1, subtracting them increments the counts
+template<typename T>
+__attribute__((target("avx2"))) void countEqualGroupAvx2(const T* query, const T* group, uint32_t m, uint32_t* counts) {
+    constexpr uint32_t W = 64 / sizeof(T);
+    __m256i c0 = _mm256_setzero_si256();
+    __m256i c1 = _mm256_setzero_si256();
+    for(uint32_t i = 0; i < m; ++i) {
+        const __m256i x0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(group + i * W));
+        const __m256i x1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(group + i * W) + 1);
+        if constexpr(sizeof(T) == 8) {
+            const __m256i q = _mm256_set1_epi64x(query[i]);
+            c0 = _mm256_sub_epi64(c0, _mm256_cmpeq_epi64(q, x0));
+            c1 = _mm256_sub_epi64(c1, _mm256_cmpeq_epi64(q, x1));
+        }
+        else if constexpr(sizeof(T) == 4) {
+            const __m256i q = _mm256_set1_epi32(query[i]);
+            c0 = _mm256_sub_epi32(c0, _mm256_cmpeq_epi32(q, x0));
+            c1 = _mm256_sub_epi32(c1, _mm256_cmpeq_epi32(q, x1));
+        }
+        else {
+            const __m256i q = _mm256_set1_epi16(query[i]);
+            c0 = _mm256_sub_epi16(c0, _mm256_cmpeq_epi16(q, x0));
+            c1 = _mm256_sub_epi16(c1, _mm256_cmpeq_epi16(q, x1));
+        }
+    }
+    alignas(64) T c[W];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(c), c0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(c) + 1, c1);
+    std::copy(c, c + W, counts);
+}
+
+template<typename T>
+__attribute__((target("avx512f,avx512bw"))) void countEqualGroupAvx512(const T* query, const T* group, uint32_t m, uint32_t* counts) {
+    constexpr uint32_t W = 64 / sizeof(T);
+    __m512i c = _mm512_setzero_si512();
+    for(uint32_t i = 0; i < m; ++i) {
+        const __m512i x = _mm512_load_si512(group + i * W);
+        if constexpr(sizeof(T) == 8) {
+            c = _mm512_mask_add_epi64(c, _mm512_cmpeq_epi64_mask(_mm512_set1_epi64(query[i]), x), c, _mm512_set1_epi64(1));
+        }
+        else if constexpr(sizeof(T) == 4) {
+            c = _mm512_mask_add_epi32(c, _mm512_cmpeq_epi32_mask(_mm512_set1_epi32(query[i]), x), c, _mm512_set1_epi32(1));
+        }
+        else {
+            c = _mm512_mask_add_epi16(c, _mm512_cmpeq_epi16_mask(_mm512_set1_epi16(query[i]), x), c, _mm512_set1_epi16(1));
+        }
+    }
+    alignas(64) T result[W];
+    _mm512_store_si512(result, c);
+    std::copy(result, result + W, counts);
+}
+
+#endif // SIGNATURE_COMPARISON_X86
+
+// vector with 64-byte aligned storage, such that every group of registers is one cache line
+template<typename T>
+struct CacheLineAllocator {
+    typedef T value_type;
+
+    CacheLineAllocator() = default;
+
+    template<typename U>
+    CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(64)));
+    }
+
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(64));
+    }
+
+    template<typename U>
+    bool operator==(const CacheLineAllocator<U>&) const {return true;}
+
+    template<typename U>
+    bool operator!=(const CacheLineAllocator<U>&) const {return false;}
+};
+
+} // namespace columnar_store
+
+// T must be uint64_t, uint32_t, or uint16_t. Signatures with wider values, for example those of the 64-bit
+// sketchers in minhash.hpp, are truncated to the lowest bits of T when they are added, which turns the counts
+// into estimates with an additional collision probability of 2^-(8 * sizeof(T)).
+template<typename T>
+class ColumnarSketchStore {
+    static_assert(std::is_same<T, uint64_t>::value || std::is_same<T, uint32_t>::value || std::is_same<T, uint16_t>::value, "Require T to be uint64_t, uint32_t, or uint16_t!");
+
+    static constexpr uint32_t W = 64 / sizeof(T);
+
+    uint32_t m;
+    uint64_t n;
+    std::vector<T, columnar_store::CacheLineAllocator<T>> data;
+
+public:
+
+    // number of signatures per group
+    static constexpr uint32_t getGroupSize() {
+        return W;
+    }
+
+    explicit ColumnarSketchStore(uint32_t m) : m(m), n(0) {
+        // the 16-bit lanes of the vectorized scan must not overflow
+        assert(sizeof(T) > 2 || m <= UINT16_MAX);
+    }
+
+    // loads n signatures of size m that are stored contiguously, signature j starts at signatures + j * m
+    template<typename D>
+    ColumnarSketchStore(const D* signatures, uint64_t n, uint32_t m) : ColumnarSketchStore(m) {
+        reserve(n);
+        for(uint64_t j = 0; j < n; ++j) add(signatures + j * m);
+    }
+
+    void reserve(uint64_t numSignatures) {
+        data.reserve(((numSignatures + W - 1) / W) * W * m);
+    }
+
+    // adds a signature of size m and returns its id (0, 1, 2, ...)
+    template<typename D>
+    uint64_t add(const D* signature) {
+        const uint64_t id = n++;
+        if (id % W == 0) data.resize(data.size() + static_cast<uint64_t>(W) * m, 0);
+        T* group = data.data() + (id / W) * W * m;
+        for(uint32_t i = 0; i < m; ++i) group[i * W + id % W] = static_cast<T>(signature[i]);
+        return id;
+    }
+
+    template<typename D>
+    uint64_t add(const std::vector<D>& signature) {
+        assert(signature.size() == m);
+        return add(signature.data());
+    }
+
+    uint64_t size() const {
+        return n;
+    }
+
+    uint32_t getSignatureSize() const {
+        return m;
+    }
+
+    T getComponent(uint64_t id, uint32_t i) const {
+        assert(id < n && i < m);
+        return data[((id / W) * m + i) * W + id % W];
+    }
+
+    uint64_t getSizeInBytes() const {
+        return data.size() * sizeof(T);
+    }
+
+    // Compares the query of size m with all stored signatures, counts[j] is set to the number of equal components
+    // of the query and the signature with id j. The groups are distributed over the threads.
+    void scan(const T* query, uint32_t* counts, SimdLevel level = getSupportedSimdLevel()) const {
+        if (level > getSupportedSimdLevel()) level = SimdLevel::SCALAR;
+        const int64_t numGroups = (n + W - 1) / W;
+        OMP_PRAGMA(omp parallel for schedule(static) if(numGroups * m > (INT64_C(1) << 16)))
+        for(int64_t g = 0; g < numGroups; ++g) {
+            const T* group = data.data() + static_cast<uint64_t>(g) * W * m;
+            uint32_t groupCounts[W];
+#ifdef SIGNATURE_COMPARISON_X86
+            if (level == SimdLevel::AVX512) columnar_store::countEqualGroupAvx512(query, group, m, groupCounts);
+            else if (level == SimdLevel::AVX2) columnar_store::countEqualGroupAvx2(query, group, m, groupCounts);
+            else columnar_store::countEqualGroupScalar(query, group, m, groupCounts);
+#else
+            columnar_store::countEqualGroupScalar(query, group, m, groupCounts);
+#endif
+            const uint64_t begin = static_cast<uint64_t>(g) * W;
+            std::copy(groupCounts, groupCounts + std::min(static_cast<uint64_t>(W), n - begin), counts + begin);
+        }
+    }
+
+    // returns the ids of all signatures with at least minCount components equal to the query in ascending order
+    std::vector<uint64_t> findSimilar(const T* query, uint32_t minCount, SimdLevel level = getSupportedSimdLevel()) const {
+        std::vector<uint32_t> counts(n);
+        scan(query, counts.data(), level);
+        std::vector<uint64_t> result;
+        for(uint64_t j = 0; j < n; ++j) if (counts[j] >= minCount) result.push_back(j);
+        return result;
+    }
+};
+
+#endif // _COLUMNAR_STORE_HPP_
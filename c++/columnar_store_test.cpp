@@ -0,0 +1,93 @@
+#include "columnar_store.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+// Checks the scan of the register-major store for all kernels supported by the CPU against a naive loop and
+// compares its throughput with the one-to-many scan of signatures stored one after the other (row-major).
+
+template<typename T>
+void testScan(mt19937_64& rng, const vector<SimdLevel>& levels) {
+    for(uint32_t m : {1, 2, 7, 64, 100}) {
+        for(uint64_t n : {0, 1, 7, 31, 32, 33, 100, 1000}) {
+            // 64-bit signatures as produced by the sketchers in minhash.hpp, components from a small alphabet
+            vector<uint64_t> signatures(n * m);
+            for(auto& x : signatures) x = rng() & 0x3;
+            ColumnarSketchStore<T> store(signatures.data(), n, m);
+            assert(store.size() == n && store.getSignatureSize() == m);
+            for(uint64_t j = 0; j < n; ++j) {
+                for(uint32_t i = 0; i < m; ++i) assert(store.getComponent(j, i) == static_cast<T>(signatures[j * m + i]));
+            }
+            vector<T> query(m);
+            for(auto& x : query) x = rng() & 0x3;
+            vector<uint32_t> expected(n);
+            for(uint64_t j = 0; j < n; ++j) {
+                for(uint32_t i = 0; i < m; ++i) expected[j] += (query[i] == static_cast<T>(signatures[j * m + i]));
+            }
+            for(SimdLevel level : levels) {
+                vector<uint32_t> counts(n, UINT32_MAX);
+                store.scan(query.data(), counts.data(), level);
+                assert(counts == expected);
+                const uint32_t minCount = m / 2;
+                vector<uint64_t> similar;
+                for(uint64_t j = 0; j < n; ++j) if (expected[j] >= minCount) similar.push_back(j);
+                assert(store.findSimilar(query.data(), minCount, level) == similar);
+            }
+        }
+    }
+}
+
+template<typename T>
+void benchmark(mt19937_64& rng, const vector<SimdLevel>& levels, uint64_t n, uint32_t m) {
+    vector<T> signatures(n * m);
+    for(auto& x : signatures) x = rng() & 0xF;
+    ColumnarSketchStore<T> store(signatures.data(), n, m);
+    vector<uint32_t> counts(n);
+    const uint64_t numQueries = 5;
+    for(SimdLevel level : levels) {
+        uint64_t checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for(uint64_t r = 0; r < numQueries; ++r) {
+            countEqualComponentsOneToMany(signatures.data() + r * m, signatures.data(), n, m, counts.data(), level);
+            checksum += counts[n - 1];
+        }
+        auto end = chrono::steady_clock::now();
+        const double rowMajor = n * numQueries / chrono::duration<double>(end - start).count();
+
+        start = chrono::steady_clock::now();
+        for(uint64_t r = 0; r < numQueries; ++r) {
+            store.scan(signatures.data() + r * m, counts.data(), level);
+            checksum += counts[n - 1];
+        }
+        end = chrono::steady_clock::now();
+        const double registerMajor = n * numQueries / chrono::duration<double>(end - start).count();
+
+        cout << "bits = " << sizeof(T) * 8 << ", n = " << n << ", m = " << m << ", kernel = " << getSimdLevelName(level);
+        cout << ", row-major = " << rowMajor << " signatures/s, register-major = " << registerMajor << " signatures/s";
+        cout << " (checksum = " << checksum << ")" << endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    vector<SimdLevel> levels = {SimdLevel::SCALAR};
+    if (getSupportedSimdLevel() >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    if (getSupportedSimdLevel() >= SimdLevel::AVX512) levels.push_back(SimdLevel::AVX512);
+
+    mt19937_64 rng(UINT64_C(0x58d1e7a3c90b264f));
+
+    testScan<uint64_t>(rng, levels);
+    testScan<uint32_t>(rng, levels);
+    testScan<uint16_t>(rng, levels);
+
+    cout << scientific;
+    benchmark<uint64_t>(rng, levels, 200000, 128);
+    benchmark<uint32_t>(rng, levels, 200000, 256);
+    benchmark<uint16_t>(rng, levels, 100000, 1024);
+
+    return 0;
+}
@@ -0,0 +1,409 @@
+#ifndef _DISTANCE_WRITER_HPP_
+#define _DISTANCE_WRITER_HPP_
+
+#include "all_vs_all.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+// Output of the all-vs-all comparison in binary and text formats, streamed in row blocks as produced by
+// computeAllVsAllRowBlocks (see all_vs_all.hpp). Every writer can be used as consumer of computeAllVsAllRowBlocks,
+// converts the counts of a block into the output format in parallel, and hands the result to a writer thread, such
+// that formatting and writing overlap with the comparison of the next block. The conversion uses a table with an
+// entry for every possible count 0, ..., m, hence no floating-point formatting is needed per pair.
+//
+// CondensedMatrixWriter is the exception, it writes the condensed upper triangle and is used as consumer of
+// computeAllVsAllCondensedRowBlocks instead.
+//
+// Formats, all integers and floating-point values in native byte order (there is no byte order mark, readers on a machine
+// of the other byte order must swap them), the ids of the signatures are their positions in the input:
+//     CondensedMatrixWriter: the 8 bytes "PMHMAT01", n (uint64), m (uint32), followed by the n(n-1)/2 numbers of equal
+//                           components (uint16) of the condensed upper triangle in row-major order (see getCondensedIndex)
+//     DenseDistanceWriter:  the 8 bytes "PMHDST01", n (uint64), m (uint32), bytes per value (uint32, 2 or 4), followed by
+//                           the Jaccard distances 1 - count / m of the lower triangle in row-major order (see
+//                           getLowerTriangleIndex) as float16 or float32
+//     EdgeListWriter:       the 8 bytes "PMHEDG01", n (uint64), m (uint32), minimum count (uint32), number of edges
+//                           (uint64), followed by one record for every pair (i, j) with j < i and at least the minimum
+//                           count: i (uint32), j (uint32), similarity count / m (float32), ordered by i and j
+//     PhylipWriter:         the lower-triangular distance matrix in relaxed PHYLIP format, the number of signatures in
+//                           the first line, then for every signature a line with its name and the distances to all
+//                           previous signatures with 6 decimal places
+
+// Converts to IEEE 754 half precision with rounding to nearest even.
+inline uint16_t floatToHalf(float value) {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const uint16_t sign = (x >> 16) & 0x8000;
+    const uint32_t floatExponent = (x >> 23) & 0xFF;
+    uint32_t mantissa = x & 0x7FFFFF;
+    if (floatExponent == 0xFF) return sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+    const int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+    if (exponent >= 31) return sign | 0x7C00;
+    uint32_t shift = 13;
+    uint32_t half = (static_cast<uint32_t>(std::max(exponent, 0)) << 10);
+    if (exponent <= 0) {
+        // subnormal, the implicit leading bit becomes explicit
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        half = 0;
+    }
+    half |= mantissa >> shift;
+    const uint32_t remainder = mantissa & ((UINT32_C(1) << shift) - 1);
+    const uint32_t halfway = UINT32_C(1) << (shift - 1);
+    // a carry into the exponent gives the correctly rounded result
+    if (remainder > halfway || (remainder == halfway && (half & 1) != 0)) half += 1;
+    return sign | static_cast<uint16_t>(half);
+}
+
+inline float halfToFloat(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t x;
+    if (exponent == 0x1F) {
+        x = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        x = sign;
+    }
+    else {
+        int32_t e = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            e -= 1;
+        }
+        x = sign | (static_cast<uint32_t>(e) << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+}
+
+// Writes buffers to a file on a separate thread with writev. write() returns immediately unless more than
+// maxQueuedBytes are waiting, which bounds the memory if the disk is slower than the producer.
+class AsyncFileWriter {
+    int fd;
+    const uint64_t maxQueuedBytes;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::vector<std::string>> queue;
+    uint64_t queuedBytes = 0;
+    bool isClosing = false;
+    bool isWriting = false;
+    bool hasFailed = false;
+    std::thread thread;
+
+    static uint64_t getSize(const std::vector<std::string>& chunks) {
+        uint64_t size = 0;
+        for (const auto& chunk : chunks) size += chunk.size();
+        return size;
+    }
+
+    bool writeChunks(const std::vector<std::string>& chunks) {
+        std::vector<iovec> vectors;
+        for (const auto& chunk : chunks) {
+            if (!chunk.empty()) vectors.push_back(iovec{const_cast<char*>(chunk.data()), chunk.size()});
+        }
+        size_t first = 0;
+        while (first < vectors.size()) {
+            const int count = static_cast<int>(std::min(vectors.size() - first, static_cast<size_t>(IOV_MAX)));
+            const ssize_t numWritten = ::writev(fd, vectors.data() + first, count);
+            if (numWritten < 0 && errno == EINTR) continue;
+            if (numWritten <= 0) return false;
+            // skips the completely written buffers and advances within a partially written one
+            size_t remaining = numWritten;
+            while (first < vectors.size() && remaining >= vectors[first].iov_len) {
+                remaining -= vectors[first].iov_len;
+                first += 1;
+            }
+            if (remaining > 0) {
+                vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+                vectors[first].iov_len -= remaining;
+            }
+        }
+        return true;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [this] {return isClosing || !queue.empty();});
+            if (queue.empty()) return;
+            std::vector<std::string> chunks = std::move(queue.front());
+            queue.pop_front();
+            isWriting = true;
+            lock.unlock();
+            const bool ok = writeChunks(chunks);
+            const uint64_t size = getSize(chunks);
+            lock.lock();
+            isWriting = false;
+            queuedBytes -= size;
+            hasFailed |= !ok;
+            condition.notify_all();
+        }
+    }
+
+public:
+
+    explicit AsyncFileWriter(const std::string& fileName, uint64_t maxQueuedBytes = UINT64_C(256) << 20) :
+            fd(::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), maxQueuedBytes(maxQueuedBytes) {
+        if (fd >= 0) thread = std::thread(&AsyncFileWriter::run, this);
+    }
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    ~AsyncFileWriter() {
+        close();
+    }
+
+    // false if the file could not be opened or a write failed
+    bool good() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fd >= 0 && !hasFailed;
+    }
+
+    // appends the chunks to the file
+    void write(std::vector<std::string>&& chunks) {
+        if (fd < 0) return;
+        const uint64_t size = getSize(chunks);
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] {return queuedBytes == 0 || queuedBytes < maxQueuedBytes;});
+        queuedBytes += size;
+        queue.push_back(std::move(chunks));
+        condition.notify_all();
+    }
+
+    void write(std::string&& chunk) {
+        std::vector<std::string> chunks(1);
+        chunks[0] = std::move(chunk);
+        write(std::move(chunks));
+    }
+
+    // overwrites bytes at the given position after all queued chunks have been written, e.g. to update a header
+    bool writeAt(uint64_t offset, const void* data, uint64_t size) {
+        if (fd < 0) return false;
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] {return queue.empty() && !isWriting;});
+        if (::pwrite(fd, data, size, offset) != static_cast<ssize_t>(size)) hasFailed = true;
+        return !hasFailed;
+    }
+
+    // writes all queued chunks and closes the file, returns false if anything failed
+    bool close() {
+        if (fd < 0) return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isClosing = true;
+            condition.notify_all();
+        }
+        thread.join();
+        if (::close(fd) != 0) hasFailed = true;
+        fd = -1;
+        return !hasFailed;
+    }
+};
+
+// Condensed upper triangle of the numbers of equal components, requires m <= 65535.
+class CondensedMatrixWriter {
+    AsyncFileWriter writer;
+    const uint64_t n;
+    const uint32_t m;
+
+public:
+
+    CondensedMatrixWriter(const std::string& fileName, uint64_t n, uint32_t m) : writer(fileName), n(n), m(m) {
+        std::string header("PMHMAT01");
+        header.append(reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+        header.append(reinterpret_cast<const char*>(&m), sizeof(uint32_t));
+        writer.write(std::move(header));
+    }
+
+    bool good() {
+        return m <= UINT16_MAX && writer.good();
+    }
+
+    void operator()(uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+        const int64_t numCounts = getCondensedRowOffset(iEnd, n) - getCondensedRowOffset(iBegin, n);
+        std::string buffer(numCounts * sizeof(uint16_t), '\0');
+        uint16_t* values = reinterpret_cast<uint16_t*>(&buffer[0]);
+        OMP_PRAGMA(omp parallel for schedule(static))
+        for (int64_t x = 0; x < numCounts; ++x) values[x] = counts[x];
+        writer.write(std::move(buffer));
+    }
+
+    bool finish() {
+        return writer.close();
+    }
+};
+
+// Dense lower triangle of Jaccard distances as float16 or float32.
+class DenseDistanceWriter {
+    static constexpr uint64_t headerSize = 8 + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+    AsyncFileWriter writer;
+    const uint32_t bytesPerValue;
+    std::vector<uint16_t> halfValues;
+    std::vector<float> floatValues;
+
+public:
+
+    DenseDistanceWriter(const std::string& fileName, uint64_t n, uint32_t m, uint32_t bytesPerValue) : writer(fileName), bytesPerValue(bytesPerValue) {
+        for (uint32_t count = 0; count <= m; ++count) {
+            const float distance = 1.f - static_cast<float>(count) / m;
+            floatValues.push_back(distance);
+            halfValues.push_back(floatToHalf(distance));
+        }
+        std::string header("PMHDST01");
+        header.append(reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+        header.append(reinterpret_cast<const char*>(&m), sizeof(uint32_t));
+        header.append(reinterpret_cast<const char*>(&bytesPerValue), sizeof(uint32_t));
+        writer.write(std::move(header));
+    }
+
+    bool good() {
+        return (bytesPerValue == 2 || bytesPerValue == 4) && writer.good();
+    }
+
+    void operator()(uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+        const int64_t numCounts = iEnd * (iEnd - 1) / 2 - iBegin * (iBegin - 1) / 2;
+        std::string buffer(numCounts * bytesPerValue, '\0');
+        if (bytesPerValue == 2) {
+            uint16_t* values = reinterpret_cast<uint16_t*>(&buffer[0]);
+            OMP_PRAGMA(omp parallel for schedule(static))
+            for (int64_t x = 0; x < numCounts; ++x) values[x] = halfValues[counts[x]];
+        }
+        else {
+            float* values = reinterpret_cast<float*>(&buffer[0]);
+            OMP_PRAGMA(omp parallel for schedule(static))
+            for (int64_t x = 0; x < numCounts; ++x) values[x] = floatValues[counts[x]];
+        }
+        writer.write(std::move(buffer));
+    }
+
+    bool finish() {
+        return writer.close();
+    }
+};
+
+// Sparse list of the pairs with at least minCount equal components.
+class EdgeListWriter {
+    static constexpr uint64_t numEdgesOffset = 8 + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+    AsyncFileWriter writer;
+    const uint32_t m;
+    const uint32_t minCount;
+    uint64_t numEdges = 0;
+
+public:
+
+    EdgeListWriter(const std::string& fileName, uint64_t n, uint32_t m, uint32_t minCount) : writer(fileName), m(m), minCount(minCount) {
+        std::string header("PMHEDG01");
+        header.append(reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+        header.append(reinterpret_cast<const char*>(&m), sizeof(uint32_t));
+        header.append(reinterpret_cast<const char*>(&minCount), sizeof(uint32_t));
+        header.append(reinterpret_cast<const char*>(&numEdges), sizeof(uint64_t));
+        writer.write(std::move(header));
+    }
+
+    bool good() {
+        return writer.good();
+    }
+
+    void operator()(uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+        const uint64_t offset = iBegin * (iBegin - 1) / 2;
+        std::vector<std::string> rows(iEnd - iBegin);
+        uint64_t numBlockEdges = 0;
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1) reduction(+:numBlockEdges))
+        for (int64_t r = 0; r < static_cast<int64_t>(rows.size()); ++r) {
+            const uint32_t i = iBegin + r;
+            const uint32_t* rowCounts = counts + (i * (i - UINT64_C(1)) / 2 - offset);
+            for (uint32_t j = 0; j < i; ++j) {
+                if (rowCounts[j] < minCount) continue;
+                const float similarity = static_cast<float>(rowCounts[j]) / m;
+                char record[12];
+                std::memcpy(record, &i, 4);
+                std::memcpy(record + 4, &j, 4);
+                std::memcpy(record + 8, &similarity, 4);
+                rows[r].append(record, sizeof(record));
+                numBlockEdges += 1;
+            }
+        }
+        numEdges += numBlockEdges;
+        writer.write(std::move(rows));
+    }
+
+    uint64_t getNumEdges() const {
+        return numEdges;
+    }
+
+    // writes the number of edges into the header and closes the file
+    bool finish() {
+        const bool ok = writer.writeAt(numEdgesOffset, &numEdges, sizeof(uint64_t));
+        return writer.close() && ok;
+    }
+};
+
+// Lower-triangular distance matrix in relaxed PHYLIP format, whitespace in names is replaced by underscores.
+class PhylipWriter {
+    AsyncFileWriter writer;
+    std::vector<std::string> names;
+    std::vector<std::string> formattedValues;
+
+public:
+
+    PhylipWriter(const std::string& fileName, const std::vector<std::string>& names, uint32_t m) : writer(fileName), names(names) {
+        for (auto& name : this->names) std::replace_if(name.begin(), name.end(), [](char c) {return c == ' ' || c == '\t' || c == '\n' || c == '\r';}, '_');
+        for (uint32_t count = 0; count <= m; ++count) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), " %.6f", 1. - static_cast<double>(count) / m);
+            formattedValues.push_back(buffer);
+        }
+        writer.write(std::to_string(names.size()) + "\n");
+    }
+
+    bool good() {
+        return writer.good();
+    }
+
+    void operator()(uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+        const uint64_t offset = iBegin * (iBegin - 1) / 2;
+        std::vector<std::string> rows(iEnd - iBegin);
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for (int64_t r = 0; r < static_cast<int64_t>(rows.size()); ++r) {
+            const uint64_t i = iBegin + r;
+            const uint32_t* rowCounts = counts + (i * (i - 1) / 2 - offset);
+            std::string& row = rows[r];
+            row.reserve(names[i].size() + 10 * i + 1);
+            row += names[i];
+            for (uint64_t j = 0; j < i; ++j) row += formattedValues[rowCounts[j]];
+            row += '\n';
+        }
+        writer.write(std::move(rows));
+    }
+
+    bool finish() {
+        return writer.close();
+    }
+};
+
+#endif // _DISTANCE_WRITER_HPP_
@@ -0,0 +1,186 @@
+#include "distance_writer.hpp"
+#include "all_vs_all.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+
+// Checks the half-precision conversion and reads back every output format of an all-vs-all comparison, then compares
+// the time of writing the full distance matrix in each format with writing it as text pairs through an ostream.
+
+string readFile(const string& fileName) {
+    ifstream in(fileName, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+template<typename V>
+V readValue(const string& data, uint64_t& position) {
+    V value;
+    assert(position + sizeof(V) <= data.size());
+    memcpy(&value, data.data() + position, sizeof(V));
+    position += sizeof(V);
+    return value;
+}
+
+int main(int argc, char* argv[]) {
+
+    const string fileName = (argc > 1) ? string(argv[1]) : string("distance_writer_test.bin");
+    mt19937_64 rng(UINT64_C(0x93c4e1a07b5d28f6));
+
+    // every finite half value is converted back exactly, values between two half values are rounded to the nearest,
+    // and to the even one at the midpoint
+    for(uint32_t h = 0; h < 0x7C00; ++h) {
+        const float value = halfToFloat(h);
+        assert(floatToHalf(value) == h && floatToHalf(-value) == (h | 0x8000));
+        if (h + 1 < 0x7C00) {
+            const float next = halfToFloat(h + 1);
+            const float midpoint = (value + next) / 2;
+            assert(floatToHalf(midpoint) == ((h & 1) ? h + 1 : h));
+            assert(floatToHalf(nextafterf(midpoint, 0.f)) == h && floatToHalf(nextafterf(midpoint, 1e6f)) == h + 1);
+        }
+    }
+    assert(floatToHalf(65520.f) == 0x7C00 && floatToHalf(INFINITY) == 0x7C00 && floatToHalf(1e-8f) == 0);
+    assert(std::isnan(halfToFloat(floatToHalf(NAN))));
+
+    const uint64_t n = 1001;
+    const uint32_t m = 100;
+    vector<uint64_t> signatures(n * m);
+    for(auto& x : signatures) x = rng() & 0x3;
+    vector<uint32_t> expected(n * (n - 1) / 2);
+    for(uint64_t i = 1; i < n; ++i) {
+        for(uint64_t j = 0; j < i; ++j) expected[getLowerTriangleIndex(i, j)] = countEqualComponents(signatures.data() + i * m, signatures.data() + j * m, m);
+    }
+    vector<string> names;
+    for(uint64_t i = 0; i < n; ++i) names.push_back("genome " + to_string(i));
+
+    for(uint64_t tileSize : {1, 64, 5000}) {
+        // dense matrices
+        for(uint32_t bytesPerValue : {2, 4}) {
+            DenseDistanceWriter writer(fileName, n, m, bytesPerValue);
+            assert(writer.good());
+            computeAllVsAllRowBlocks(signatures.data(), n, m, writer, tileSize);
+            assert(writer.finish());
+            const string data = readFile(fileName);
+            uint64_t position = 8;
+            assert(data.compare(0, 8, "PMHDST01") == 0);
+            assert(readValue<uint64_t>(data, position) == n && readValue<uint32_t>(data, position) == m && readValue<uint32_t>(data, position) == bytesPerValue);
+            assert(data.size() == position + expected.size() * bytesPerValue);
+            for(uint32_t count : expected) {
+                const float distance = (bytesPerValue == 2) ? halfToFloat(readValue<uint16_t>(data, position)) : readValue<float>(data, position);
+                assert(fabs(distance - (1. - double(count) / m)) <= ((bytesPerValue == 2) ? 1e-3 : 1e-7));
+            }
+        }
+
+        // edge list
+        for(uint32_t minCount : {0, 30, 101}) {
+            EdgeListWriter writer(fileName, n, m, minCount);
+            computeAllVsAllRowBlocks(signatures.data(), n, m, writer, tileSize);
+            assert(writer.finish());
+            const string data = readFile(fileName);
+            uint64_t position = 8;
+            assert(data.compare(0, 8, "PMHEDG01") == 0);
+            assert(readValue<uint64_t>(data, position) == n && readValue<uint32_t>(data, position) == m && readValue<uint32_t>(data, position) == minCount);
+            const uint64_t numEdges = readValue<uint64_t>(data, position);
+            assert(numEdges == writer.getNumEdges() && data.size() == position + numEdges * 12);
+            uint64_t e = 0;
+            for(uint64_t i = 1; i < n; ++i) {
+                for(uint64_t j = 0; j < i; ++j) {
+                    const uint32_t count = expected[getLowerTriangleIndex(i, j)];
+                    if (count < minCount) continue;
+                    assert(readValue<uint32_t>(data, position) == i && readValue<uint32_t>(data, position) == j);
+                    assert(readValue<float>(data, position) == static_cast<float>(count) / m);
+                    e += 1;
+                }
+            }
+            assert(e == numEdges);
+        }
+
+        // PHYLIP
+        {
+            PhylipWriter writer(fileName, names, m);
+            computeAllVsAllRowBlocks(signatures.data(), n, m, writer, tileSize);
+            assert(writer.finish());
+            istringstream in(readFile(fileName));
+            uint64_t fileN;
+            in >> fileN;
+            assert(fileN == n);
+            for(uint64_t i = 0; i < n; ++i) {
+                string name;
+                in >> name;
+                assert(name == "genome_" + to_string(i));
+                for(uint64_t j = 0; j < i; ++j) {
+                    double distance;
+                    in >> distance;
+                    assert(fabs(distance - (1. - double(expected[getLowerTriangleIndex(i, j)]) / m)) < 1e-6);
+                }
+            }
+            string rest;
+            assert(!(in >> rest));
+        }
+    }
+    assert(!AsyncFileWriter("/nonexistent/directory/file").good());
+
+    // time to write all pairs, compared with text output of every pair with names and similarity
+    {
+        const uint64_t benchmarkN = 4000;
+        const uint32_t benchmarkM = 128;
+        vector<uint64_t> benchmarkSignatures(benchmarkN * benchmarkM);
+        for(auto& x : benchmarkSignatures) x = rng() & 0xF;
+        vector<string> benchmarkNames;
+        for(uint64_t i = 0; i < benchmarkN; ++i) benchmarkNames.push_back("genome" + to_string(i));
+        const double numPairs = static_cast<double>(benchmarkN) * (benchmarkN - 1) / 2;
+        auto report = [&](const string& format, chrono::steady_clock::time_point start) {
+            const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            ifstream in(fileName, ios::binary | ios::ate);
+            cout << "n = " << benchmarkN << ", m = " << benchmarkM << ", " << format << ": " << seconds << " s, ";
+            cout << numPairs / seconds << " pairs/s, " << in.tellg() << " bytes" << endl;
+        };
+
+        auto start = chrono::steady_clock::now();
+        {
+            ofstream out(fileName);
+            computeAllVsAllRowBlocks(benchmarkSignatures.data(), benchmarkN, benchmarkM, [&](uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+                for(uint64_t i = iBegin; i < iEnd; ++i) {
+                    for(uint64_t j = 0; j < i; ++j) out << benchmarkNames[i] << "\t" << benchmarkNames[j] << "\t" << double(*counts++) / benchmarkM << "\n";
+                }
+            });
+        }
+        report("text pairs", start);
+
+        for(uint32_t bytesPerValue : {2, 4}) {
+            start = chrono::steady_clock::now();
+            DenseDistanceWriter writer(fileName, benchmarkN, benchmarkM, bytesPerValue);
+            computeAllVsAllRowBlocks(benchmarkSignatures.data(), benchmarkN, benchmarkM, writer);
+            assert(writer.finish());
+            report((bytesPerValue == 2) ? "float16" : "float32", start);
+        }
+
+        start = chrono::steady_clock::now();
+        {
+            EdgeListWriter writer(fileName, benchmarkN, benchmarkM, benchmarkM / 8);
+            computeAllVsAllRowBlocks(benchmarkSignatures.data(), benchmarkN, benchmarkM, writer);
+            assert(writer.finish());
+        }
+        report("edges", start);
+
+        start = chrono::steady_clock::now();
+        {
+            PhylipWriter writer(fileName, benchmarkNames, benchmarkM);
+            computeAllVsAllRowBlocks(benchmarkSignatures.data(), benchmarkN, benchmarkM, writer);
+            assert(writer.finish());
+        }
+        report("PHYLIP", start);
+    }
+    remove(fileName.c_str());
+
+    return 0;
+}
@@ -0,0 +1,377 @@
+#ifndef _GENOME_SKETCHING_HPP_
+#define _GENOME_SKETCHING_HPP_
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cassert>
+
+#include "minhash.hpp"
+#include "bitstream_random.hpp"
+#include "signature_comparison.hpp"
+
+// Funciones compartidas para calcular firmas de genomas a partir de k-mers.
+// Los k-mers se codifican con 2 bits por base (k <= 32), de modo que una sola
+// ventana deslizante de 64 bits contiene a la vez los k-mers de todas las longitudes.
+
+static const uint32_t MAX_K = 32; // largo máximo de un k-mer codificado en 64 bits
+
+// Concatena las secuencias de un FASTA (omitiendo cabeceras)
+inline std::string parseGenome(std::istream &in) {
+    std::string line, genome;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '>') continue;
+        genome += line;
+    }
+    return genome;
+}
+
+// Lee los archivo FASTA y concatena las secuencias (omitiendo cabeceras)
+inline std::string readGenome(const std::string &filename) {
+    std::ifstream in(filename);
+    if(!in) {
+        std::cerr << "No se pudo abrir " << filename << "\n";
+        exit(1);
+    }
+    return parseGenome(in);
+}
+
+// Codificación de 2 bits por base (A=0, C=1, G=2, T=3), cualquier otro caracter (por ejemplo N) es inválido
+static const uint8_t INVALID_BASE = 4;
+
+inline uint8_t encodeBase(char c) {
+    switch(c) {
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return INVALID_BASE;
+    }
+}
+
+// Hash de un k-mer codificado, se incluye k para que k-mers de distinto largo no coincidan
+inline uint64_t hashKmer(uint64_t kmer, uint32_t k) {
+    return wyhash64(kmer, k);
+}
+
+// Recorre la secuencia una sola vez y llama a consumer(j, kmer) para cada k-mer codificado de largo ks[j].
+// Los k-mers que contienen bases inválidas se omiten.
+template<typename F>
+void forEachKmer(const std::string &genome, const std::vector<uint32_t> &ks, F&& consumer) {
+    std::vector<uint64_t> masks(ks.size());
+    for (size_t j = 0; j < ks.size(); j++) {
+        assert(ks[j] >= 1 && ks[j] <= MAX_K);
+        masks[j] = (ks[j] == MAX_K) ? UINT64_C(0xFFFFFFFFFFFFFFFF) : ((UINT64_C(1) << (2 * ks[j])) - 1);
+    }
+    uint64_t window = 0;
+    uint32_t numValidBases = 0; // bases válidas consecutivas al final de la ventana
+    for (char c : genome) {
+        uint8_t code = encodeBase(c);
+        if (code == INVALID_BASE) {
+            numValidBases = 0;
+            continue;
+        }
+        window = (window << 2) | code;
+        if (numValidBases < MAX_K) numValidBases++;
+        for (size_t j = 0; j < ks.size(); j++) {
+            if (numValidBases >= ks[j]) consumer(j, window & masks[j]);
+        }
+    }
+}
+
+// Elemento que se pasa a los algoritmos de minhash: hash del k-mer y su frecuencia como peso
+struct KmerItem {
+    uint64_t element; // hash del k-mer
+    double weight;
+};
+
+// Dado un KmerItem, extrae el identificador D (aquí uint64_t)
+struct ExtractFunction {
+    uint64_t operator()(const KmerItem &item) const {
+        return item.element;
+    }
+};
+
+// Dado un KmerItem, retorna el peso
+struct WeightFunction {
+    double operator()(const KmerItem &item) const {
+        return item.weight;
+    }
+};
+
+// Dado un element (uint64_t), genera un WyrandBitStream con una semilla fija para que las firmas sean reproducibles
+struct RngFunction {
+    WyrandBitStream operator()(uint64_t element) const {
+        return WyrandBitStream(element, UINT64_C(123456789));
+    }
+};
+
+// Generador de números aleatorios para los componentes de la firma en OPH
+struct RngFunctionForSignatureComponents {
+    WyrandBitStream operator()(uint32_t x) const {
+        return WyrandBitStream(x, UINT64_C(987654321));
+    }
+};
+
+// Extrae los k-mers (hasheados) con sus frecuencias para todas las longitudes ks en una sola pasada sobre la secuencia.
+// Las frecuencias se obtienen ordenando los hashes, lo que es bastante más rápido que un unordered_map.
+inline std::vector<std::vector<KmerItem>> extractWeightedKmers(const std::string &genome, const std::vector<uint32_t> &ks) {
+    std::vector<std::vector<uint64_t>> hashes(ks.size());
+    for (auto &h : hashes) h.reserve(genome.size());
+    forEachKmer(genome, ks, [&](size_t j, uint64_t kmer) {
+        hashes[j].push_back(hashKmer(kmer, ks[j]));
+    });
+    std::vector<std::vector<KmerItem>> items(ks.size());
+    for (size_t j = 0; j < ks.size(); j++) {
+        std::sort(hashes[j].begin(), hashes[j].end());
+        for (size_t i = 0; i < hashes[j].size(); i++) {
+            if (items[j].empty() || items[j].back().element != hashes[j][i]) items[j].push_back(KmerItem{hashes[j][i], 1.0});
+            else items[j].back().weight += 1.0;
+        }
+        std::vector<uint64_t>().swap(hashes[j]); // libera la memoria
+    }
+    return items;
+}
+
+// Calcula las firmas de un genoma para varios largos de k-mer leyendo y decodificando la secuencia una sola vez.
+// Se usa una instancia separada del algoritmo H (por ejemplo ProbMinHash1 o MinHash) para cada k.
+template<typename H>
+class MultiKSketcher {
+    const std::vector<uint32_t> ks;
+    std::vector<std::unique_ptr<H>> sketchers;
+
+public:
+    // createSketcher(k) debe retornar un puntero a una nueva instancia del algoritmo
+    template<typename F>
+    MultiKSketcher(const std::vector<uint32_t> &ks, F&& createSketcher) : ks(ks) {
+        for (uint32_t k : ks) sketchers.emplace_back(createSketcher(k));
+    }
+
+    const std::vector<uint32_t>& getKs() const {
+        return ks;
+    }
+
+    // retorna una firma por cada k, en el mismo orden que ks
+    std::vector<std::vector<uint64_t>> operator()(const std::string &genome) {
+        const auto items = extractWeightedKmers(genome, ks);
+        std::vector<std::vector<uint64_t>> signatures;
+        signatures.reserve(ks.size());
+        for (size_t j = 0; j < ks.size(); j++) {
+            signatures.push_back((*sketchers[j])(items[j]));
+        }
+        return signatures;
+    }
+};
+
+// Calcula las firmas de varios algoritmos (por ejemplo MinHash no ponderado y ProbMinHash1 ponderado) y varios largos
+// de k-mer a partir de una sola lectura, decodificación, hasheo y conteo de los k-mers. Los algoritmos no ponderados
+// ignoran las frecuencias. Con OpenMP los algoritmos se ejecutan en paralelo, de modo que el tiempo total
+// se acerca al del algoritmo más lento en lugar de la suma.
+class MultiAlgorithmSketcher {
+    const std::vector<uint32_t> ks;
+    std::vector<std::string> names;
+    // sketchers[a][j] calcula la firma del algoritmo a para k = ks[j]
+    std::vector<std::vector<std::function<std::vector<uint64_t>(const std::vector<KmerItem>&)>>> sketchers;
+
+public:
+    MultiAlgorithmSketcher(const std::vector<uint32_t> &ks) : ks(ks) {}
+
+    // agrega un algoritmo, createSketcher(k) debe retornar un puntero a una nueva instancia
+    template<typename H, typename F>
+    void addAlgorithm(const std::string &name, F&& createSketcher) {
+        names.push_back(name);
+        sketchers.emplace_back();
+        for (uint32_t k : ks) {
+            std::shared_ptr<H> h(createSketcher(k));
+            sketchers.back().push_back([h](const std::vector<KmerItem> &items) {return (*h)(items);});
+        }
+    }
+
+    const std::vector<uint32_t>& getKs() const {
+        return ks;
+    }
+
+    const std::vector<std::string>& getNames() const {
+        return names;
+    }
+
+    // retorna signatures[a][j], la firma del algoritmo a para k = ks[j]
+    std::vector<std::vector<std::vector<uint64_t>>> operator()(const std::string &genome) {
+        const auto items = extractWeightedKmers(genome, ks);
+        std::vector<std::vector<std::vector<uint64_t>>> signatures(names.size(), std::vector<std::vector<uint64_t>>(ks.size()));
+        const int64_t numTasks = names.size() * ks.size();
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for (int64_t t = 0; t < numTasks; t++) {
+            const size_t a = t / ks.size();
+            const size_t j = t % ks.size();
+            signatures[a][j] = sketchers[a][j](items[j]);
+        }
+        return signatures;
+    }
+};
+
+// Calcula la similitud Jaccard (ponderada) aproximada: cuenta cuántos componentes son iguales
+// (con instrucciones SIMD si el procesador las soporta).
+inline double estimateJaccard(const std::vector<uint64_t> &sigA, const std::vector<uint64_t> &sigB) {
+    if (sigA.size() != sigB.size()) {
+        std::cerr << "Las firmas tienen tamaños diferentes\n";
+        return 0.0;
+    }
+    return double(countEqualComponents(sigA.data(), sigB.data(), sigA.size())) / sigA.size();
+}
+
+// Resultado de una comparación con umbral
+struct ThresholdResult {
+    bool similar;            // true si la similitud alcanza el umbral
+    double similarity;       // similitud estimada con los componentes comparados
+    size_t numCompared;      // cantidad de componentes comparados
+};
+
+// Comparación de firmas de tamaño m contra un umbral de similitud que se detiene apenas el resultado está decidido.
+// Los componentes se comparan en bloques y después de cada bloque se aplica una cota binomial secuencial
+// (cota de Chernoff): con c iguales en n componentes se decide "bajo el umbral" si c/n < t y
+// n * KL(c/n || t) >= log(numBlocks / errorRate), y "sobre el umbral" en el caso simétrico. Así la probabilidad de
+// una decisión anticipada equivocada es a lo más errorRate. Además se termina sin error cuando los componentes
+// restantes ya no pueden cambiar el resultado. Si la comparación llega al final, el resultado es el mismo de estimateJaccard.
+// Los contadores no son thread-safe, se debe usar una instancia por thread.
+class ThresholdComparator {
+    const size_t m;
+    const double threshold;
+    const size_t blockSize;
+    // después de n = (b + 1) * blockSize componentes: bajo el umbral si c <= rejectLimits[b], sobre el umbral si c >= acceptLimits[b]
+    std::vector<int64_t> rejectLimits;
+    std::vector<int64_t> acceptLimits;
+    uint64_t numComparisons = 0;
+    uint64_t numComparedComponents = 0;
+
+    // divergencia de Kullback-Leibler entre Bernoulli(q) y Bernoulli(p)
+    static double kl(double q, double p) {
+        double result = 0;
+        if (q > 0) result += q * std::log(q / p);
+        if (q < 1) result += (1 - q) * std::log((1 - q) / (1 - p));
+        return result;
+    }
+
+public:
+
+    ThresholdComparator(size_t m, double threshold, double errorRate = 1e-3, size_t blockSize = 64) : m(m), threshold(threshold), blockSize(blockSize) {
+        assert(m >= 1 && blockSize >= 1 && errorRate > 0);
+        const size_t numBlocks = (m + blockSize - 1) / blockSize;
+        const double logLimit = std::log(numBlocks / errorRate);
+        for (size_t b = 0; b + 1 < numBlocks; b++) {
+            const size_t n = (b + 1) * blockSize;
+            int64_t reject = -1;
+            int64_t accept = n + 1;
+            if (threshold > 0 && threshold < 1) {
+                while (reject + 1 < threshold * n && n * kl(double(reject + 1) / n, threshold) >= logLimit) reject++;
+                while (accept - 1 > threshold * n && n * kl(double(accept - 1) / n, threshold) >= logLimit) accept--;
+            }
+            rejectLimits.push_back(reject);
+            acceptLimits.push_back(accept);
+        }
+    }
+
+    ThresholdResult operator()(const std::vector<uint64_t> &sigA, const std::vector<uint64_t> &sigB) {
+        assert(sigA.size() == m && sigB.size() == m);
+        // cantidad mínima de componentes iguales para alcanzar el umbral con la firma completa
+        const int64_t required = static_cast<int64_t>(std::ceil(threshold * m - 1e-9));
+        int64_t count = 0;
+        size_t n = 0;
+        for (size_t b = 0; ; b++) {
+            const size_t end = std::min(n + blockSize, m);
+            for (; n < end; n++) {
+                if (sigA[n] == sigB[n]) count++;
+            }
+            // al final de la firma siempre se cumple una de las dos primeras condiciones
+            int decision = -1;
+            if (count >= required) decision = 1;
+            else if (count + static_cast<int64_t>(m - n) < required) decision = 0;
+            else if (count <= rejectLimits[b]) decision = 0;
+            else if (count >= acceptLimits[b]) decision = 1;
+            if (decision >= 0) {
+                numComparisons++;
+                numComparedComponents += n;
+                return ThresholdResult{decision == 1, double(count) / n, n};
+            }
+        }
+    }
+
+    uint64_t getNumComparisons() const {
+        return numComparisons;
+    }
+
+    uint64_t getNumComparedComponents() const {
+        return numComparedComponents;
+    }
+
+    // componentes que no fue necesario comparar
+    uint64_t getNumSavedComponents() const {
+        return numComparisons * m - numComparedComponents;
+    }
+};
+
+// Similitud aproximada usando solo los primeros m componentes de las firmas. Con firmas anidadas
+// (NestedProbMinHash) los primeros m componentes forman una firma válida de tamaño m.
+inline double estimateJaccardPrefix(const std::vector<uint64_t> &sigA, const std::vector<uint64_t> &sigB, size_t m) {
+    assert(m >= 1 && m <= sigA.size() && m <= sigB.size());
+    return double(countEqualComponents(sigA.data(), sigB.data(), m)) / m;
+}
+
+// Resultado de una búsqueda: posición en la base de datos y similitud estimada con la firma completa
+struct SearchResult {
+    size_t index;
+    double similarity;
+};
+
+// Búsqueda de grueso a fino en firmas anidadas con niveles levels (por ejemplo 64, 1024, 4096).
+// En cada nivel se descartan los candidatos cuya similitud estimada con levels[l] componentes está más de
+// z desviaciones estándar bajo el umbral. Los candidatos restantes solo leen los componentes nuevos del
+// siguiente nivel, y en el último nivel se retornan los que alcanzan el umbral. Si numComparedComponents
+// no es nulo, se le suma la cantidad de componentes comparados.
+// La similitud final se estima con la firma anidada completa, que es menos precisa que una firma simple del
+// mismo tamaño (con ProbMinHash4 y niveles 64, 1024, 4096, un MSE de 3.76e-5 frente a 3.20e-5 con 4096
+// registros, ver NestedProbMinHash), y calcularla cuesta una pasada sobre los datos por nivel.
+inline std::vector<SearchResult> searchNested(const std::vector<uint64_t> &query, const std::vector<std::vector<uint64_t>> &database,
+        const std::vector<uint32_t> &levels, double threshold, double z = 3., uint64_t *numComparedComponents = nullptr) {
+    assert(!levels.empty() && levels.back() <= query.size());
+    // candidatos con la cantidad de componentes iguales hasta el nivel anterior
+    std::vector<std::pair<size_t, size_t>> candidates;
+    for (size_t i = 0; i < database.size(); i++) {
+        assert(database[i].size() >= levels.back());
+        candidates.emplace_back(i, 0);
+    }
+    std::vector<SearchResult> results;
+    uint64_t compared = 0;
+    uint32_t previous = 0;
+    for (size_t l = 0; l < levels.size(); l++) {
+        const uint32_t m = levels[l];
+        const bool isLast = (l + 1 == levels.size());
+        // se usa la desviación estándar de la estimación cuando la similitud real es igual al umbral
+        const double limit = isLast ? threshold : threshold - z * std::sqrt(threshold * (1. - threshold) / m);
+        size_t numRemaining = 0;
+        for (auto &c : candidates) {
+            const std::vector<uint64_t> &sig = database[c.first];
+            for (uint32_t i = previous; i < m; i++) {
+                if (query[i] == sig[i]) c.second++;
+            }
+            compared += m - previous;
+            const double sim = double(c.second) / m;
+            if (sim < limit) continue;
+            if (isLast) results.push_back(SearchResult{c.first, sim});
+            else candidates[numRemaining++] = c;
+        }
+        candidates.resize(numRemaining);
+        previous = m;
+    }
+    if (numComparedComponents != nullptr) *numComparedComponents += compared;
+    return results;
+}
+
+#endif // _GENOME_SKETCHING_HPP_
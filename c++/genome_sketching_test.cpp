@@ -0,0 +1,146 @@
+#include "genome_sketching.hpp"
+
+#include <iostream>
+#include <random>
+#include <cassert>
+#include <unordered_map>
+
+using namespace std;
+
+// Verifica que la extracción de k-mers para varios k en una sola pasada coincide
+// con la extracción por separado para cada k (usando substr como en test_probminhash1.cpp).
+
+unordered_map<uint64_t, double> countKmersNaive(const string &genome, uint32_t k) {
+    unordered_map<uint64_t, double> counts;
+    for (size_t i = 0; i + k <= genome.size(); i++) {
+        string kmer = genome.substr(i, k);
+        uint64_t code = 0;
+        bool valid = true;
+        for (char c : kmer) {
+            uint8_t b = encodeBase(c);
+            if (b == INVALID_BASE) {
+                valid = false;
+                break;
+            }
+            code = (code << 2) | b;
+        }
+        if (valid) counts[hashKmer(code, k)] += 1.0;
+    }
+    return counts;
+}
+
+int main(int argc, char* argv[]) {
+
+    mt19937_64 rng(UINT64_C(0x91c3e5a7b20d4f68));
+    const char alphabet[] = "ACGTACGTACGTACGTacgtN";
+
+    const vector<uint32_t> ks = {1, 5, 16, 21, 31, 32};
+
+    for (uint32_t length : {0, 10, 1000, 100000}) {
+        string genome;
+        for (uint32_t i = 0; i < length; i++) genome += alphabet[rng() % (sizeof(alphabet) - 1)];
+
+        auto items = extractWeightedKmers(genome, ks);
+        assert(items.size() == ks.size());
+        for (size_t j = 0; j < ks.size(); j++) {
+            unordered_map<uint64_t, double> counts;
+            for (const auto &item : items[j]) {
+                assert(counts.count(item.element) == 0);
+                counts[item.element] = item.weight;
+            }
+            assert(counts == countKmersNaive(genome, ks[j]));
+        }
+    }
+
+    // las firmas calculadas en una pasada coinciden con las calculadas para cada k por separado
+    string genome;
+    for (uint32_t i = 0; i < 20000; i++) genome += alphabet[rng() % (sizeof(alphabet) - 1)];
+    typedef ProbMinHash1<uint64_t, ExtractFunction, RngFunction, WeightFunction> H;
+    MultiKSketcher<H> sketcher(ks, [](uint32_t) {return new H(64, ExtractFunction(), RngFunction());});
+    auto signatures = sketcher(genome);
+    for (size_t j = 0; j < ks.size(); j++) {
+        H h(64, ExtractFunction(), RngFunction());
+        vector<KmerItem> items;
+        for (const auto &kv : countKmersNaive(genome, ks[j])) items.push_back(KmerItem{kv.first, kv.second});
+        assert(signatures[j] == h(items));
+    }
+
+    // las firmas de varios algoritmos calculadas a partir de un solo conteo coinciden con las de cada algoritmo por separado
+    typedef SuperMinHash<uint64_t, ExtractFunction, RngFunction> U;
+    MultiAlgorithmSketcher multiSketcher(ks);
+    multiSketcher.addAlgorithm<H>("probminhash1", [](uint32_t) {return new H(64, ExtractFunction(), RngFunction());});
+    multiSketcher.addAlgorithm<U>("superminhash", [](uint32_t) {return new U(64, ExtractFunction(), RngFunction());});
+    auto multiSignatures = multiSketcher(genome);
+    assert(multiSignatures.size() == 2);
+    for (size_t j = 0; j < ks.size(); j++) {
+        U u(64, ExtractFunction(), RngFunction());
+        vector<KmerItem> items;
+        for (const auto &kv : countKmersNaive(genome, ks[j])) items.push_back(KmerItem{kv.first, kv.second});
+        assert(multiSignatures[0][j] == signatures[j]);
+        assert(multiSignatures[1][j] == u(items));
+    }
+
+    // búsqueda de grueso a fino: firmas que coinciden con la consulta en una fracción p de los componentes
+    const vector<uint32_t> levels = {64, 1024, 4096};
+    vector<uint64_t> query(levels.back());
+    for (auto &x : query) x = rng();
+    vector<vector<uint64_t>> database;
+    vector<double> fractions;
+    for (uint32_t i = 0; i < 1000; i++) {
+        const double p = (i % 10 == 0) ? 0.95 : double(rng() % 800) / 1000.;
+        vector<uint64_t> sig(levels.back());
+        for (size_t c = 0; c < sig.size(); c++) sig[c] = (double(rng() % 1000000) / 1000000. < p) ? query[c] : rng();
+        database.push_back(sig);
+        fractions.push_back(p);
+    }
+    uint64_t numComparedComponents = 0;
+    const double threshold = 0.9;
+    auto results = searchNested(query, database, levels, threshold, 3., &numComparedComponents);
+    vector<bool> found(database.size());
+    for (const auto &r : results) {
+        assert(r.similarity == estimateJaccard(query, database[r.index]));
+        assert(r.similarity >= threshold);
+        found[r.index] = true;
+    }
+    for (size_t i = 0; i < database.size(); i++) {
+        if (fractions[i] == 0.95) assert(found[i]);
+        else assert(!found[i]);
+    }
+    assert(numComparedComponents < uint64_t(levels.back()) * database.size() / 5);
+    // con un solo nivel se comparan todas las firmas completas
+    numComparedComponents = 0;
+    assert(searchNested(query, database, {levels.back()}, threshold, 3., &numComparedComponents).size() == results.size());
+    assert(numComparedComponents == uint64_t(levels.back()) * database.size());
+
+    // comparación con umbral: coincide con la comparación completa y ahorra componentes
+    for (double errorRate : {1e-2, 1e-4}) {
+        const size_t m = 1024;
+        ThresholdComparator comparator(m, threshold, errorRate);
+        uint64_t numWrong = 0;
+        const uint64_t numPairs = 2000;
+        for (uint64_t i = 0; i < numPairs; i++) {
+            // la mitad de los pares claramente sobre el umbral, la otra mitad bajo el umbral
+            const double p = (i % 2 == 0) ? 0.95 + double(rng() % 50) / 1000. : double(rng() % 850) / 1000.;
+            vector<uint64_t> sigA(m), sigB(m);
+            for (size_t c = 0; c < m; c++) {
+                sigA[c] = rng();
+                sigB[c] = (double(rng() % 1000000) / 1000000. < p) ? sigA[c] : rng();
+            }
+            const auto r = comparator(sigA, sigB);
+            const double full = estimateJaccard(sigA, sigB);
+            assert(r.numCompared >= 1 && r.numCompared <= m);
+            if (r.numCompared == m) assert(r.similar == (full >= threshold) && r.similarity == full);
+            if (r.similar != (full >= threshold)) numWrong++;
+        }
+        assert(comparator.getNumComparisons() == numPairs);
+        assert(comparator.getNumComparedComponents() + comparator.getNumSavedComponents() == numPairs * m);
+        assert(numWrong <= errorRate * numPairs * 5 + 1);
+        // más de la mitad de los componentes no se comparan
+        assert(comparator.getNumSavedComponents() > numPairs * m / 2);
+        cout << "errorRate = " << errorRate << ", decisiones distintas = " << numWrong << ", componentes ahorrados = ";
+        cout << double(comparator.getNumSavedComponents()) / (numPairs * m) << endl;
+    }
+
+    cout << "OK" << endl;
+    return 0;
+}
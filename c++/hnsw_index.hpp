@@ -0,0 +1,303 @@
+#ifndef _HNSW_INDEX_HPP_
+#define _HNSW_INDEX_HPP_
+
+#include "signature_comparison.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+// Hierarchical navigable small world graph (Malkov and Yashunin, 2018) over signatures for approximate top-k queries.
+//
+// The distance of two signatures is the number of different components, m minus the number of equal components as
+// counted by countEqualComponents, hence the nearest neighbors are those with the largest Jaccard estimate. Every
+// signature is assigned to the layers 0, ..., l with l geometrically distributed, and is connected to at most
+// maxNeighbors neighbors per layer (2 * maxNeighbors in layer 0), selected by the heuristic of the paper that prefers
+// neighbors in different directions. A query descends greedily from the single node of the highest layer and searches
+// layer 0 with a candidate list of size ef, which takes logarithmic time in the number of signatures.
+//
+// The distance is saturated at m for signatures without equal components. The graph cannot guide the search between
+// groups of genomes that do not share any components, hence the index is intended for collections of related genomes,
+// e.g. of the same species or genus, and a larger ef is needed if the collection contains many unrelated groups.
+//
+// Insertions must not run concurrently with queries. add(signatures, n) inserts a batch in parallel, every node is
+// locked while its neighbor lists are read or updated.
+class HnswIndex {
+
+    struct Node {
+        uint32_t level;
+        std::vector<std::vector<uint32_t>> neighbors; // neighbors[l] are the neighbors in layer l
+    };
+
+    // (distance, id)
+    typedef std::pair<uint32_t, uint32_t> Candidate;
+
+    // marks of visited nodes, a node is visited if its mark equals the current tag, such that the marks need not be
+    // cleared for every search
+    struct VisitedList {
+        std::vector<uint32_t> marks;
+        uint32_t tag = 0;
+    };
+
+    const uint32_t m;
+    const uint32_t maxNeighbors;
+    const uint32_t efConstruction;
+    const double levelMultiplier;
+    const SimdLevel simdLevel;
+    std::mt19937_64 rng;
+
+    std::vector<uint64_t> signatures;
+    std::vector<Node> nodes;
+    mutable std::deque<std::mutex> nodeMutexes;
+    std::mutex entryPointMutex;
+    uint32_t entryPoint = 0;
+    uint32_t maxLevel = 0;
+    bool isEmpty = true;
+
+    mutable std::mutex visitedListsMutex;
+    mutable std::vector<std::unique_ptr<VisitedList>> visitedLists;
+
+    uint32_t getMaxNeighbors(uint32_t level) const {
+        return (level == 0) ? 2 * maxNeighbors : maxNeighbors;
+    }
+
+    uint32_t getDistance(const uint64_t* query, uint32_t id) const {
+        return m - countEqualComponents(query, signatures.data() + static_cast<uint64_t>(id) * m, m, simdLevel);
+    }
+
+    std::vector<uint32_t> getNeighbors(uint32_t id, uint32_t level) const {
+        std::lock_guard<std::mutex> lock(nodeMutexes[id]);
+        return nodes[id].neighbors[level];
+    }
+
+    std::unique_ptr<VisitedList> acquireVisitedList() const {
+        std::unique_ptr<VisitedList> visited;
+        {
+            std::lock_guard<std::mutex> lock(visitedListsMutex);
+            if (!visitedLists.empty()) {
+                visited = std::move(visitedLists.back());
+                visitedLists.pop_back();
+            }
+        }
+        if (!visited) visited.reset(new VisitedList());
+        if (visited->marks.size() < nodes.size()) visited->marks.resize(nodes.size(), visited->tag);
+        visited->tag += 1;
+        if (visited->tag == 0) {
+            std::fill(visited->marks.begin(), visited->marks.end(), 0);
+            visited->tag = 1;
+        }
+        return visited;
+    }
+
+    void releaseVisitedList(std::unique_ptr<VisitedList> visited) const {
+        std::lock_guard<std::mutex> lock(visitedListsMutex);
+        visitedLists.push_back(std::move(visited));
+    }
+
+    // moves greedily to the nearest neighbor in the given layer until no neighbor is closer
+    Candidate searchGreedy(const uint64_t* query, Candidate current, uint32_t level) const {
+        bool isChanged = true;
+        while (isChanged) {
+            isChanged = false;
+            for (uint32_t neighbor : getNeighbors(current.second, level)) {
+                const uint32_t distance = getDistance(query, neighbor);
+                if (distance < current.first) {
+                    current = Candidate(distance, neighbor);
+                    isChanged = true;
+                }
+            }
+        }
+        return current;
+    }
+
+    // returns the at most ef nearest nodes found in the given layer in ascending order of distance
+    std::vector<Candidate> searchLayer(const uint64_t* query, Candidate entry, uint32_t level, uint32_t ef) const {
+        std::unique_ptr<VisitedList> visited = acquireVisitedList();
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+        std::priority_queue<Candidate> nearest;
+        visited->marks[entry.second] = visited->tag;
+        candidates.push(entry);
+        nearest.push(entry);
+        while (!candidates.empty()) {
+            const Candidate current = candidates.top();
+            if (current.first > nearest.top().first) break;
+            candidates.pop();
+            for (uint32_t neighbor : getNeighbors(current.second, level)) {
+                if (visited->marks[neighbor] == visited->tag) continue;
+                visited->marks[neighbor] = visited->tag;
+                const uint32_t distance = getDistance(query, neighbor);
+                if (nearest.size() < ef || distance < nearest.top().first) {
+                    candidates.emplace(distance, neighbor);
+                    nearest.emplace(distance, neighbor);
+                    if (nearest.size() > ef) nearest.pop();
+                }
+            }
+        }
+        releaseVisitedList(std::move(visited));
+        std::vector<Candidate> result(nearest.size());
+        for (auto it = result.rbegin(); it != result.rend(); ++it) {
+            *it = nearest.top();
+            nearest.pop();
+        }
+        return result;
+    }
+
+    // Selects at most maxCount of the candidates given in ascending order of distance. A candidate is skipped if it is
+    // closer to an already selected neighbor than to the base node, such that the neighbors point in different directions.
+    std::vector<uint32_t> selectNeighbors(const std::vector<Candidate>& candidates, uint32_t maxCount) const {
+        std::vector<uint32_t> selected;
+        for (const Candidate& candidate : candidates) {
+            if (selected.size() >= maxCount) break;
+            const uint64_t* signature = signatures.data() + static_cast<uint64_t>(candidate.second) * m;
+            bool isGood = true;
+            for (uint32_t s : selected) {
+                if (getDistance(signature, s) < candidate.first) {
+                    isGood = false;
+                    break;
+                }
+            }
+            if (isGood) selected.push_back(candidate.second);
+        }
+        return selected;
+    }
+
+    // adds a node with a random level and empty neighbor lists, which is not yet reachable from the graph
+    uint32_t allocate(const uint64_t* signature) {
+        assert(nodes.size() < UINT32_MAX);
+        const uint32_t id = nodes.size();
+        signatures.insert(signatures.end(), signature, signature + m);
+        const double u = std::uniform_real_distribution<double>(0., 1.)(rng);
+        const uint32_t level = static_cast<uint32_t>(-std::log1p(-u) * levelMultiplier);
+        nodes.push_back(Node{level, std::vector<std::vector<uint32_t>>(level + 1)});
+        nodeMutexes.emplace_back();
+        return id;
+    }
+
+    // connects an allocated node to the graph, may run concurrently for different nodes
+    void link(uint32_t id) {
+        const uint64_t* signature = signatures.data() + static_cast<uint64_t>(id) * m;
+        const uint32_t level = nodes[id].level;
+        // the entry point remains locked while inserting a node with a new highest level
+        std::unique_lock<std::mutex> entryPointLock(entryPointMutex);
+        if (isEmpty) {
+            entryPoint = id;
+            maxLevel = level;
+            isEmpty = false;
+            return;
+        }
+        const uint32_t currentMaxLevel = maxLevel;
+        Candidate current(getDistance(signature, entryPoint), entryPoint);
+        if (level <= currentMaxLevel) entryPointLock.unlock();
+
+        for (uint32_t l = currentMaxLevel; l > level; --l) current = searchGreedy(signature, current, l);
+        for (uint32_t l = std::min(level, currentMaxLevel) + 1; l-- > 0; ) {
+            std::vector<Candidate> candidates = searchLayer(signature, current, l, efConstruction);
+            // concurrent insertions may already have linked the node in this layer
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [id](const Candidate& c) {return c.second == id;}), candidates.end());
+            if (candidates.empty()) continue;
+            const std::vector<uint32_t> selected = selectNeighbors(candidates, maxNeighbors);
+            {
+                std::lock_guard<std::mutex> lock(nodeMutexes[id]);
+                nodes[id].neighbors[l] = selected;
+            }
+            for (uint32_t neighbor : selected) {
+                const uint64_t* neighborSignature = signatures.data() + static_cast<uint64_t>(neighbor) * m;
+                std::lock_guard<std::mutex> lock(nodeMutexes[neighbor]);
+                std::vector<uint32_t>& neighbors = nodes[neighbor].neighbors[l];
+                if (neighbors.size() < getMaxNeighbors(l)) {
+                    neighbors.push_back(id);
+                    continue;
+                }
+                std::vector<Candidate> neighborCandidates;
+                neighborCandidates.reserve(neighbors.size() + 1);
+                neighborCandidates.emplace_back(getDistance(neighborSignature, id), id);
+                for (uint32_t n : neighbors) neighborCandidates.emplace_back(getDistance(neighborSignature, n), n);
+                std::sort(neighborCandidates.begin(), neighborCandidates.end());
+                neighbors = selectNeighbors(neighborCandidates, getMaxNeighbors(l));
+            }
+            current = candidates.front();
+        }
+        if (level > currentMaxLevel) {
+            entryPoint = id;
+            maxLevel = level;
+        }
+    }
+
+public:
+
+    struct Hit {
+        uint64_t id;
+        uint32_t count; // number of equal components
+    };
+
+    // m is the signature size, maxNeighbors the maximum number of neighbors per node in layers above 0 (M in the
+    // paper), efConstruction the size of the candidate list when inserting
+    explicit HnswIndex(uint32_t m, uint32_t maxNeighbors = 16, uint32_t efConstruction = 100, uint64_t seed = 0) :
+            m(m), maxNeighbors(maxNeighbors), efConstruction(efConstruction), levelMultiplier(1. / std::log(std::max(maxNeighbors, UINT32_C(2)))),
+            simdLevel(getSupportedSimdLevel()), rng(seed) {
+        assert(maxNeighbors > 0 && efConstruction > 0);
+    }
+
+    HnswIndex(const HnswIndex&) = delete;
+    HnswIndex& operator=(const HnswIndex&) = delete;
+
+    void reserve(uint64_t n) {
+        signatures.reserve(n * m);
+        nodes.reserve(n);
+    }
+
+    // inserts a signature of size m and returns its id (0, 1, 2, ...)
+    uint64_t add(const uint64_t* signature) {
+        const uint32_t id = allocate(signature);
+        link(id);
+        return id;
+    }
+
+    // inserts n signatures of size m stored contiguously in parallel, signature j starts at signatures + j * m,
+    // and gets the id size() + j
+    void add(const uint64_t* signatures, uint64_t n) {
+        const uint64_t first = size();
+        reserve(first + n);
+        for (uint64_t j = 0; j < n; ++j) allocate(signatures + j * m);
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 16))
+        for (int64_t j = 0; j < static_cast<int64_t>(n); ++j) link(static_cast<uint32_t>(first + j));
+    }
+
+    uint64_t size() const {
+        return nodes.size();
+    }
+
+    uint32_t getSignatureSize() const {
+        return m;
+    }
+
+    const uint64_t* getSignature(uint64_t id) const {
+        return signatures.data() + id * m;
+    }
+
+    // Returns approximately the k signatures with the most equal components with the query, ordered by decreasing
+    // count and increasing id. ef is the size of the candidate list, larger values increase recall and query time.
+    // Multiple queries may run concurrently.
+    std::vector<Hit> query(const uint64_t* query, uint64_t k, uint32_t ef = 64) const {
+        std::vector<Hit> hits;
+        if (isEmpty || k == 0) return hits;
+        Candidate current(getDistance(query, entryPoint), entryPoint);
+        for (uint32_t l = maxLevel; l > 0; --l) current = searchGreedy(query, current, l);
+        const std::vector<Candidate> candidates = searchLayer(query, current, 0, std::max(static_cast<uint64_t>(ef), k));
+        for (const Candidate& candidate : candidates) {
+            if (hits.size() >= k) break;
+            hits.push_back(Hit{candidate.second, m - candidate.first});
+        }
+        return hits;
+    }
+};
+
+#endif // _HNSW_INDEX_HPP_
@@ -0,0 +1,128 @@
+#include "hnsw_index.hpp"
+#include "signature_comparison.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+// Measures the recall@10 of the approximate nearest neighbor graph against an exact scan of all signatures, for
+// sequential and parallel construction, and compares the query time with the scan.
+
+// Signatures of a hierarchy of related genomes, every signature is derived from one of numFamilies family
+// signatures, which are derived from a common ancestor, and copies each component of its parent with the given
+// probability.
+struct GenomeGenerator {
+    const uint32_t m;
+    mt19937_64 rng;
+    vector<uint64_t> ancestor;
+    vector<vector<uint64_t>> subfamilies;
+
+    GenomeGenerator(uint32_t m, uint64_t numFamilies, uint64_t numSubfamilies, uint64_t seed) : m(m), rng(seed) {
+        ancestor = derive(vector<uint64_t>(m), 0.);
+        for(uint64_t f = 0; f < numFamilies; ++f) {
+            const vector<uint64_t> family = derive(ancestor, 0.4);
+            for(uint64_t s = 0; s < numSubfamilies; ++s) subfamilies.push_back(derive(family, 0.6));
+        }
+    }
+
+    vector<uint64_t> derive(const vector<uint64_t>& parent, double p) {
+        vector<uint64_t> signature(m);
+        for(uint32_t i = 0; i < m; ++i) signature[i] = (uniform_real_distribution<double>(0., 1.)(rng) < p) ? parent[i] : rng();
+        return signature;
+    }
+
+    // appends n genomes to signatures
+    void generate(uint64_t n, vector<uint64_t>& signatures) {
+        for(uint64_t j = 0; j < n; ++j) {
+            const double p = uniform_real_distribution<double>(0.7, 0.95)(rng);
+            const vector<uint64_t> signature = derive(subfamilies[rng() % subfamilies.size()], p);
+            signatures.insert(signatures.end(), signature.begin(), signature.end());
+        }
+    }
+};
+
+// fraction of the hits with a count at least as large as the count of the k-th nearest signature
+double getRecall(const vector<HnswIndex::Hit>& hits, const vector<uint32_t>& counts, uint64_t k) {
+    vector<uint32_t> sortedCounts(counts);
+    sort(sortedCounts.begin(), sortedCounts.end(), greater<uint32_t>());
+    const uint32_t minCount = sortedCounts[min(k, static_cast<uint64_t>(sortedCounts.size())) - 1];
+    uint64_t numFound = 0;
+    for(const auto& hit : hits) {
+        assert(hit.count == counts[hit.id]);
+        if (hit.count >= minCount) numFound += 1;
+    }
+    return double(numFound) / min(k, static_cast<uint64_t>(counts.size()));
+}
+
+int main() {
+
+    // small indices, every signature must find itself, and all signatures are returned if k is larger than n
+    {
+        mt19937_64 rng(UINT64_C(0x3b1f5e0c9d2a4876));
+        const uint32_t m = 16;
+        HnswIndex index(m, 4, 16);
+        assert(index.query(vector<uint64_t>(m).data(), 10).empty());
+        vector<uint64_t> signatures;
+        for(uint64_t j = 0; j < 50; ++j) {
+            for(uint32_t i = 0; i < m; ++i) signatures.push_back(rng() % 4);
+            assert(index.add(signatures.data() + j * m) == j);
+        }
+        for(uint64_t j = 0; j < 50; ++j) {
+            const auto hits = index.query(signatures.data() + j * m, 100, 100);
+            assert(hits.size() == 50);
+            assert(hits[0].count == m);
+            for(uint64_t h = 1; h < hits.size(); ++h) {
+                assert(hits[h - 1].count > hits[h].count || (hits[h - 1].count == hits[h].count && hits[h - 1].id < hits[h].id));
+            }
+        }
+    }
+
+    const uint64_t k = 10;
+    const uint64_t numQueries = 200;
+    for(uint64_t n : {2000, 20000}) {
+        const uint32_t m = 128;
+        GenomeGenerator generator(m, 20, n / 500, n);
+        vector<uint64_t> signatures;
+        generator.generate(n, signatures);
+        vector<uint64_t> queries;
+        generator.generate(numQueries, queries);
+
+        for(bool isParallel : {false, true}) {
+            HnswIndex index(m);
+            auto start = chrono::steady_clock::now();
+            if (isParallel) {
+                index.add(signatures.data(), n);
+            }
+            else {
+                for(uint64_t j = 0; j < n; ++j) index.add(signatures.data() + j * m);
+            }
+            auto built = chrono::steady_clock::now();
+            assert(index.size() == n);
+
+            double recall = 0;
+            vector<vector<HnswIndex::Hit>> results(numQueries);
+            auto queried = chrono::steady_clock::now();
+            for(uint64_t q = 0; q < numQueries; ++q) results[q] = index.query(queries.data() + q * m, k);
+            auto end = chrono::steady_clock::now();
+            vector<uint32_t> counts(n);
+            for(uint64_t q = 0; q < numQueries; ++q) countEqualComponentsOneToMany(queries.data() + q * m, signatures.data(), index.size(), m, counts.data());
+            auto scanned = chrono::steady_clock::now();
+            for(uint64_t q = 0; q < numQueries; ++q) {
+                countEqualComponentsOneToMany(queries.data() + q * m, signatures.data(), index.size(), m, counts.data());
+                recall += getRecall(results[q], counts, k);
+            }
+            recall /= numQueries;
+            cout << "n = " << n << ", m = " << m << (isParallel ? ", parallel" : ", sequential") << " build = " << chrono::duration<double>(built - start).count() << " s";
+            cout << ", recall@" << k << " = " << recall << ", query = " << chrono::duration<double>(end - queried).count() / numQueries * 1e3 << " ms";
+            cout << ", scan = " << chrono::duration<double>(scanned - end).count() / numQueries * 1e3 << " ms" << endl;
+            assert(recall > 0.95);
+        }
+    }
+
+    return 0;
+}
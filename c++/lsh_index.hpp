@@ -0,0 +1,156 @@
+#ifndef _LSH_INDEX_HPP_
+#define _LSH_INDEX_HPP_
+
+#include "wyhash/wyhash.h"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+// Locality-sensitive hashing with the banding technique as described in
+// Jure Leskovec, Anand Rajaraman, Jeffrey D. Ullman. 2014. Mining of Massive Datasets. Chapter 3.4
+//
+// The first numBands * numRows components of a signature computed by any of the algorithms in minhash.hpp are
+// split into numBands bands of numRows components. Every band is hashed to a 64-bit key. Two signatures with
+// Jaccard similarity J share the key of at least one band with probability 1 - (1 - J^numRows)^numBands, only those
+// pairs are candidates for an exact comparison. Instead of hash tables, the (key, id) pairs of every band are sorted,
+// such that the buckets are runs of equal keys, which needs less memory and is easy to parallelize.
+
+// probability that two signatures with Jaccard similarity j become a candidate pair
+inline double getLshCandidateProbability(double j, uint32_t numBands, uint32_t numRows) {
+    return 1. - std::pow(1. - std::pow(j, numRows), numBands);
+}
+
+// Returns numBands and numRows with numBands * numRows <= m minimizing the weighted sum of the false positive
+// probability integrated over similarities below the threshold and the false negative probability integrated
+// over similarities above the threshold.
+inline std::pair<uint32_t, uint32_t> getOptimalLshParameters(uint32_t m, double threshold, double falsePositiveWeight = 0.5, double falseNegativeWeight = 0.5) {
+    assert(m >= 1 && threshold > 0 && threshold < 1);
+    const uint32_t numIntegrationSteps = 200;
+    // midpoint rule
+    auto integrate = [numIntegrationSteps](double a, double b, auto&& f) {
+        const double step = (b - a) / numIntegrationSteps;
+        double sum = 0;
+        for(uint32_t i = 0; i < numIntegrationSteps; ++i) sum += f(a + (i + 0.5) * step);
+        return sum * step;
+    };
+    std::pair<uint32_t, uint32_t> best(1, 1);
+    double bestError = std::numeric_limits<double>::infinity();
+    for(uint32_t numBands = 1; numBands <= m; ++numBands) {
+        for(uint32_t numRows = 1; numBands * numRows <= m; ++numRows) {
+            const double falsePositives = integrate(0., threshold, [&](double j) {return getLshCandidateProbability(j, numBands, numRows);});
+            const double falseNegatives = integrate(threshold, 1., [&](double j) {return 1. - getLshCandidateProbability(j, numBands, numRows);});
+            const double error = falsePositiveWeight * falsePositives + falseNegativeWeight * falseNegatives;
+            if (error < bestError) {
+                bestError = error;
+                best = std::make_pair(numBands, numRows);
+            }
+        }
+    }
+    return best;
+}
+
+class LshIndex {
+    const uint32_t numBands;
+    const uint32_t numRows;
+    uint32_t numSignatures;
+    bool isBuilt;
+    // buckets[band] contains the (key, id) pairs of all signatures, sorted by key after build()
+    std::vector<std::vector<std::pair<uint64_t, uint32_t>>> buckets;
+
+    uint64_t getKey(const uint64_t* signature, uint32_t band) const {
+        return wyhash(signature + band * numRows, numRows * sizeof(uint64_t), band);
+    }
+
+public:
+
+    LshIndex(uint32_t numBands, uint32_t numRows) : numBands(numBands), numRows(numRows), numSignatures(0), isBuilt(false), buckets(numBands) {
+        assert(numBands >= 1 && numRows >= 1);
+    }
+
+    uint32_t getNumBands() const {
+        return numBands;
+    }
+
+    uint32_t getNumRows() const {
+        return numRows;
+    }
+
+    uint32_t size() const {
+        return numSignatures;
+    }
+
+    // adds a signature with at least numBands * numRows components and returns its id (0, 1, 2, ...)
+    uint32_t add(const uint64_t* signature) {
+        const uint32_t id = numSignatures++;
+        for(uint32_t band = 0; band < numBands; ++band) buckets[band].emplace_back(getKey(signature, band), id);
+        isBuilt = false;
+        return id;
+    }
+
+    // sorts the buckets, must be called after adding signatures and before any query
+    void build() {
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for(int64_t band = 0; band < static_cast<int64_t>(numBands); ++band) {
+            std::sort(buckets[band].begin(), buckets[band].end());
+        }
+        isBuilt = true;
+    }
+
+    // Returns all pairs (i, j) with i < j that share the key of at least one band, sorted and without duplicates.
+    // Buckets with more than maxBucketSize signatures are skipped, which bounds the number of pairs for
+    // degenerate inputs like many empty signatures.
+    std::vector<std::pair<uint32_t, uint32_t>> getCandidatePairs(uint64_t maxBucketSize = UINT64_MAX) const {
+        assert(isBuilt);
+        std::vector<std::vector<uint64_t>> bandPairs(numBands);
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for(int64_t band = 0; band < static_cast<int64_t>(numBands); ++band) {
+            const auto& b = buckets[band];
+            std::vector<uint64_t>& pairs = bandPairs[band];
+            for(uint64_t begin = 0; begin < b.size(); ) {
+                uint64_t end = begin + 1;
+                while(end < b.size() && b[end].first == b[begin].first) ++end;
+                if (end - begin <= maxBucketSize) {
+                    // ids within a bucket are sorted as the pairs are sorted by key and id
+                    for(uint64_t x = begin; x < end; ++x) {
+                        for(uint64_t y = x + 1; y < end; ++y) pairs.push_back((static_cast<uint64_t>(b[x].second) << 32) | b[y].second);
+                    }
+                }
+                begin = end;
+            }
+        }
+        std::vector<uint64_t> allPairs;
+        for(auto& pairs : bandPairs) {
+            allPairs.insert(allPairs.end(), pairs.begin(), pairs.end());
+            std::vector<uint64_t>().swap(pairs);
+        }
+        std::sort(allPairs.begin(), allPairs.end());
+        allPairs.erase(std::unique(allPairs.begin(), allPairs.end()), allPairs.end());
+        std::vector<std::pair<uint32_t, uint32_t>> result;
+        result.reserve(allPairs.size());
+        for(uint64_t p : allPairs) result.emplace_back(static_cast<uint32_t>(p >> 32), static_cast<uint32_t>(p));
+        return result;
+    }
+
+    // returns the sorted ids of all indexed signatures sharing the key of at least one band with the given signature
+    std::vector<uint32_t> getCandidates(const uint64_t* signature) const {
+        assert(isBuilt);
+        std::vector<uint32_t> result;
+        for(uint32_t band = 0; band < numBands; ++band) {
+            const uint64_t key = getKey(signature, band);
+            const auto& b = buckets[band];
+            auto it = std::lower_bound(b.begin(), b.end(), std::make_pair(key, uint32_t(0)));
+            for(; it != b.end() && it->first == key; ++it) result.push_back(it->second);
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+};
+
+#endif // _LSH_INDEX_HPP_
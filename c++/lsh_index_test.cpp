@@ -0,0 +1,115 @@
+#include "lsh_index.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+// Checks the candidate pairs of the LSH index against a naive comparison of all band keys, checks the recall
+// for pairs above the threshold, and reports the time needed to generate the candidates for many signatures.
+
+// signature that shares every component with the given signature with probability p
+vector<uint64_t> mutate(mt19937_64& rng, const vector<uint64_t>& signature, double p) {
+    vector<uint64_t> result(signature);
+    for(auto& x : result) if (uniform_real_distribution<double>(0., 1.)(rng) >= p) x = rng();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+
+    mt19937_64 rng(UINT64_C(0x1f9c3a7e60b2d548));
+
+    // parameters
+    for(uint32_t m : {16, 128, 1024}) {
+        for(double threshold : {0.5, 0.8, 0.9}) {
+            const auto parameters = getOptimalLshParameters(m, threshold);
+            assert(parameters.first * parameters.second <= m);
+            // pairs well above the threshold are very likely candidates, pairs well below unlikely
+            if (m >= 128) {
+                assert(getLshCandidateProbability(min(1., threshold + 0.1), parameters.first, parameters.second) > 0.8);
+                assert(getLshCandidateProbability(threshold - 0.2, parameters.first, parameters.second) < 0.1);
+            }
+            cout << "m = " << m << ", threshold = " << threshold << ", bands = " << parameters.first << ", rows = " << parameters.second;
+            cout << ", P(candidate | J = threshold) = " << getLshCandidateProbability(threshold, parameters.first, parameters.second) << endl;
+        }
+    }
+
+    // candidate pairs compared with a naive implementation, components from a small alphabet to get collisions
+    {
+        const uint32_t m = 12;
+        const uint32_t numBands = 4;
+        const uint32_t numRows = 3;
+        const uint32_t n = 500;
+        vector<vector<uint64_t>> signatures(n, vector<uint64_t>(m));
+        for(auto& s : signatures) for(auto& x : s) x = rng() % 3;
+        LshIndex index(numBands, numRows);
+        for(const auto& s : signatures) index.add(s.data());
+        index.build();
+        set<pair<uint32_t, uint32_t>> expected;
+        for(uint32_t i = 0; i < n; ++i) {
+            for(uint32_t j = i + 1; j < n; ++j) {
+                for(uint32_t band = 0; band < numBands; ++band) {
+                    if (equal(signatures[i].begin() + band * numRows, signatures[i].begin() + (band + 1) * numRows, signatures[j].begin() + band * numRows)) {
+                        expected.emplace(i, j);
+                        break;
+                    }
+                }
+            }
+        }
+        const auto candidates = index.getCandidatePairs();
+        assert((set<pair<uint32_t, uint32_t>>(candidates.begin(), candidates.end()) == expected));
+        assert(candidates.size() == expected.size());
+        for(uint32_t i = 0; i < n; ++i) {
+            vector<uint32_t> expectedCandidates;
+            for(uint32_t j = 0; j < n; ++j) if (i == j || expected.count(make_pair(min(i, j), max(i, j)))) expectedCandidates.push_back(j);
+            assert(index.getCandidates(signatures[i].data()) == expectedCandidates);
+        }
+        // large buckets are skipped
+        assert(index.getCandidatePairs(1).empty());
+    }
+
+    // recall of pairs above the threshold and time for many signatures, every tenth signature has a similar partner
+    {
+        const uint32_t m = 128;
+        const double threshold = 0.9;
+        const uint32_t n = 200000;
+        const auto parameters = getOptimalLshParameters(m, threshold);
+        LshIndex index(parameters.first, parameters.second);
+        auto start = chrono::steady_clock::now();
+        vector<uint64_t> previous;
+        set<pair<uint32_t, uint32_t>> similarPairs;
+        for(uint32_t i = 0; i < n; ++i) {
+            vector<uint64_t> s(m);
+            if (i % 10 == 1) {
+                s = mutate(rng, previous, 0.95);
+                similarPairs.emplace(i - 1, i);
+            }
+            else {
+                for(auto& x : s) x = rng();
+            }
+            index.add(s.data());
+            previous.swap(s);
+        }
+        auto added = chrono::steady_clock::now();
+        index.build();
+        const auto candidates = index.getCandidatePairs();
+        auto end = chrono::steady_clock::now();
+        uint32_t numFound = 0;
+        for(const auto& p : candidates) numFound += similarPairs.count(p);
+        const double recall = static_cast<double>(numFound) / similarPairs.size();
+        const double expectedRecall = getLshCandidateProbability(0.95, parameters.first, parameters.second);
+        cout << "n = " << n << ", m = " << m << ", bands = " << parameters.first << ", rows = " << parameters.second;
+        cout << ", candidates = " << candidates.size() << ", recall of pairs with J = 0.95 = " << recall << " (expected " << expectedRecall << ")";
+        cout << ", generation and hashing = " << chrono::duration<double>(added - start).count() << " s";
+        cout << ", sorting and pairs = " << chrono::duration<double>(end - added).count() << " s" << endl;
+        assert(abs(recall - expectedRecall) < 0.02);
+        // random pairs are almost never candidates
+        assert(candidates.size() < numFound + 100);
+    }
+
+    return 0;
+}
@@ -8,24 +8,32 @@
 
 #include "bitstream_random.hpp"
 #include "exponential_distribution.hpp"
+#include "precision_policy.hpp"
+#include "omp_pragma.hpp"
 
 #include <vector>
 #include <limits>
 #include <algorithm>
 #include <unordered_map>
 #include <numeric>
+#include <cstring>
+#include <memory>
 
-template <typename T>
+template <typename T, typename S = DynamicSize>
 class MaxValueTracker {
-    const uint32_t m;
-    const uint32_t lastIndex;
-    const std::unique_ptr<T[]> values; 
+    const S m;
+    RegisterArray<T, (S::fixedValue > 0) ? (S::fixedValue << 1) - 1 : 0> values;
+
+    // constant if the signature size is fixed at compile time
+    uint32_t getLastIndex() const {
+        return (m << 1) - 2;
+    }
 
 public:
-    MaxValueTracker(uint32_t m) : m(m), lastIndex((m << 1) - 2), values(new T[lastIndex+1]) {}
+    MaxValueTracker(S m) : m(m), values((m << 1) - 1) {}
 
     void reset(const T& infinity) {
-        std::fill_n(values.get(), lastIndex + 1, infinity);
+        std::fill_n(values.get(), getLastIndex() + 1, infinity);
     }
 
     bool update(uint32_t idx, T value) {
@@ -34,7 +42,7 @@ public:
             while(true) {
                 values[idx] = value;
                 const uint32_t parentIdx = m + (idx >> 1);
-                if (parentIdx > lastIndex) break;
+                if (parentIdx > getLastIndex()) break;
                 const uint32_t siblingIdx = idx ^ UINT32_C(1);
                 const T siblingValue = values[siblingIdx];
                 if (!(siblingValue < values[parentIdx])) break;
@@ -49,7 +57,84 @@ public:
     }
 
     bool isUpdatePossible(T value) const {
-        return value < values[lastIndex];
+        return value < values[getLastIndex()];
+    }
+};
+
+// Monotone priority queue (radix heap) for non-negative double keys, whose bit patterns are ordered like unsigned integers.
+// Only the upper 16 bits of the keys (sign, exponent, and 4 bits of the significand) are used for ordering, which keeps
+// the number of buckets and redistributions small. Hence, getMinKey() returns a lower bound of the smallest key, and the
+// relative order of elements with nearly equal keys is arbitrary. Pushed keys must not be smaller than the last result of getMinKey().
+template <typename T>
+class RadixHeap {
+    std::vector<std::pair<uint32_t, T>> buckets[17];
+    uint32_t last;
+    uint64_t count;
+
+    static uint32_t toBits(double key) {
+        uint64_t bits;
+        std::memcpy(&bits, &key, sizeof(uint64_t));
+        return static_cast<uint32_t>(bits >> 48);
+    }
+
+    static double fromBits(uint32_t bits) {
+        const uint64_t extendedBits = static_cast<uint64_t>(bits) << 48;
+        double key;
+        std::memcpy(&key, &extendedBits, sizeof(uint64_t));
+        return key;
+    }
+
+    static uint32_t getBucketIndex(uint32_t bits, uint32_t last) {
+        return (bits == last) ? 0 : 32 - __builtin_clz(bits ^ last);
+    }
+
+public:
+    RadixHeap() : last(0), count(0) {}
+
+    void clear() {
+        for(auto& bucket : buckets) bucket.clear();
+        last = 0;
+        count = 0;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    uint64_t size() const {
+        return count;
+    }
+
+    void push(double key, const T& value) {
+        assert(key >= 0);
+        const uint32_t bits = toBits(key);
+        assert(bits >= last);
+        buckets[getBucketIndex(bits, last)].emplace_back(bits, value);
+        count += 1;
+    }
+
+    // must not be called if empty
+    double getMinKey() {
+        assert(!empty());
+        if (buckets[0].empty()) {
+            uint32_t i = 1;
+            while(buckets[i].empty()) ++i;
+            uint32_t newLast = std::numeric_limits<uint32_t>::max();
+            for(const auto& entry : buckets[i]) newLast = std::min(newLast, entry.first);
+            last = newLast;
+            for(const auto& entry : buckets[i]) buckets[getBucketIndex(entry.first, last)].push_back(entry);
+            buckets[i].clear();
+        }
+        return fromBits(last);
+    }
+
+    // removes an element with minimum (truncated) key, requires a preceding call of getMinKey()
+    T pop() {
+        assert(!buckets[0].empty());
+        T value = buckets[0].back().second;
+        buckets[0].pop_back();
+        count -= 1;
+        return value;
     }
 };
 
@@ -219,24 +304,24 @@ public:
     }
 };
 
-template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
 class ProbMinHash1 {
     constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
 
-    const uint32_t m;
+    const S m;
     const E extractFunction;
     const R rngFunction;
     const W weightFunction;
 
-    MaxValueTracker<double> q;
+    MaxValueTracker<typename P::RegisterType, S> q;
 
     void reset() {
-        q.reset(std::numeric_limits<double>::infinity());
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
     }
 
 public:
 
-    ProbMinHash1(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m)  {}
+    ProbMinHash1(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m)  {}
 
     template<typename X>
     std::vector<D> operator()(const X& data) {
@@ -257,11 +342,11 @@ public:
             
             double h;
             if constexpr(isWeighted) h = wInv * ziggurat::getExponential(rng); else h = ziggurat::getExponential(rng);
-            while(q.isUpdatePossible(h)) {
+            while(q.isUpdatePossible(P::toRegister(h))) {
                 uint32_t k = getUniformLemire(m, rng);
-                if (q.update(k, h)) {
+                if (q.update(k, P::toRegister(h))) {
                     result[k] = d;
-                    if (!q.isUpdatePossible(h)) break;
+                    if (!q.isUpdatePossible(P::toRegister(h))) break;
                 }
                 if constexpr(isWeighted) h += wInv * ziggurat::getExponential(rng); else h += ziggurat::getExponential(rng);
             }
@@ -272,28 +357,28 @@ public:
 };
 
 
-template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
 class ProbMinHash1a {
     constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
     typedef typename std::conditional<isWeighted, std::tuple<D, double, typename std::result_of<R(D)>::type, double>, std::tuple<D, double, typename std::result_of<R(D)>::type>>::type bufferType;
     
-    const uint32_t m;
+    const S m;
     const E extractFunction;
     const R rngFunction;
     const W weightFunction;
 
-    MaxValueTracker<double> q;
+    MaxValueTracker<typename P::RegisterType, S> q;
     std::vector<bufferType> buffer;
     uint64_t maxBufferSize;
     
     void reset() {
-        q.reset(std::numeric_limits<double>::infinity());
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
         buffer.clear();
     }
 
 public:
 
-    ProbMinHash1a(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m)  {}
+    ProbMinHash1a(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m)  {}
 
     uint64_t getMaxBufferSize() const {
         return maxBufferSize;
@@ -317,11 +402,11 @@ public:
             auto rng = rngFunction(d);
             double h;
             if constexpr(isWeighted) h = wInv * ziggurat::getExponential(rng); else h = ziggurat::getExponential(rng);
-            if (!q.isUpdatePossible(h)) continue;
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
             uint32_t k = getUniformLemire(m, rng);
-            if (q.update(k, h)) {
+            if (q.update(k, P::toRegister(h))) {
                 result[k] = d;
-                if (!q.isUpdatePossible(h)) continue;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
             }
             if constexpr(isWeighted) buffer.emplace_back(d, h, std::move(rng), wInv); else buffer.emplace_back(d, h, std::move(rng));
 
@@ -338,13 +423,13 @@ public:
                 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
                 double wInv;
                 if constexpr(isWeighted) wInv = std::get<3>(*readIt);
-                if (!q.isUpdatePossible(h)) continue;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
                 if constexpr(isWeighted) h += wInv * ziggurat::getExponential(rng); else h += ziggurat::getExponential(rng);
-                if (!q.isUpdatePossible(h)) continue;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
                 uint32_t k = getUniformLemire(m, rng);
-                if (q.update(k, h)) {
+                if (q.update(k, P::toRegister(h))) {
                     result[k] = d;
-                    if (!q.isUpdatePossible(h)) continue;
+                    if (!q.isUpdatePossible(P::toRegister(h))) continue;
                 }
                 if constexpr(isWeighted) *writeIt = std::make_tuple(d, h, std::move(rng), wInv); else *writeIt = std::make_tuple(d, h, std::move(rng));
                 ++writeIt;
@@ -356,26 +441,110 @@ public:
     }
 };
 
-template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
+// Equivalent to ProbMinHash1a, but instead of sweeping the whole buffer repeatedly, buffered elements are kept in a radix heap
+// ordered by their last hash value, which is a lower bound for the next one. Elements are processed in (approximately) ascending
+// order, which allows to stop as soon as the smallest lower bound is not smaller than the maximum of all registers.
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
+class ProbMinHash1b {
+    constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
+    typedef typename std::conditional<isWeighted, std::tuple<D, double, typename std::result_of<R(D)>::type, double>, std::tuple<D, double, typename std::result_of<R(D)>::type>>::type bufferType;
+    
+    const S m;
+    const E extractFunction;
+    const R rngFunction;
+    const W weightFunction;
+
+    MaxValueTracker<typename P::RegisterType, S> q;
+    std::vector<bufferType> buffer;
+    RadixHeap<uint32_t> heap;
+    uint64_t maxBufferSize;
+    
+    void reset() {
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
+        buffer.clear();
+        heap.clear();
+    }
+
+public:
+
+    ProbMinHash1b(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m)  {}
+
+    uint64_t getMaxBufferSize() const {
+        return maxBufferSize;
+    }
+
+    template<typename X>
+    std::vector<D> operator()(const X& data) {
+
+        reset();
+        std::vector<D> result(m);
+        
+        for(const auto& x : data) {
+            #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+            double wInv;
+            if constexpr(isWeighted) {
+                double w = weightFunction(x);
+                if (!( w > 0)) continue;
+                wInv = 1. / w;
+            }
+            const D& d = extractFunction(x);
+            auto rng = rngFunction(d);
+            double h;
+            if constexpr(isWeighted) h = wInv * ziggurat::getExponential(rng); else h = ziggurat::getExponential(rng);
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            uint32_t k = getUniformLemire(m, rng);
+            if (q.update(k, P::toRegister(h))) {
+                result[k] = d;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            }
+            heap.push(h, buffer.size());
+            if constexpr(isWeighted) buffer.emplace_back(d, h, std::move(rng), wInv); else buffer.emplace_back(d, h, std::move(rng));
+        }
+
+        maxBufferSize = buffer.size();
+
+        while(!heap.empty()) {
+            if (!q.isUpdatePossible(P::toRegister(heap.getMinKey()))) break;
+            const uint32_t idx = heap.pop();
+            auto& entry = buffer[idx];
+            const auto& d = std::get<0>(entry);
+            double& h = std::get<1>(entry);
+            auto& rng = std::get<2>(entry);
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            if constexpr(isWeighted) h += std::get<3>(entry) * ziggurat::getExponential(rng); else h += ziggurat::getExponential(rng);
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            uint32_t k = getUniformLemire(m, rng);
+            if (q.update(k, P::toRegister(h))) {
+                result[k] = d;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            }
+            heap.push(h, idx);
+        }
+
+        return result;
+    }
+};
+
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
 class ProbMinHash2 {
     constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
 
-    const uint32_t m;
+    const S m;
     const E extractFunction;
     const R rngFunction;
     const W weightFunction;
 
-    MaxValueTracker<double> q;
-    PermutationStream permutationStream;
+    MaxValueTracker<typename P::RegisterType, S> q;
+    PermutationStream<S> permutationStream;
     const std::unique_ptr<double[]> g;
 
     void reset() {
-        q.reset(std::numeric_limits<double>::infinity());
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
     }
 
 public:
 
-    ProbMinHash2(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), permutationStream(m), g(new double[m-1])  {
+    ProbMinHash2(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), permutationStream(m), g(new double[m-1])  {
         for(uint32_t i = 1; i < m; ++i) {
             g[i - 1] = static_cast<double>(m) / static_cast<double>(m - i);
         }
@@ -403,11 +572,11 @@ public:
             double h;
             if constexpr(isWeighted) h = wInv * ziggurat::getExponential(rng); else h = ziggurat::getExponential(rng);
             uint32_t i = 0;
-            while(q.isUpdatePossible(h)) {
+            while(q.isUpdatePossible(P::toRegister(h))) {
                 uint32_t k = permutationStream.next(rng);
-                if (q.update(k, h)) {
+                if (q.update(k, P::toRegister(h))) {
                     result[k] = d;
-                    if (!q.isUpdatePossible(h)) break;
+                    if (!q.isUpdatePossible(P::toRegister(h))) break;
                 }
                 if constexpr(isWeighted) h += (wInv * g[i]) * ziggurat::getExponential(rng); else h += g[i] * ziggurat::getExponential(rng);
                 i += 1;
@@ -429,7 +598,7 @@ class NonStreamingProbMinHash2 {
     const R rngFunction;
     const W weightFunction;
 
-    PermutationStream permutationStream;
+    PermutationStream<> permutationStream;
     const std::unique_ptr<double[]> g;
     const double initialLimitFactor;
 
@@ -512,8 +681,12 @@ public:
 };
 
 
+// Equivalent to NonStreamingProbMinHash2. All passes are distributed over threads using OpenMP with thread-local registers, 
+// which are merged by taking the minimum after each pass. Weights are only evaluated once. Elements whose hash value sequence
+// has been exhausted are dropped after each pass, and elements are only processed again, if their next hash value is smaller than 
+// the new limit.
 template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
-class ProbMinHash3 {
+class ParallelNonStreamingProbMinHash2 {
     constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
 
     const uint32_t m;
@@ -521,16 +694,134 @@ class ProbMinHash3 {
     const R rngFunction;
     const W weightFunction;
 
-    MaxValueTracker<double> q;
+    const std::unique_ptr<double[]> g;
+    const double initialLimitFactor;
+
+    // element, inverse weight, next hash value that has not been processed yet
+    std::vector<std::tuple<D, double, double>> candidates;
+
+public:
+
+    ParallelNonStreamingProbMinHash2(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W(), double successProbabilityFirstRun = 0.9) : 
+        m(m), 
+        extractFunction(extractFunction), 
+        rngFunction(rngFunction), 
+        weightFunction(weightFunction), 
+        g(new double[m-1]),
+        initialLimitFactor(-std::log(-std::expm1(std::log(successProbabilityFirstRun) / m))*m)
+    {
+        for(uint32_t i = 1; i < m; ++i) {
+            g[i - 1] = static_cast<double>(m) / static_cast<double>(m - i);
+        }
+    }
+
+    template<typename X>
+    std::vector<D> operator()(const X& data, uint64_t* iterationCounter = nullptr) {
+
+        candidates.clear();
+        double weightSum = 0;
+        for(const auto& x : data) {
+            double w = weightFunction(x);
+            if (!( w > 0)) continue;
+            weightSum += w;
+            candidates.emplace_back(extractFunction(x), 1. / w, 0.);
+        }
+
+        std::vector<D> result(m);
+
+        const double limitIncrement = initialLimitFactor / weightSum;
+
+        double limit = limitIncrement;
+
+        std::vector<double> hashValues(m, limit);
+
+        if (iterationCounter != nullptr) *iterationCounter = 1;
+
+        while(true) {
+
+            const int64_t numCandidates = candidates.size();
+
+            OMP_PRAGMA(omp parallel)
+            {
+                std::vector<double> localHashValues(hashValues);
+                std::vector<D> localResult(result);
+                PermutationStream<> permutationStream(m);
+
+                OMP_PRAGMA(omp for schedule(static, 1024))
+                for(int64_t j = 0; j < numCandidates; ++j) {
+
+                    auto& candidate = candidates[j];
+                    if (!(std::get<2>(candidate) < limit)) continue;
+
+                    const D& d = std::get<0>(candidate);
+                    #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+                    double wInv;
+                    if constexpr(isWeighted) wInv = std::get<1>(candidate);
+                    auto rng = rngFunction(d);
+                    permutationStream.reset();
+
+                    double h;
+                    if constexpr(isWeighted) h = wInv * ziggurat::getExponential(rng); else h = ziggurat::getExponential(rng);
+                    uint32_t i = 0;
+                    while(h < limit) {
+                        uint32_t k = permutationStream.next(rng);
+                        if (h < localHashValues[k]) {
+                            localHashValues[k] = h;
+                            localResult[k] = d;
+                        }
+                        if constexpr(isWeighted) h += (wInv * g[i]) * ziggurat::getExponential(rng); else h += g[i] * ziggurat::getExponential(rng);
+                        i += 1;
+                        if (i == m) {
+                            h = std::numeric_limits<double>::infinity();
+                            break;
+                        }
+                    }
+                    std::get<2>(candidate) = h;
+                }
+
+                OMP_PRAGMA(omp critical)
+                for(uint32_t k = 0; k < m; ++k) {
+                    if (localHashValues[k] < hashValues[k]) {
+                        hashValues[k] = localHashValues[k];
+                        result[k] = localResult[k];
+                    }
+                }
+            }
+
+            bool success = std::none_of(hashValues.begin(), hashValues.end(), [limit](const auto& r){return r == limit;});
+
+            if (success) return result;
+
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](const auto& c) {return std::get<2>(c) == std::numeric_limits<double>::infinity();}), candidates.end());
+
+            if (iterationCounter != nullptr) (*iterationCounter) += 1;
+            double oldLimit = limit;
+            limit += limitIncrement;
+            std::for_each(hashValues.begin(), hashValues.end(), [oldLimit, limit](auto& d) {if (d == oldLimit) d = limit;});
+        }
+    }
+};
+
+
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
+class ProbMinHash3 {
+    constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
+
+    const S m;
+    const E extractFunction;
+    const R rngFunction;
+    const W weightFunction;
+
+    MaxValueTracker<typename P::RegisterType, S> q;
     TruncatedExponentialDistribution truncatedExponentialDistribution;
 
     void reset() {
-        q.reset(std::numeric_limits<double>::infinity());
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
     }
 
 public:
 
-    ProbMinHash3(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), truncatedExponentialDistribution(log1p(1./static_cast<double>(m-1))) {
+    ProbMinHash3(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), truncatedExponentialDistribution(log1p(1./static_cast<double>(m-1))) {
         assert(m > 1);
     }
 
@@ -554,11 +845,11 @@ public:
             double h;
             if constexpr(isWeighted) h = wInv * truncatedExponentialDistribution(rng); else h = getUniformDouble(rng);
             uint32_t i = 1;
-            while(q.isUpdatePossible(h)) {
+            while(q.isUpdatePossible(P::toRegister(h))) {
                 uint32_t k = getUniformLemire(m, rng);
-                if (q.update(k, h)) result[k] = d;
+                if (q.update(k, P::toRegister(h))) result[k] = d;
                 if constexpr(isWeighted) h = wInv * i; else h = i;
-                if (!q.isUpdatePossible(h)) break;
+                if (!q.isUpdatePossible(P::toRegister(h))) break;
                 if constexpr(isWeighted) h += wInv * truncatedExponentialDistribution(rng); else h += getUniformDouble(rng);
                 i += 1;
             }
@@ -568,29 +859,29 @@ public:
     }
 };
 
-template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
 class ProbMinHash3a {
     constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
     typedef typename std::conditional<isWeighted, std::tuple<D, typename std::result_of<R(D)>::type, double>, std::tuple<D, typename std::result_of<R(D)>::type>>::type bufferType;
 
-    const uint32_t m;
+    const S m;
     const E extractFunction;
     const R rngFunction;
     const W weightFunction;
 
-    MaxValueTracker<double> q;
+    MaxValueTracker<typename P::RegisterType, S> q;
     std::vector<bufferType> buffer;
     TruncatedExponentialDistribution truncatedExponentialDistribution;
     uint64_t maxBufferSize;
     
     void reset() {
-        q.reset(std::numeric_limits<double>::infinity());
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
         buffer.clear();
     }
 
 public:
 
-    ProbMinHash3a(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), truncatedExponentialDistribution(log1p(1./static_cast<double>(m-1)))  {
+    ProbMinHash3a(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), truncatedExponentialDistribution(log1p(1./static_cast<double>(m-1)))  {
         assert(m > 1);
     }
 
@@ -616,15 +907,15 @@ public:
             auto rng = rngFunction(d);
             double h;
             if constexpr(isWeighted) h = wInv * truncatedExponentialDistribution(rng); else h = getUniformDouble(rng);
-            if (!q.isUpdatePossible(h)) continue;
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
             uint32_t k = getUniformLemire(m, rng);
-            if (q.update(k, h)) result[k] = d;
+            if (q.update(k, P::toRegister(h))) result[k] = d;
             if constexpr(isWeighted) {
-                if (!q.isUpdatePossible(wInv)) continue;
+                if (!q.isUpdatePossible(P::toRegister(wInv))) continue;
                 buffer.emplace_back(d, std::move(rng), wInv);
             }
             else {
-                if (!q.isUpdatePossible(1)) continue;
+                if (!q.isUpdatePossible(P::toRegister(1))) continue;
                 buffer.emplace_back(d, std::move(rng));
             }
         }
@@ -646,17 +937,17 @@ public:
                 else {
                     h = i;
                 }
-                if (!q.isUpdatePossible(h)) continue;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
                 if constexpr(isWeighted) h += wInv * truncatedExponentialDistribution(rng); else h += getUniformDouble(rng);
-                if (!q.isUpdatePossible(h)) continue;
+                if (!q.isUpdatePossible(P::toRegister(h))) continue;
                 uint32_t k = getUniformLemire(m, rng);
-                if (q.update(k, h)) result[k] = d;
+                if (q.update(k, P::toRegister(h))) result[k] = d;
                 if constexpr(isWeighted) {
-                    if (!q.isUpdatePossible((i + 1) * wInv)) continue;
+                    if (!q.isUpdatePossible(P::toRegister((i + 1) * wInv))) continue;
                     *writeIt = std::make_tuple(d, std::move(rng), wInv);
                 }
                 else {
-                    if (!q.isUpdatePossible(i + 1)) continue;
+                    if (!q.isUpdatePossible(P::toRegister(i + 1))) continue;
                     *writeIt = std::make_tuple(d, std::move(rng));
                 }
                 ++writeIt;
@@ -669,29 +960,134 @@ public:
     }
 };
 
-template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
+// Equivalent to ProbMinHash3a, but buffered elements are processed in ascending order of the lower bound of their 
+// next hash value using a radix heap, like in ProbMinHash1b.
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
+class ProbMinHash3b {
+    constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
+    typedef typename std::conditional<isWeighted, std::tuple<D, typename std::result_of<R(D)>::type, uint64_t, double>, std::tuple<D, typename std::result_of<R(D)>::type, uint64_t>>::type bufferType;
+
+    const S m;
+    const E extractFunction;
+    const R rngFunction;
+    const W weightFunction;
+
+    MaxValueTracker<typename P::RegisterType, S> q;
+    std::vector<bufferType> buffer;
+    RadixHeap<uint32_t> heap;
+    TruncatedExponentialDistribution truncatedExponentialDistribution;
+    uint64_t maxBufferSize;
+    
+    void reset() {
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
+        buffer.clear();
+        heap.clear();
+    }
+
+public:
+
+    ProbMinHash3b(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), weightFunction(weightFunction), q(m), truncatedExponentialDistribution(log1p(1./static_cast<double>(m-1)))  {
+        assert(m > 1);
+    }
+
+    uint64_t getMaxBufferSize() const {
+        return maxBufferSize;
+    }
+
+    template<typename X>
+    typename std::vector<D> operator()(const X& data) {
+
+        reset();
+        std::vector<D> result(m);
+        
+        for(const auto& x : data) {
+            #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+            double wInv;
+            if constexpr(isWeighted) {
+                double w = weightFunction(x);
+                if (!( w > 0)) continue;
+                wInv = 1. / w;
+            }
+            const D& d = extractFunction(x);
+            auto rng = rngFunction(d);
+            double h;
+            if constexpr(isWeighted) h = wInv * truncatedExponentialDistribution(rng); else h = getUniformDouble(rng);
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            uint32_t k = getUniformLemire(m, rng);
+            if (q.update(k, P::toRegister(h))) result[k] = d;
+            if constexpr(isWeighted) {
+                if (!q.isUpdatePossible(P::toRegister(wInv))) continue;
+                heap.push(wInv, buffer.size());
+                buffer.emplace_back(d, std::move(rng), 1, wInv);
+            }
+            else {
+                if (!q.isUpdatePossible(P::toRegister(1))) continue;
+                heap.push(1, buffer.size());
+                buffer.emplace_back(d, std::move(rng), 1);
+            }
+        }
+
+        maxBufferSize = buffer.size();
+
+        while(!heap.empty()) {
+            if (!q.isUpdatePossible(P::toRegister(heap.getMinKey()))) break;
+            const uint32_t idx = heap.pop();
+            auto& entry = buffer[idx];
+            const auto& d = std::get<0>(entry);
+            auto& rng = std::get<1>(entry);
+            uint64_t& i = std::get<2>(entry);
+            double wInv;
+            double h;
+            if constexpr(isWeighted) {
+                wInv = std::get<3>(entry);
+                h = i * wInv;
+            }
+            else {
+                h = i;
+            }
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            if constexpr(isWeighted) h += wInv * truncatedExponentialDistribution(rng); else h += getUniformDouble(rng);
+            if (!q.isUpdatePossible(P::toRegister(h))) continue;
+            uint32_t k = getUniformLemire(m, rng);
+            if (q.update(k, P::toRegister(h))) result[k] = d;
+            i += 1;
+            if constexpr(isWeighted) {
+                if (!q.isUpdatePossible(P::toRegister(i * wInv))) continue;
+                heap.push(i * wInv, idx);
+            }
+            else {
+                if (!q.isUpdatePossible(P::toRegister(i))) continue;
+                heap.push(i, idx);
+            }
+        }
+
+        return result;
+    }
+};
+
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction, typename S = DynamicSize, typename P = DoublePrecision>
 class ProbMinHash4 {
     constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
 
-    const uint32_t m;
+    const S m;
     const E extractFunction;
     const R rngFunction;
     const W weightFunction;
 
-    MaxValueTracker<double> q;
-    PermutationStream permutationStream;
+    MaxValueTracker<typename P::RegisterType, S> q;
+    PermutationStream<S> permutationStream;
 
     const std::unique_ptr<double[]> boundaries;
     const std::unique_ptr<TruncatedExponentialDistribution[]> truncatedExponentialDistributions;
     double firstBoundaryInv;
 
     void reset() {
-        q.reset(std::numeric_limits<double>::infinity());
+        q.reset(P::toRegister(std::numeric_limits<double>::infinity()));
     }
 
 public:
 
-ProbMinHash4(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), 
+ProbMinHash4(const S m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), 
             weightFunction(weightFunction), q(m), permutationStream(m), boundaries(new double[m-1]), truncatedExponentialDistributions(new TruncatedExponentialDistribution[m-1]) {
         assert(m > 1);
         const double firstBoundary = log1p(1./static_cast<double>(m-1));
@@ -728,23 +1124,23 @@ ProbMinHash4(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W w
             double h;
             if constexpr(isWeighted) h = wInv * truncatedExponentialDistributions[0](rng); else h = getUniformDouble(rng);
             uint32_t i = 1;
-            while(q.isUpdatePossible(h)) {
+            while(q.isUpdatePossible(P::toRegister(h))) {
                 uint32_t k = permutationStream.next(rng);
-                if (q.update(k, h)) result[k] = d;
+                if (q.update(k, P::toRegister(h))) result[k] = d;
                 if constexpr(isWeighted) {
-                    if (!q.isUpdatePossible(wInv * boundaries[i-1])) break; 
+                    if (!q.isUpdatePossible(P::toRegister(wInv * boundaries[i-1]))) break; 
                 }
                 else {
-                    if (!q.isUpdatePossible(i)) break; 
+                    if (!q.isUpdatePossible(P::toRegister(i))) break; 
                 }
                 if (i < m - 1) {
                     if constexpr(isWeighted) h = wInv * (boundaries[i-1] + (boundaries[i] - boundaries[i-1]) * truncatedExponentialDistributions[i](rng)); else  h = i + getUniformDouble(rng);
                 }
                 else {
                     if constexpr(isWeighted) h = wInv * (boundaries[m-2] + firstBoundaryInv * ziggurat::getExponential(rng)); else h = (m - 1) + getUniformDouble(rng);
-                    if (q.isUpdatePossible(h)) {
+                    if (q.isUpdatePossible(P::toRegister(h))) {
                         uint32_t k = permutationStream.next(rng);
-                        q.update(k, h);
+                        q.update(k, P::toRegister(h));
                         result[k] = d;
                     }
                     break;
@@ -766,7 +1162,7 @@ class NonStreamingProbMinHash4 {
     const R rngFunction;
     const W weightFunction;
 
-    PermutationStream permutationStream;
+    PermutationStream<> permutationStream;
     const std::unique_ptr<double[]> boundaries;
     const std::unique_ptr<TruncatedExponentialDistribution[]> truncatedExponentialDistributions;
     double firstBoundaryInv;
@@ -870,6 +1266,219 @@ public:
 };
 
 
+// Equivalent to NonStreamingProbMinHash4, parallelized in the same way as ParallelNonStreamingProbMinHash2.
+template<typename D, typename E, typename R, typename W = UnaryWeightFunction>
+class ParallelNonStreamingProbMinHash4 {
+    constexpr static bool isWeighted = !std::is_same<W, UnaryWeightFunction>::value;
+
+    const uint32_t m;
+    const E extractFunction;
+    const R rngFunction;
+    const W weightFunction;
+
+    const std::unique_ptr<double[]> boundaries;
+    const std::unique_ptr<TruncatedExponentialDistribution[]> truncatedExponentialDistributions;
+    double firstBoundaryInv;
+    const double initialLimitFactor;
+
+    // element, inverse weight, lower bound of the next hash value that has not been processed yet
+    std::vector<std::tuple<D, double, double>> candidates;
+
+public:
+
+    ParallelNonStreamingProbMinHash4(const uint32_t m, E extractFunction = E(), R rngFunction = R(), W weightFunction = W(), double successProbabilityFirstRun = 0.9) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), 
+            weightFunction(weightFunction), boundaries(new double[m-1]), truncatedExponentialDistributions(new TruncatedExponentialDistribution[m-1]), initialLimitFactor(-std::log(-std::expm1(std::log(successProbabilityFirstRun) / m))*m) {
+        assert(m > 1);
+        const double firstBoundary = log1p(1./static_cast<double>(m-1));
+        double previousBoundary = firstBoundary;
+        truncatedExponentialDistributions[0] = TruncatedExponentialDistribution(firstBoundary);
+        boundaries[0] = 1;
+        for(uint32_t i = 1; i < m-1; ++i) {
+            const double boundary = log1p(static_cast<double>(i + 1)/static_cast<double>(m - i - 1));
+            boundaries[i] = boundary / firstBoundary;
+            truncatedExponentialDistributions[i] = TruncatedExponentialDistribution(boundary - previousBoundary);
+            previousBoundary = boundary;
+        }
+        firstBoundaryInv = 1. / firstBoundary;
+    }
+
+    template<typename X>
+    std::vector<D> operator()(const X& data, uint64_t* iterationCounter = nullptr) {
+
+        candidates.clear();
+        double weightSum = 0;
+        for(const auto& x : data) {
+            double w = weightFunction(x);
+            if (!( w > 0)) continue;
+            weightSum += w;
+            candidates.emplace_back(extractFunction(x), 1. / w, 0.);
+        }
+
+        std::vector<D> result(m);
+
+        const double limitIncrement = initialLimitFactor / weightSum;
+
+        double limit = limitIncrement;
+
+        std::vector<double> hashValues(m, limit);
+
+        if (iterationCounter != nullptr) *iterationCounter = 1;
+
+        while(true) {
+
+            const int64_t numCandidates = candidates.size();
+
+            OMP_PRAGMA(omp parallel)
+            {
+                std::vector<double> localHashValues(hashValues);
+                std::vector<D> localResult(result);
+                PermutationStream<> permutationStream(m);
+
+                OMP_PRAGMA(omp for schedule(static, 1024))
+                for(int64_t j = 0; j < numCandidates; ++j) {
+
+                    auto& candidate = candidates[j];
+                    if (!(std::get<2>(candidate) < limit)) continue;
+
+                    const D& d = std::get<0>(candidate);
+                    double wInv;
+                    if constexpr(isWeighted) wInv = std::get<1>(candidate);
+                    auto rng = rngFunction(d);
+                    permutationStream.reset();
+
+                    double h;
+                    if constexpr(isWeighted) h = wInv * truncatedExponentialDistributions[0](rng); else h = getUniformDouble(rng);
+                    uint32_t i = 1;
+                    while(h < limit) {
+                        uint32_t k = permutationStream.next(rng);
+                        if (h < localHashValues[k]) {
+                            localHashValues[k] = h;
+                            localResult[k] = d;
+                        }
+                        if constexpr(isWeighted) {
+                            if (wInv * boundaries[i-1] >= limit) {
+                                h = wInv * boundaries[i-1];
+                                break;
+                            }
+                        }
+                        else {
+                            if (i >= limit) {
+                                h = i;
+                                break;
+                            }
+                        }
+                        if (i < m - 1) {
+                            if constexpr(isWeighted) h = wInv * (boundaries[i-1] + (boundaries[i] - boundaries[i-1]) * truncatedExponentialDistributions[i](rng)); else  h = i + getUniformDouble(rng);
+                        }
+                        else {
+                            if constexpr(isWeighted) h = wInv * (boundaries[m-2] + firstBoundaryInv * ziggurat::getExponential(rng)); else h = (m - 1) + getUniformDouble(rng);
+                            if (h < limit) {
+                                uint32_t k = permutationStream.next(rng);
+                                if (h < localHashValues[k]) {
+                                    localHashValues[k] = h;
+                                    localResult[k] = d;
+                                }
+                                h = std::numeric_limits<double>::infinity();
+                            }
+                            break;
+                        }
+                        i += 1;
+                    }
+                    std::get<2>(candidate) = h;
+                }
+
+                OMP_PRAGMA(omp critical)
+                for(uint32_t k = 0; k < m; ++k) {
+                    if (localHashValues[k] < hashValues[k]) {
+                        hashValues[k] = localHashValues[k];
+                        result[k] = localResult[k];
+                    }
+                }
+            }
+
+            bool success = std::none_of(hashValues.begin(), hashValues.end(), [limit](const auto& r){return r == limit;});
+
+            if (success) return result;
+
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](const auto& c) {return std::get<2>(c) == std::numeric_limits<double>::infinity();}), candidates.end());
+
+            if (iterationCounter != nullptr) (*iterationCounter) += 1;
+            double oldLimit = limit;
+            limit += limitIncrement;
+            std::for_each(hashValues.begin(), hashValues.end(), [oldLimit, limit](auto& d) {if (d == oldLimit) d = limit;});
+        }
+    }
+};
+
+
+// Random bit stream function used for the higher levels of NestedProbMinHash. The stream of level l is
+// seeded with the first 64 bits of the wrapped stream and the level, such that all levels are independent.
+// The returned stream has the type of the wrapped stream, e.g. BufferedWyrandBitStream, which must be
+// constructible from a value and a seed like WyrandBitStream.
+template<typename R>
+class LevelRngFunction {
+    const R rngFunction;
+    const uint64_t level;
+public:
+
+    LevelRngFunction(R rngFunction, uint64_t level) : rngFunction(rngFunction), level(level) {}
+
+    template<typename D>
+    auto operator()(const D& d) const {
+        auto rng = rngFunction(d);
+        typedef decltype(rng) S;
+        static_assert(std::is_constructible<S, uint64_t, uint64_t>::value, "Require a bit stream constructible from a value and a seed!");
+        return S(rng(64), level);
+    }
+};
+
+// Nested multi-resolution sketch: for levels m_1 < m_2 < ... < m_L = m, the first m_l components of
+// the signature form a valid signature of size m_l. The components in [m_{l-1}, m_l) are computed by an
+// independent instance of H of size m_l - m_{l-1}, the first level uses the given rng function
+// and is therefore identical to the signature of H of size m_1.
+//
+// For ProbMinHash1 and ProbMinHash2 the register values of an element are independent, hence any
+// prefix of a signature is already a valid signature with the same distribution. ProbMinHash3 and
+// ProbMinHash4 correlate all m registers to reduce the variance, a prefix of size m_1 << m is still unbiased,
+// but almost loses this advantage. Here every level keeps it at the cost of processing the data once per level.
+// The price is paid at the full size: the signature of size m_L consists of L independent parts, each of
+// which only correlates its own registers, and is therefore less accurate than a plain signature of H of
+// size m_L. For ProbMinHash4 with levels 64, 1024, 4096 and J = 0.38, nested_sketch_test gives an MSE of
+// 3.76e-5 for the full nested signature compared to 3.20e-5 for a plain signature of size 4096.
+template<template<typename, typename, typename, typename, typename, typename> typename H, typename D, typename E, typename R, typename W = UnaryWeightFunction>
+class NestedProbMinHash {
+    const std::vector<uint32_t> levels;
+    H<D, E, R, W, DynamicSize, DoublePrecision> firstLevel;
+    std::vector<std::unique_ptr<H<D, E, LevelRngFunction<R>, W, DynamicSize, DoublePrecision>>> higherLevels;
+
+public:
+
+    NestedProbMinHash(const std::vector<uint32_t>& levels, E extractFunction = E(), R rngFunction = R(), W weightFunction = W()) : 
+            levels(levels), firstLevel(levels.at(0), extractFunction, rngFunction, weightFunction) {
+        assert(levels[0] > 1);
+        for(uint32_t l = 1; l < levels.size(); ++l) {
+            assert(levels[l] > levels[l - 1] + 1);
+            higherLevels.emplace_back(new H<D, E, LevelRngFunction<R>, W, DynamicSize, DoublePrecision>(
+                levels[l] - levels[l - 1], extractFunction, LevelRngFunction<R>(rngFunction, l), weightFunction));
+        }
+    }
+
+    const std::vector<uint32_t>& getLevels() const {
+        return levels;
+    }
+
+    template<typename X>
+    std::vector<D> operator()(const X& data) {
+        std::vector<D> result = firstLevel(data);
+        result.reserve(levels.back());
+        for(const auto& h : higherLevels) {
+            const std::vector<D> levelResult = (*h)(data);
+            result.insert(result.end(), levelResult.begin(), levelResult.end());
+        }
+        return result;
+    }
+};
+
 // An implementation of the original MinHash algorithm as described in
 // Andrei Z. Broder. 1997. On the Resemblance and Containment of Documents. In Proc. Compression and Complexity of Sequences. 21–2 
 // https://doi.org/10.1109/SEQUEN.1997.666900
@@ -970,28 +1579,28 @@ public:
 // An implementation of the SuperMinHash algorithm as described in
 // Otmar Ertl. "SuperMinHash - A New Minwise Hashing Algorithm for Jaccard Similarity Estimation"
 // see https://arxiv.org/abs/1706.05698
-template<typename D, typename E, typename R>
+template<typename D, typename E, typename R, typename S = DynamicSize>
 class SuperMinHash {
-    const uint32_t m;
+    const S m;
     const E extractFunction;
     const R rngFunction;
 
-    const std::unique_ptr<uint64_t[]> values; 
-    PermutationStream permutationStream;
-    const std::unique_ptr<uint32_t[]> levels;
-    const std::unique_ptr<uint32_t[]> levelHistogram;
+    RegisterArray<uint64_t, S::fixedValue> values;
+    PermutationStream<S> permutationStream;
+    RegisterArray<uint32_t, S::fixedValue> levels;
+    RegisterArray<uint32_t, S::fixedValue> levelHistogram;
 
     void reset() {
-        std::fill_n(values.get(), m, std::numeric_limits<uint64_t>::max());
-        std::fill_n(levels.get(), m, m-1);
+        std::fill_n(values.get(), static_cast<uint32_t>(m), std::numeric_limits<uint64_t>::max());
+        std::fill_n(levels.get(), static_cast<uint32_t>(m), m-1);
         std::fill_n(levelHistogram.get(), m - 1, 0);
         levelHistogram[m-1] = m;
     }
 
 public:
 
-    SuperMinHash(const uint32_t m, E extractFunction = E(), R rngFunction = R()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), values(new uint64_t[m]), permutationStream(m),
-        levels(new uint32_t[m]), levelHistogram(new uint32_t[m])  {}
+    SuperMinHash(const S m, E extractFunction = E(), R rngFunction = R()) : m(m), extractFunction(extractFunction), rngFunction(rngFunction), values(m), permutationStream(m),
+        levels(m), levelHistogram(m)  {}
 
     template<typename X>
     std::vector<D> operator()(const X& data) {
@@ -1376,7 +1985,7 @@ class FastOrderMinHash2 {
 
     MaxValueTracker<double> q;
     OrderMinhashHelper<double> orderMinhashHelper;
-    PermutationStream permutationStream;
+    PermutationStream<> permutationStream;
     const std::unique_ptr<double[]> g;
 
 
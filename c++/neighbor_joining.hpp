@@ -0,0 +1,309 @@
+#ifndef _NEIGHBOR_JOINING_HPP_
+#define _NEIGHBOR_JOINING_HPP_
+
+#include "all_vs_all.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+#include <utility>
+
+// Neighbor-joining trees from the Mash distances of signatures.
+//
+// Neighbor joining repeatedly joins the pair (i, j) of active nodes that minimizes q(i, j) = d(i, j) - (u(i) + u(j)),
+// where u(i) is the sum of the distances of i to all N active nodes divided by N - 2. Searching the whole matrix in
+// every step gives O(n^3) time. As RapidNJ (Simonsen, Mailund, Pedersen, 2008), computeNeighborJoining keeps the
+// distances of every row sorted, and scans a row only as long as d(i, j) - (u(i) + max u) is not larger than the best q
+// found so far, since no later entry of the row can be better. Usually only a few entries per row are visited.
+//
+// Instead of a sorted copy of the full matrix, every row keeps a bucket of its bucketSize smallest distances, as pairs
+// of distance and node id, such that the memory is dominated by the n x n float matrix itself (1.6 GB for 20000
+// signatures). Distances between two nodes never change, hence an entry of a bucket stays valid as long as both nodes
+// are active, entries of joined nodes are skipped. A pair of a row with a node created later is found in the bucket of
+// the later node. Only if the scan reaches the end of a truncated bucket, the row is scanned completely and its bucket
+// is rebuilt from the active nodes. The rows are searched in parallel, ties are broken by the node ids, hence the
+// tree does not depend on the number of threads.
+
+// Mash distance -ln(2J / (1 + J)) / k for the Jaccard similarity J of k-mer sets, at most 1 as in Mash.
+inline double getMashDistance(double jaccard, uint32_t k) {
+    if (jaccard <= 0) return 1;
+    return std::min(1., -std::log(2 * jaccard / (1 + jaccard)) / k);
+}
+
+// Returns the symmetric n x n matrix of Mash distances in row-major order, with J estimated as the fraction of equal
+// components of the signatures.
+template<typename T>
+std::vector<float> computeMashDistanceMatrix(const T* signatures, uint64_t n, uint32_t m, uint32_t k) {
+    std::vector<float> distanceOfCount(m + 1);
+    for (uint32_t count = 0; count <= m; ++count) distanceOfCount[count] = getMashDistance(static_cast<double>(count) / m, k);
+    std::vector<float> distances(n * n, 0.f);
+    computeAllVsAllRowBlocks(signatures, n, m, [&](uint64_t iBegin, uint64_t iEnd, const uint32_t* counts) {
+        const uint64_t offset = iBegin * (iBegin - 1) / 2;
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for (int64_t i = iBegin; i < static_cast<int64_t>(iEnd); ++i) {
+            const uint32_t* rowCounts = counts + (i * (i - 1) / 2 - offset);
+            for (int64_t j = 0; j < i; ++j) distances[i * n + j] = distances[j * n + i] = distanceOfCount[rowCounts[j]];
+        }
+    });
+    return distances;
+}
+
+struct NeighborJoiningJoin {
+    uint64_t node1, node2;   // joined nodes, ids below n are the taxa, join s creates node n + s
+    double length1, length2; // lengths of the branches from the new node to node1 and node2
+};
+
+// Unrooted tree given by n - 2 joins and the branch between the last two active nodes.
+struct NeighborJoiningTree {
+    uint64_t n = 0;
+    std::vector<NeighborJoiningJoin> joins;
+    uint64_t lastNode1 = 0, lastNode2 = 0;
+    double lastLength = 0;
+};
+
+namespace neighbor_joining {
+
+// candidate pair, compared by q and then by the node ids
+struct Candidate {
+    double q = std::numeric_limits<double>::infinity();
+    uint64_t node1 = UINT64_MAX, node2 = UINT64_MAX; // node1 < node2
+
+    void update(double otherQ, uint64_t a, uint64_t b) {
+        if (a > b) std::swap(a, b);
+        if (otherQ < q || (otherQ == q && (a < node1 || (a == node1 && b < node2)))) {
+            q = otherQ;
+            node1 = a;
+            node2 = b;
+        }
+    }
+};
+
+struct BucketEntry {
+    float distance;
+    uint32_t node;
+
+    bool operator<(const BucketEntry& other) const {
+        return distance < other.distance || (distance == other.distance && node < other.node);
+    }
+};
+
+} // namespace neighbor_joining
+
+// Builds the neighbor-joining tree of the symmetric n x n distance matrix in row-major order, which is overwritten.
+// Negative branch lengths are set to zero.
+inline NeighborJoiningTree computeNeighborJoining(std::vector<float>& distances, uint64_t n, uint32_t bucketSize = 256) {
+    using neighbor_joining::Candidate;
+    using neighbor_joining::BucketEntry;
+    constexpr uint32_t inactive = UINT32_MAX;
+    NeighborJoiningTree tree;
+    tree.n = n;
+    if (n < 2) return tree;
+    bucketSize = std::max<uint32_t>(bucketSize, 1);
+
+    // the node created by a join takes the slot, i.e. the row and column of the matrix, of one of the joined nodes
+    std::vector<uint32_t> nodeSlots(2 * n - 1, inactive);
+    std::vector<uint64_t> slotNodes(n);
+    std::vector<uint32_t> activeSlots(n);
+    std::vector<double> sums(n, 0.);
+    std::vector<double> u(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        nodeSlots[i] = i;
+        slotNodes[i] = i;
+        activeSlots[i] = i;
+    }
+    OMP_PRAGMA(omp parallel for schedule(static))
+    for (int64_t i = 0; i < static_cast<int64_t>(n); ++i) {
+        double sum = 0;
+        for (uint64_t j = 0; j < n; ++j) sum += distances[i * n + j];
+        sums[i] = sum;
+    }
+
+    std::vector<std::vector<BucketEntry>> buckets(n);
+    std::vector<uint32_t> bucketBegins(n, 0); // entries before are inactive
+    std::vector<uint8_t> isTruncated(n); // not vector<bool>, the rows are rebuilt concurrently
+    auto rebuildBucket = [&](uint32_t i) {
+        std::vector<BucketEntry>& bucket = buckets[i];
+        bucket.clear();
+        for (uint32_t j : activeSlots) {
+            if (j != i) bucket.push_back(BucketEntry{distances[i * n + j], static_cast<uint32_t>(slotNodes[j])});
+        }
+        isTruncated[i] = bucket.size() > bucketSize;
+        const auto end = bucket.begin() + std::min<size_t>(bucketSize, bucket.size());
+        std::nth_element(bucket.begin(), end, bucket.end());
+        bucket.erase(end, bucket.end());
+        std::sort(bucket.begin(), bucket.end());
+        bucket.shrink_to_fit();
+        bucketBegins[i] = 0;
+    };
+    OMP_PRAGMA(omp parallel for schedule(dynamic, 16))
+    for (int64_t i = 0; i < static_cast<int64_t>(n); ++i) rebuildBucket(i);
+
+    for (uint64_t s = 0; s + 2 < n; ++s) {
+        const uint64_t numActive = n - s;
+        double uMax = -std::numeric_limits<double>::infinity();
+        for (uint32_t i : activeSlots) {
+            u[i] = sums[i] / (numActive - 2);
+            uMax = std::max(uMax, u[i]);
+        }
+
+        // search of the pair with minimum q, with three active nodes q is the same for all pairs and every join
+        // gives the same tree, which is not decided by rounding errors then
+        Candidate best;
+        if (numActive == 3) {
+            for (uint32_t i : activeSlots) {
+                for (uint32_t j : activeSlots) if (i != j) best.update(0, slotNodes[i], slotNodes[j]);
+            }
+        }
+        else {
+            // the first active entry of every row gives an initial bound, otherwise the first rows would be scanned
+            // without bound and their buckets rebuilt in every step
+            for (uint32_t i : activeSlots) {
+                const std::vector<BucketEntry>& bucket = buckets[i];
+                uint32_t& begin = bucketBegins[i];
+                while (begin < bucket.size() && nodeSlots[bucket[begin].node] == inactive) begin += 1;
+                if (begin < bucket.size()) best.update(bucket[begin].distance - (u[i] + u[nodeSlots[bucket[begin].node]]), slotNodes[i], bucket[begin].node);
+            }
+            const Candidate initialBest = best;
+            OMP_PRAGMA(omp parallel)
+            {
+                Candidate threadBest = initialBest;
+                OMP_PRAGMA(omp for schedule(dynamic, 64) nowait)
+                for (int64_t a = 0; a < static_cast<int64_t>(numActive); ++a) {
+                    const uint32_t i = activeSlots[a];
+                    const uint64_t node = slotNodes[i];
+                    const std::vector<BucketEntry>& bucket = buckets[i];
+                    bool isPruned = false;
+                    for (uint32_t e = bucketBegins[i]; e < bucket.size(); ++e) {
+                        if (bucket[e].distance - (u[i] + uMax) > threadBest.q) {
+                            isPruned = true;
+                            break;
+                        }
+                        const uint32_t j = nodeSlots[bucket[e].node];
+                        if (j != inactive) threadBest.update(bucket[e].distance - (u[i] + u[j]), node, bucket[e].node);
+                    }
+                    if (!isPruned && isTruncated[i]) {
+                        for (uint32_t j : activeSlots) {
+                            if (j != i) threadBest.update(distances[i * n + j] - (u[i] + u[j]), node, slotNodes[j]);
+                        }
+                        rebuildBucket(i);
+                    }
+                }
+                OMP_PRAGMA(omp critical)
+                best.update(threadBest.q, threadBest.node1, threadBest.node2);
+            }
+        }
+
+        // join, the new node takes the slot of node1
+        const uint32_t i = nodeSlots[best.node1];
+        const uint32_t j = nodeSlots[best.node2];
+        const double dij = distances[i * n + j];
+        const double lengthI = dij / 2 + (sums[i] - sums[j]) / (2 * (numActive - 2));
+        tree.joins.push_back(NeighborJoiningJoin{best.node1, best.node2, std::max(lengthI, 0.), std::max(dij - lengthI, 0.)});
+        const uint64_t newNode = n + s;
+        nodeSlots[best.node1] = inactive;
+        nodeSlots[best.node2] = inactive;
+        nodeSlots[newNode] = i;
+        slotNodes[i] = newNode;
+        activeSlots.erase(std::find(activeSlots.begin(), activeSlots.end(), j));
+        OMP_PRAGMA(omp parallel for schedule(static))
+        for (int64_t a = 0; a < static_cast<int64_t>(activeSlots.size()); ++a) {
+            const uint32_t k = activeSlots[a];
+            if (k == i) continue;
+            // the rows of i and j are read instead of the columns, which are not contiguous
+            const float distance = (distances[i * n + k] + distances[j * n + k] - dij) / 2;
+            sums[k] += distance - distances[i * n + k] - distances[j * n + k];
+            distances[i * n + k] = distance;
+            distances[k * n + i] = distance;
+        }
+        // summed in a fixed order, such that the result does not depend on the number of threads
+        sums[i] = 0;
+        for (uint32_t k : activeSlots) if (k != i) sums[i] += distances[i * n + k];
+        rebuildBucket(i);
+        std::vector<BucketEntry>().swap(buckets[j]);
+    }
+
+    tree.lastNode1 = slotNodes[activeSlots[0]];
+    tree.lastNode2 = slotNodes[activeSlots[1]];
+    if (tree.lastNode1 < tree.lastNode2) std::swap(tree.lastNode1, tree.lastNode2);
+    tree.lastLength = std::max<double>(distances[activeSlots[0] * n + activeSlots[1]], 0.);
+    return tree;
+}
+
+// Returns the tree in Newick format, names with characters reserved by Newick are quoted.
+inline std::string getNewick(const NeighborJoiningTree& tree, const std::vector<std::string>& names) {
+    auto appendName = [&](std::string& newick, uint64_t taxon) {
+        const std::string& name = names[taxon];
+        if (name.find_first_of(" \t\n()[]':;,") == std::string::npos && !name.empty()) {
+            newick += name;
+            return;
+        }
+        newick += '\'';
+        for (char c : name) {
+            if (c == '\'') newick += '\'';
+            newick += c;
+        }
+        newick += '\'';
+    };
+    auto appendLength = [](std::string& newick, double length) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), ":%.8g", length);
+        newick += buffer;
+    };
+    const uint64_t n = tree.n;
+    std::string newick;
+    if (n == 0) return ";";
+    if (n == 1) {
+        appendName(newick, 0);
+        return newick + ";";
+    }
+    // subtrees are written by an explicit depth-first traversal, since a caterpillar tree has depth n
+    auto appendSubtree = [&](uint64_t root, double rootLength) {
+        std::vector<std::pair<uint64_t, uint32_t>> stack(1, std::make_pair(root, 0));
+        while (!stack.empty()) {
+            const uint64_t node = stack.back().first;
+            const uint32_t state = stack.back().second++;
+            if (node < n) {
+                appendName(newick, node);
+                stack.pop_back();
+            }
+            else if (state == 0) {
+                newick += '(';
+                stack.emplace_back(tree.joins[node - n].node1, 0);
+            }
+            else if (state == 1) {
+                appendLength(newick, tree.joins[node - n].length1);
+                newick += ',';
+                stack.emplace_back(tree.joins[node - n].node2, 0);
+            }
+            else {
+                appendLength(newick, tree.joins[node - n].length2);
+                newick += ')';
+                stack.pop_back();
+            }
+        }
+        appendLength(newick, rootLength);
+    };
+    // the tree is unrooted, the last join is written as the trifurcation at the root
+    newick += '(';
+    if (tree.lastNode1 >= n) {
+        const NeighborJoiningJoin& join = tree.joins[tree.lastNode1 - n];
+        appendSubtree(join.node1, join.length1);
+        newick += ',';
+        appendSubtree(join.node2, join.length2);
+        newick += ',';
+        appendSubtree(tree.lastNode2, tree.lastLength);
+    }
+    else {
+        appendSubtree(tree.lastNode1, tree.lastLength / 2);
+        newick += ',';
+        appendSubtree(tree.lastNode2, tree.lastLength / 2);
+    }
+    return newick + ");";
+}
+
+#endif // _NEIGHBOR_JOINING_HPP_
@@ -0,0 +1,165 @@
+#include "neighbor_joining.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+
+// Checks the neighbor-joining tree with pruned search against the naive algorithm, which searches the whole matrix in
+// every step, for random and almost additive distances and for Mash distances of generated signatures, checks the
+// Newick output, and compares the time of both algorithms.
+
+// naive neighbor joining, which evaluates q for all pairs, with the same formulas, including the order of the updates
+// of the row sums, such that q is computed bitwise identical and ties are broken in the same way
+NeighborJoiningTree computeNaiveNeighborJoining(vector<float> distances, uint64_t n) {
+    NeighborJoiningTree tree;
+    tree.n = n;
+    vector<uint64_t> nodes(n);
+    for(uint64_t i = 0; i < n; ++i) nodes[i] = i;
+    vector<uint64_t> active(n);
+    for(uint64_t i = 0; i < n; ++i) active[i] = i;
+    vector<double> sums(n, 0.);
+    for(uint64_t i = 0; i < n; ++i) for(uint64_t j = 0; j < n; ++j) sums[i] += distances[i * n + j];
+    for(uint64_t s = 0; s + 2 < n; ++s) {
+        const uint64_t numActive = active.size();
+        neighbor_joining::Candidate best;
+        for(uint64_t i : active) {
+            for(uint64_t j : active) {
+                if (i == j) continue;
+                // all pairs are equivalent for three active nodes
+                best.update((numActive == 3) ? 0. : distances[i * n + j] - (sums[i] / (numActive - 2) + sums[j] / (numActive - 2)), nodes[i], nodes[j]);
+            }
+        }
+        uint64_t i = 0, j = 0;
+        for(uint64_t k : active) {
+            if (nodes[k] == best.node1) i = k;
+            if (nodes[k] == best.node2) j = k;
+        }
+        const double dij = distances[i * n + j];
+        const double lengthI = dij / 2 + (sums[i] - sums[j]) / (2 * (numActive - 2));
+        tree.joins.push_back(NeighborJoiningJoin{nodes[i], nodes[j], max(lengthI, 0.), max(dij - lengthI, 0.)});
+        nodes[i] = n + s;
+        active.erase(find(active.begin(), active.end(), j));
+        for(uint64_t k : active) {
+            if (k == i) continue;
+            const float distance = (distances[i * n + k] + distances[j * n + k] - dij) / 2;
+            sums[k] += distance - distances[k * n + i] - distances[k * n + j];
+            distances[i * n + k] = distances[k * n + i] = distance;
+        }
+        sums[i] = 0;
+        for(uint64_t k : active) if (k != i) sums[i] += distances[i * n + k];
+    }
+    tree.lastNode1 = max(nodes[active[0]], nodes[active[1]]);
+    tree.lastNode2 = min(nodes[active[0]], nodes[active[1]]);
+    tree.lastLength = max<double>(distances[active[0] * n + active[1]], 0.);
+    return tree;
+}
+
+void checkTrees(const NeighborJoiningTree& tree, const NeighborJoiningTree& expected) {
+    assert(tree.n == expected.n && tree.joins.size() == expected.joins.size());
+    for(uint64_t s = 0; s < tree.joins.size(); ++s) {
+        assert(tree.joins[s].node1 == expected.joins[s].node1 && tree.joins[s].node2 == expected.joins[s].node2);
+        assert(fabs(tree.joins[s].length1 - expected.joins[s].length1) < 1e-4 && fabs(tree.joins[s].length2 - expected.joins[s].length2) < 1e-4);
+    }
+    assert(tree.lastNode1 == expected.lastNode1 && tree.lastNode2 == expected.lastNode2);
+    assert(fabs(tree.lastLength - expected.lastLength) < 1e-4);
+}
+
+// path lengths of a random tree, n leaves joined in random order, with multiplicative noise
+vector<float> generateTreeDistances(mt19937_64& rng, uint64_t n, double noise) {
+    uniform_real_distribution<double> lengthDistribution(0.01, 1.);
+    vector<vector<uint64_t>> subtrees(n);
+    for(uint64_t i = 0; i < n; ++i) subtrees[i].push_back(i);
+    vector<float> distances(n * n, 0.f);
+    vector<double> heights(n, 0.); // distance from every leaf to the root of its subtree
+    while (subtrees.size() > 1) {
+        const uint64_t a = rng() % subtrees.size();
+        uint64_t b = rng() % (subtrees.size() - 1);
+        if (b >= a) b += 1;
+        const double lengthA = lengthDistribution(rng);
+        const double lengthB = lengthDistribution(rng);
+        for(uint64_t x : subtrees[a]) {
+            for(uint64_t y : subtrees[b]) {
+                const double distance = (heights[x] + lengthA + heights[y] + lengthB) * (1 + noise * lengthDistribution(rng));
+                distances[x * n + y] = distances[y * n + x] = distance;
+            }
+        }
+        for(uint64_t x : subtrees[a]) heights[x] += lengthA;
+        for(uint64_t y : subtrees[b]) heights[y] += lengthB;
+        subtrees[a].insert(subtrees[a].end(), subtrees[b].begin(), subtrees[b].end());
+        subtrees.erase(subtrees.begin() + b);
+    }
+    return distances;
+}
+
+int main() {
+
+    mt19937_64 rng(UINT64_C(0x1e8f5c2a9b7d4036));
+
+    assert(getMashDistance(1., 21) == 0 && getMashDistance(0., 21) == 1 && getMashDistance(1e-300, 21) == 1);
+    assert(fabs(getMashDistance(0.5, 21) - (-log(2. / 3.) / 21)) < 1e-12);
+
+    // random distances and almost additive distances, small buckets such that the rows are rebuilt
+    for(uint64_t n : {2, 3, 4, 5, 10, 50, 300}) {
+        for(uint32_t bucketSize : {1, 4, 256}) {
+            vector<float> randomDistances(n * n, 0.f);
+            uniform_real_distribution<float> distribution(0.f, 1.f);
+            for(uint64_t i = 0; i < n; ++i) for(uint64_t j = 0; j < i; ++j) randomDistances[i * n + j] = randomDistances[j * n + i] = distribution(rng);
+            for(double noise : {-1., 0., 0.05}) {
+                vector<float> distances = (noise < 0) ? randomDistances : generateTreeDistances(rng, n, noise);
+                const NeighborJoiningTree expected = computeNaiveNeighborJoining(distances, n);
+                checkTrees(computeNeighborJoining(distances, n, bucketSize), expected);
+            }
+        }
+    }
+
+    // Newick output
+    {
+        const uint64_t n = 4;
+        vector<float> distances = {0, 3, 7, 8,
+                                   3, 0, 6, 7,
+                                   7, 6, 0, 5,
+                                   8, 7, 5, 0};
+        const NeighborJoiningTree tree = computeNeighborJoining(distances, n);
+        assert(getNewick(tree, {"A", "B", "C", "D"}) == "(C:2,D:3,(A:2,B:1):3);");
+        assert(getNewick(tree, {"A", "B b", "C:1", "it's"}) == "('C:1':2,'it''s':3,(A:2,'B b':1):3);");
+        vector<float> two = {0, 0.5, 0.5, 0};
+        assert(getNewick(computeNeighborJoining(two, 2), {"A", "B"}) == "(B:0.25,A:0.25);");
+        vector<float> one = {0};
+        assert(getNewick(computeNeighborJoining(one, 1), {"A"}) == "A;");
+    }
+
+    // Mash distances of signatures of a hierarchy of genomes, every genome differs from its parent in 5% of the
+    // components, and time compared with the naive algorithm
+    {
+        const uint32_t m = 1024;
+        const uint32_t k = 21;
+        for(uint64_t n : {1000, 5000}) {
+            vector<uint64_t> signatures(n * m);
+            for(uint64_t i = 0; i < n; ++i) {
+                const uint64_t parent = (i == 0) ? 0 : rng() % i;
+                for(uint32_t c = 0; c < m; ++c) signatures[i * m + c] = (i == 0 || rng() % 20 == 0) ? rng() : signatures[parent * m + c];
+            }
+            vector<float> distances = computeMashDistanceMatrix(signatures.data(), n, m, k);
+            assert(distances[1] == static_cast<float>(getMashDistance(countEqualComponents(signatures.data(), signatures.data() + m, m) / double(m), k)));
+            assert(distances[n] == distances[1] && distances[n + 1] == 0);
+
+            auto start = chrono::steady_clock::now();
+            NeighborJoiningTree expected;
+            if (n <= 1000) expected = computeNaiveNeighborJoining(distances, n);
+            auto naive = chrono::steady_clock::now();
+            const NeighborJoiningTree tree = computeNeighborJoining(distances, n);
+            auto end = chrono::steady_clock::now();
+            if (n <= 1000) checkTrees(tree, expected);
+            cout << "n = " << n << ", naive = " << ((n <= 1000) ? to_string(chrono::duration<double>(naive - start).count()) + " s" : string("-"));
+            cout << ", pruned = " << chrono::duration<double>(end - naive).count() << " s" << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "bitstream_random.hpp"
+#include "minhash.hpp"
+#include "data_generation.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace std;
+
+// Checks that the levels of NestedProbMinHash are identical to separately computed signatures, also with
+// BufferedWyrandBitStream, which is used for all levels and gives the same signatures, and compares
+// the mean squared error of the Jaccard estimates obtained from signature prefixes of NestedProbMinHash with
+// those obtained from prefixes of a single signature of full size.
+
+struct ExtractFunction {
+    uint64_t operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<0>(d);
+    }
+};
+
+class RNGFunction {
+    const uint64_t seed;
+public:
+
+    RNGFunction(uint64_t seed) : seed(seed) {}
+
+    WyrandBitStream operator()(const uint64_t& x) const {
+        return WyrandBitStream(x, seed);
+    }
+};
+
+class BufferedRNGFunction {
+    const uint64_t seed;
+public:
+
+    BufferedRNGFunction(uint64_t seed) : seed(seed) {}
+
+    BufferedWyrandBitStream operator()(const uint64_t& x) const {
+        return BufferedWyrandBitStream(x, seed);
+    }
+};
+
+static_assert(std::is_same<decltype(LevelRngFunction<BufferedRNGFunction>(BufferedRNGFunction(0), 1)(UINT64_C(0))), BufferedWyrandBitStream>::value, "Unexpected bit stream of the higher levels!");
+
+struct WeightFunction {
+    double operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<1>(d);
+    }
+};
+
+template<template<typename, typename, typename, typename, typename, typename> typename H, typename W>
+void testLevels(const vector<tuple<uint64_t,double>>& data, const vector<uint32_t>& levels, uint64_t seed) {
+    NestedProbMinHash<H, uint64_t, ExtractFunction, RNGFunction, W> nested(levels, ExtractFunction(), RNGFunction(seed));
+    const vector<uint64_t> signature = nested(data);
+    assert(signature.size() == levels.back());
+
+    H<uint64_t, ExtractFunction, RNGFunction, W, DynamicSize, DoublePrecision> firstLevel(levels[0], ExtractFunction(), RNGFunction(seed));
+    const vector<uint64_t> firstLevelSignature = firstLevel(data);
+    assert(equal(firstLevelSignature.begin(), firstLevelSignature.end(), signature.begin()));
+    for(uint32_t l = 1; l < levels.size(); ++l) {
+        H<uint64_t, ExtractFunction, LevelRngFunction<RNGFunction>, W, DynamicSize, DoublePrecision> level(
+            levels[l] - levels[l - 1], ExtractFunction(), LevelRngFunction<RNGFunction>(RNGFunction(seed), l));
+        const vector<uint64_t> levelSignature = level(data);
+        assert(equal(levelSignature.begin(), levelSignature.end(), signature.begin() + levels[l - 1]));
+    }
+
+    NestedProbMinHash<H, uint64_t, ExtractFunction, BufferedRNGFunction, W> bufferedNested(levels, ExtractFunction(), BufferedRNGFunction(seed));
+    assert(bufferedNested(data) == signature);
+}
+
+template<typename N, typename F>
+void testPrefixError(const Weights& w, const string& algorithmDescription, const vector<uint32_t>& levels, uint64_t numIterations, N&& nested, F&& full) {
+
+    mt19937_64 rng(UINT64_C(0x2d9e47b1c08f5a36));
+
+    vector<double> nestedSquaredErrors(levels.size());
+    vector<double> fullSquaredErrors(levels.size());
+    vector<double> nestedSumEstimates(levels.size());
+
+    for (uint64_t i = 0; i < numIterations; ++i) {
+        const auto data = generateData(rng, w);
+        const vector<uint64_t> nested1 = nested(get<0>(data));
+        const vector<uint64_t> nested2 = nested(get<1>(data));
+        const vector<uint64_t> full1 = full(get<0>(data));
+        const vector<uint64_t> full2 = full(get<1>(data));
+
+        for(uint32_t l = 0; l < levels.size(); ++l) {
+            uint32_t nestedNumEqual = 0;
+            uint32_t fullNumEqual = 0;
+            for(uint32_t j = 0; j < levels[l]; ++j) {
+                if (nested1[j] == nested2[j]) nestedNumEqual += 1;
+                if (full1[j] == full2[j]) fullNumEqual += 1;
+            }
+            const double nestedEstimate = static_cast<double>(nestedNumEqual) / levels[l];
+            const double fullEstimate = static_cast<double>(fullNumEqual) / levels[l];
+            nestedSumEstimates[l] += nestedEstimate;
+            nestedSquaredErrors[l] += (nestedEstimate - w.getJp()) * (nestedEstimate - w.getJp());
+            fullSquaredErrors[l] += (fullEstimate - w.getJp()) * (fullEstimate - w.getJp());
+        }
+    }
+
+    for(uint32_t l = 0; l < levels.size(); ++l) {
+        const double nestedMse = nestedSquaredErrors[l] / numIterations;
+        const double fullMse = fullSquaredErrors[l] / numIterations;
+        const double nestedMean = nestedSumEstimates[l] / numIterations;
+        cout << algorithmDescription << ": case = " << w.getId() << ", Jp = " << w.getJp() << ", prefix = " << levels[l];
+        cout << ", mse nested = " << nestedMse << ", mse prefix of full = " << fullMse << endl;
+        // unbiased within 5 standard errors
+        assert(abs(nestedMean - w.getJp()) <= 5 * sqrt(nestedMse / numIterations) + 1e-12);
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    const vector<uint32_t> levels = {64, 1024, 4096};
+
+    mt19937_64 rng(UINT64_C(0x58f1a3c60e27b94d));
+    exponential_distribution<double> exponentialDistribution(1.);
+    for(uint64_t dataSize : {1, 10, 1000, 10000}) {
+        vector<tuple<uint64_t,double>> data;
+        for(uint64_t i = 0; i < dataSize; ++i) data.emplace_back(rng(), exponentialDistribution(rng));
+        testLevels<ProbMinHash2, WeightFunction>(data, levels, UINT64_C(0x8c3f61d07a2e59b4));
+        testLevels<ProbMinHash4, WeightFunction>(data, levels, UINT64_C(0x13e7b0a9f46c2d85));
+        testLevels<ProbMinHash2, UnaryWeightFunction>(data, levels, UINT64_C(0x8c3f61d07a2e59b4));
+        testLevels<ProbMinHash4, UnaryWeightFunction>(data, levels, UINT64_C(0x13e7b0a9f46c2d85));
+        testLevels<ProbMinHash4, WeightFunction>(data, {2, 4, 7}, UINT64_C(0x13e7b0a9f46c2d85));
+    }
+
+    cout << setprecision(4) << scientific;
+
+    const uint64_t numIterations = 200;
+    const Weights unweighted = getWeightsCase_4e8536ff3d0c07af();
+    const Weights weighted = getWeightsCase_52d5eb9e59e690e7();
+
+    testPrefixError(unweighted, "ProbMinHash2", levels, numIterations,
+        NestedProbMinHash<ProbMinHash2, uint64_t, ExtractFunction, RNGFunction>(levels, ExtractFunction(), RNGFunction(UINT64_C(0xc8d7cc411fc10f3d))),
+        ProbMinHash2<uint64_t, ExtractFunction, RNGFunction>(levels.back(), ExtractFunction(), RNGFunction(UINT64_C(0xc8d7cc411fc10f3d))));
+    testPrefixError(unweighted, "ProbMinHash4", levels, numIterations,
+        NestedProbMinHash<ProbMinHash4, uint64_t, ExtractFunction, RNGFunction>(levels, ExtractFunction(), RNGFunction(UINT64_C(0x7f6ad5700f5c4cf0))),
+        ProbMinHash4<uint64_t, ExtractFunction, RNGFunction>(levels.back(), ExtractFunction(), RNGFunction(UINT64_C(0x7f6ad5700f5c4cf0))));
+    testPrefixError(weighted, "ProbMinHash2", levels, numIterations,
+        NestedProbMinHash<ProbMinHash2, uint64_t, ExtractFunction, RNGFunction, WeightFunction>(levels, ExtractFunction(), RNGFunction(UINT64_C(0x930bb771b6666420))),
+        ProbMinHash2<uint64_t, ExtractFunction, RNGFunction, WeightFunction>(levels.back(), ExtractFunction(), RNGFunction(UINT64_C(0x930bb771b6666420))));
+    testPrefixError(weighted, "ProbMinHash4", levels, numIterations,
+        NestedProbMinHash<ProbMinHash4, uint64_t, ExtractFunction, RNGFunction, WeightFunction>(levels, ExtractFunction(), RNGFunction(UINT64_C(0x02f7adcab92fdcbb))),
+        ProbMinHash4<uint64_t, ExtractFunction, RNGFunction, WeightFunction>(levels.back(), ExtractFunction(), RNGFunction(UINT64_C(0x02f7adcab92fdcbb))));
+
+    return 0;
+}
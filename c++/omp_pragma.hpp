@@ -0,0 +1,11 @@
+#ifndef _OMP_PRAGMA_HPP_
+#define _OMP_PRAGMA_HPP_
+
+// OpenMP pragmas, omitted without OpenMP support, which gives serial implementations
+#ifdef _OPENMP
+#define OMP_PRAGMA(x) _Pragma(#x)
+#else
+#define OMP_PRAGMA(x)
+#endif
+
+#endif // _OMP_PRAGMA_HPP_
@@ -0,0 +1,107 @@
+#include "minhash.hpp"
+#include "bitstream_random.hpp"
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+// Checks that ParallelNonStreamingProbMinHash2/4 give the same signatures as NonStreamingProbMinHash2/4
+// and compares the speed of the serial and the parallel variants. The number of passes (iterationCounter)
+// is the same for both variants, as it only depends on the hash values.
+
+struct ExtractFunction {
+    uint64_t operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<0>(d);
+    }
+};
+
+class RNGFunction {
+    const uint64_t seed;
+public:
+
+    RNGFunction(uint64_t seed) : seed(seed) {}
+
+    WyrandBitStream operator()(uint64_t x) const {
+        return WyrandBitStream(x, seed);
+    }
+};
+
+struct WeightFunction {
+    double operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<1>(d);
+    }
+};
+
+template<typename H>
+double measure(H& h, const vector<vector<tuple<uint64_t,double>>>& testData, vector<vector<uint64_t>>& results, uint64_t& iterationSum) {
+    results.clear();
+    iterationSum = 0;
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    for (const auto& data : testData) {
+        uint64_t iterationCounter;
+        results.push_back(h(data, &iterationCounter));
+        iterationSum += iterationCounter;
+    }
+    chrono::steady_clock::time_point tEnd = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::duration<double>>(tEnd - tStart).count() / testData.size();
+}
+
+template<template<typename, typename, typename, typename> typename H1, template<typename, typename, typename, typename> typename H2>
+void testCase(const vector<vector<tuple<uint64_t,double>>>& testData, uint32_t hashSize, double successProbabilityFirstRun, const string& label) {
+    RNGFunction rngFunction(UINT64_C(0x5e3a1f9b72c4d068));
+    H1<uint64_t, ExtractFunction, RNGFunction, WeightFunction> serial(hashSize, ExtractFunction(), rngFunction, WeightFunction(), successProbabilityFirstRun);
+    H2<uint64_t, ExtractFunction, RNGFunction, WeightFunction> parallel(hashSize, ExtractFunction(), rngFunction, WeightFunction(), successProbabilityFirstRun);
+
+    vector<vector<uint64_t>> serialResults;
+    vector<vector<uint64_t>> parallelResults;
+    uint64_t serialIterations;
+    uint64_t parallelIterations;
+    double serialTime = measure(serial, testData, serialResults, serialIterations);
+    double parallelTime = measure(parallel, testData, parallelResults, parallelIterations);
+
+    assert(serialResults == parallelResults);
+    assert(serialIterations == parallelIterations);
+
+    double avgIterations = static_cast<double>(serialIterations) / testData.size();
+    cout << label << ": m = " << hashSize << ", success probability first run = " << successProbabilityFirstRun;
+    cout << ", passes = " << avgIterations;
+    cout << ", serial = " << serialTime * 1e6 << "us (" << serialTime / avgIterations * 1e6 << "us/pass)";
+    cout << ", parallel = " << parallelTime * 1e6 << "us (" << parallelTime / avgIterations * 1e6 << "us/pass)";
+    cout << ", speedup = " << serialTime / parallelTime << endl;
+}
+
+int main(int argc, char* argv[]) {
+
+#ifdef _OPENMP
+    cout << "threads = " << omp_get_max_threads() << endl;
+#endif
+
+    mt19937_64 rng(UINT64_C(0x2b6e93d1a48f0c57));
+    exponential_distribution<double> weightDistribution(1.);
+
+    const uint64_t dataSize = 100000;
+    const uint64_t numCycles = 10;
+
+    vector<vector<tuple<uint64_t,double>>> testData(numCycles);
+    for(auto& data : testData) {
+        data.reserve(dataSize);
+        for(uint64_t i = 0; i < dataSize; ++i) data.emplace_back(rng(), weightDistribution(rng));
+        data.emplace_back(rng(), 0.); // elements with zero weight must be ignored
+    }
+
+    for(uint32_t hashSize : {256, 4096}) {
+        // a small success probability enforces multiple passes
+        for(double successProbabilityFirstRun : {0.9, 0.01}) {
+            testCase<NonStreamingProbMinHash2, ParallelNonStreamingProbMinHash2>(testData, hashSize, successProbabilityFirstRun, "ProbMinHash2");
+            testCase<NonStreamingProbMinHash4, ParallelNonStreamingProbMinHash4>(testData, hashSize, successProbabilityFirstRun, "ProbMinHash4");
+        }
+    }
+
+    return 0;
+}
@@ -33,6 +33,17 @@ public:
     }
 };
 
+class BufferedRNGFunction {
+    const uint64_t seed;
+public:
+
+    BufferedRNGFunction(uint64_t seed) : seed(seed) {}
+    
+    BufferedWyrandBitStream operator()(uint64_t x) const {
+        return BufferedWyrandBitStream(x, seed);
+    }
+};
+
 class RNGFunctionForSignatureComponents {
     const uint64_t seed;
 public:
@@ -80,12 +91,53 @@ void testWeightedCase(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t n
     testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, distributionLabel);
 }
 
+// uses BufferedWyrandBitStream instead of WyrandBitStream
+template<template<typename, typename, typename, typename> typename H, typename D, typename GEN>
+void testWeightedCaseBuffered(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel, const string& distributionLabel) {
+    H<uint64_t, ExtractFunction, BufferedRNGFunction, WeightFunction> h(hashSize, ExtractFunction(), BufferedRNGFunction(rng()));
+    testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, distributionLabel);
+}
+
+// uses a signature size fixed at compile time, if hashSize is supported by dispatchSize
+template<template<typename, typename, typename, typename, typename> typename H, typename D, typename GEN>
+void testWeightedCaseFixedSize(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel, const string& distributionLabel) {
+    dispatchSize(hashSize, [&](auto size) {
+        H<uint64_t, ExtractFunction, RNGFunction, WeightFunction, decltype(size)> h(size, ExtractFunction(), RNGFunction(rng()));
+        testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, distributionLabel);
+    });
+}
+
 template<template<typename, typename, typename> typename H, typename D, typename GEN>
 void testUnweightedCase(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel) {
     H<uint64_t, ExtractFunction, RNGFunction> h(hashSize, ExtractFunction(), RNGFunction(rng()));
     testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, "unweighted");
 }
 
+// uses a signature size fixed at compile time, if hashSize is supported by dispatchSize
+template<template<typename, typename, typename, typename, typename> typename H, typename D, typename GEN>
+void testUnweightedCaseFixedSize(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel) {
+    dispatchSize(hashSize, [&](auto size) {
+        H<uint64_t, ExtractFunction, RNGFunction, UnaryWeightFunction, decltype(size)> h(size, ExtractFunction(), RNGFunction(rng()));
+        testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, "unweighted");
+    });
+}
+
+// uses a signature size fixed at compile time, if hashSize is supported by dispatchSize
+template<typename D, typename GEN>
+void testUnweightedCaseFixedSizeSuperMinHash(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel) {
+    dispatchSize(hashSize, [&](auto size) {
+        SuperMinHash<uint64_t, ExtractFunction, RNGFunction, decltype(size)> h(size, ExtractFunction(), RNGFunction(rng()));
+        testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, "unweighted");
+    });
+}
+
+// uses BufferedWyrandBitStream instead of WyrandBitStream
+template<template<typename, typename, typename> typename H, typename D, typename GEN>
+void testUnweightedCaseBuffered(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel) {
+    H<uint64_t, ExtractFunction, BufferedRNGFunction> h(hashSize, ExtractFunction(), BufferedRNGFunction(rng()));
+    testCase(h, dataSize, hashSize, numCycles, testData, algorithmLabel, "unweighted");
+}
+
 template<typename D, typename GEN>
 void testUnweightedCaseOnePermutationHashingWithOptimalDensification(GEN& rng, uint64_t dataSize, uint32_t hashSize, uint64_t numCycles, const D& testData, const string& algorithmLabel) {
     OnePermutationHashingWithOptimalDensification<uint64_t, ExtractFunction, RNGFunction, RNGFunctionForSignatureComponents> h(hashSize, ExtractFunction(), RNGFunction(rng()), RNGFunctionForSignatureComponents(rng()));
@@ -119,12 +171,27 @@ template <typename GEN> void test(GEN& rng, uint32_t hashSize,uint64_t dataSize,
         testWeightedCase<PMinHash>(rng, dataSize, hashSize, numCycles, testData, "P-MinHash", distributionLabel);
         testWeightedCase<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1", distributionLabel);
         testWeightedCase<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a", distributionLabel);
+        testWeightedCase<ProbMinHash1b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1b", distributionLabel);
         testWeightedCase<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2", distributionLabel);
         testWeightedCase<NonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash2", distributionLabel);
+        testWeightedCase<ParallelNonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash2", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a", distributionLabel);
+        if(hashSize > 1) testWeightedCase<ProbMinHash3b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3b", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4", distributionLabel);
         if(hashSize > 1) testWeightedCase<NonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash4", distributionLabel);
+        if(hashSize > 1) testWeightedCase<ParallelNonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash4", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1 (FixedSize)", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a (FixedSize)", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2 (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3 (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4 (FixedSize)", distributionLabel);
+        testWeightedCaseBuffered<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1 (Buffered)", distributionLabel);
+        testWeightedCaseBuffered<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a (Buffered)", distributionLabel);
+        testWeightedCaseBuffered<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2 (Buffered)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseBuffered<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a (Buffered)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseBuffered<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4 (Buffered)", distributionLabel);
     }
     {
         const string distributionLabel = "pareto(1,0.5)";
@@ -144,12 +211,22 @@ template <typename GEN> void test(GEN& rng, uint32_t hashSize,uint64_t dataSize,
         testWeightedCase<PMinHash>(rng, dataSize, hashSize, numCycles, testData, "P-MinHash", distributionLabel);
         testWeightedCase<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1", distributionLabel);
         testWeightedCase<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a", distributionLabel);
+        testWeightedCase<ProbMinHash1b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1b", distributionLabel);
         testWeightedCase<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2", distributionLabel);
         testWeightedCase<NonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash2", distributionLabel);
+        testWeightedCase<ParallelNonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash2", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a", distributionLabel);
+        if(hashSize > 1) testWeightedCase<ProbMinHash3b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3b", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4", distributionLabel);
         if(hashSize > 1) testWeightedCase<NonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash4", distributionLabel);
+        if(hashSize > 1) testWeightedCase<ParallelNonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash4", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1 (FixedSize)", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a (FixedSize)", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2 (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3 (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4 (FixedSize)", distributionLabel);
     }
     {
         const string distributionLabel = "pareto(1,2)";
@@ -169,12 +246,22 @@ template <typename GEN> void test(GEN& rng, uint32_t hashSize,uint64_t dataSize,
         testWeightedCase<PMinHash>(rng, dataSize, hashSize, numCycles, testData, "P-MinHash", distributionLabel);
         testWeightedCase<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1", distributionLabel);
         testWeightedCase<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a", distributionLabel);
+        testWeightedCase<ProbMinHash1b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1b", distributionLabel);
         testWeightedCase<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2", distributionLabel);
         testWeightedCase<NonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash2", distributionLabel);
+        testWeightedCase<ParallelNonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash2", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a", distributionLabel);
+        if(hashSize > 1) testWeightedCase<ProbMinHash3b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3b", distributionLabel);
         if(hashSize > 1) testWeightedCase<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4", distributionLabel);
         if(hashSize > 1) testWeightedCase<NonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash4", distributionLabel);
+        if(hashSize > 1) testWeightedCase<ParallelNonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash4", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1 (FixedSize)", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a (FixedSize)", distributionLabel);
+        testWeightedCaseFixedSize<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2 (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3 (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a (FixedSize)", distributionLabel);
+        if(hashSize > 1) testWeightedCaseFixedSize<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4 (FixedSize)", distributionLabel);
     }
     { // unweighted case (weights constant 1)
 
@@ -192,14 +279,32 @@ template <typename GEN> void test(GEN& rng, uint32_t hashSize,uint64_t dataSize,
         testUnweightedCase<PMinHash>(rng, dataSize, hashSize, numCycles, testData, "P-MinHash");
         testUnweightedCase<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1");
         testUnweightedCase<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a");
+        testUnweightedCase<ProbMinHash1b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1b");
         testUnweightedCase<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2");
         testUnweightedCase<NonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash2");
+        testUnweightedCase<ParallelNonStreamingProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash2");
         if(hashSize > 1) testUnweightedCase<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3");
         if(hashSize > 1) testUnweightedCase<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a");
+        if(hashSize > 1) testUnweightedCase<ProbMinHash3b>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3b");
         if(hashSize > 1) testUnweightedCase<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4");
         if(hashSize > 1) testUnweightedCase<NonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "NonStreamingProbMinHash4");
+        if(hashSize > 1) testUnweightedCase<ParallelNonStreamingProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ParallelNonStreamingProbMinHash4");
+        testUnweightedCaseFixedSize<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1 (FixedSize)");
+        testUnweightedCaseFixedSize<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a (FixedSize)");
+        testUnweightedCaseFixedSize<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2 (FixedSize)");
+        if(hashSize > 1) testUnweightedCaseFixedSize<ProbMinHash3>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3 (FixedSize)");
+        if(hashSize > 1) testUnweightedCaseFixedSize<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a (FixedSize)");
+        if(hashSize > 1) testUnweightedCaseFixedSize<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4 (FixedSize)");
         testUnweightedCase<SuperMinHash>(rng, dataSize, hashSize, numCycles, testData, "SuperMinHash");
+        testUnweightedCaseFixedSizeSuperMinHash(rng, dataSize, hashSize, numCycles, testData, "SuperMinHash (FixedSize)");
         testUnweightedCase<MinHash>(rng, dataSize, hashSize, numCycles, testData, "MinHash");
+        testUnweightedCaseBuffered<ProbMinHash1>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1 (Buffered)");
+        testUnweightedCaseBuffered<ProbMinHash1a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash1a (Buffered)");
+        testUnweightedCaseBuffered<ProbMinHash2>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash2 (Buffered)");
+        if(hashSize > 1) testUnweightedCaseBuffered<ProbMinHash3a>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash3a (Buffered)");
+        if(hashSize > 1) testUnweightedCaseBuffered<ProbMinHash4>(rng, dataSize, hashSize, numCycles, testData, "ProbMinHash4 (Buffered)");
+        testUnweightedCaseBuffered<SuperMinHash>(rng, dataSize, hashSize, numCycles, testData, "SuperMinHash (Buffered)");
+        testUnweightedCaseBuffered<MinHash>(rng, dataSize, hashSize, numCycles, testData, "MinHash (Buffered)");
         testUnweightedCaseOnePermutationHashingWithOptimalDensification(rng, dataSize, hashSize, numCycles, testData, "OPH");
     }
 }
@@ -0,0 +1,83 @@
+#include "bitstream_random.hpp"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+// Checks that the compact (16-bit) and the wide (32-bit) layout of PermutationStream
+// generate identical permutations, also beyond the wrap-around of the 16-bit version counter,
+// and compares the speed of both layouts for m = 4096.
+
+template<typename P>
+double measure(P& permutationStream, uint32_t m, uint64_t numPermutations, uint32_t numElementsPerPermutation, uint64_t& consumer) {
+    chrono::steady_clock::time_point tStart = chrono::steady_clock::now();
+    for(uint64_t i = 0; i < numPermutations; ++i) {
+        WyrandBitStream bitStream(i, UINT64_C(0x8c4e3f1bbd1e0a23));
+        permutationStream.reset();
+        for(uint32_t j = 0; j < numElementsPerPermutation; ++j) {
+            consumer ^= permutationStream.next(bitStream);
+        }
+    }
+    chrono::steady_clock::time_point tEnd = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::duration<double>>(tEnd - tStart).count() / numPermutations;
+}
+
+int main(int argc, char* argv[]) {
+
+    {
+        const uint32_t m = 37;
+        PermutationStream<FixedSize<m>> compactStream(m);
+        PermutationStream<FixedSize<m>, uint32_t> wideStream(m);
+        PermutationStream<> dynamicStream(m);
+
+        uint64_t numPermutations = 200000; // > 2^16, covers bulk resets of the compact stream
+
+        for(uint64_t i = 0; i < numPermutations; ++i) {
+            WyrandBitStream bitStream1(i, UINT64_C(0x3a6d7e1c5b9f2048));
+            WyrandBitStream bitStream2(i, UINT64_C(0x3a6d7e1c5b9f2048));
+            WyrandBitStream bitStream3(i, UINT64_C(0x3a6d7e1c5b9f2048));
+            compactStream.reset();
+            wideStream.reset();
+            dynamicStream.reset();
+
+            // only a prefix of the permutation is consumed most of the time
+            uint32_t numElements = (i % 3 == 0) ? m : (i % 7);
+            vector<bool> seen(m, false);
+            for(uint32_t j = 0; j < numElements; ++j) {
+                uint32_t k1 = compactStream.next(bitStream1);
+                uint32_t k2 = wideStream.next(bitStream2);
+                uint32_t k3 = dynamicStream.next(bitStream3);
+                assert(k1 == k2);
+                assert(k1 == k3);
+                assert(k1 < m);
+                assert(!seen[k1]);
+                seen[k1] = true;
+            }
+        }
+    }
+
+    {
+        const uint32_t m = 4096;
+        uint64_t consumer = 0;
+
+        PermutationStream<FixedSize<m>> compactStream(m);
+        PermutationStream<FixedSize<m>, uint32_t> wideStream(m);
+        PermutationStream<> dynamicStream(m);
+
+        for(uint32_t numElements : {16, 256, 4096}) {
+            const uint64_t numPermutations = UINT64_C(0x1000000) / numElements;
+            double timeCompact = measure(compactStream, m, numPermutations, numElements, consumer);
+            double timeWide = measure(wideStream, m, numPermutations, numElements, consumer);
+            double timeDynamic = measure(dynamicStream, m, numPermutations, numElements, consumer);
+            cout << "m = " << m << ", elements per permutation = " << numElements;
+            cout << ", compact = " << timeCompact * 1e9 << "ns";
+            cout << ", wide = " << timeWide * 1e9 << "ns";
+            cout << ", dynamic = " << timeDynamic * 1e9 << "ns" << endl;
+        }
+        cout << consumer << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,275 @@
+#ifndef _POSTING_INDEX_HPP_
+#define _POSTING_INDEX_HPP_
+
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Inverted index mapping every (register index, register value) pair of a set of signatures to the sorted list of
+// ids of the signatures having this value at this register. A query looks up its m values, and the number of
+// postings of a signature equals its number of equal components with the query, hence only signatures sharing at
+// least one value are touched, instead of scanning the whole database.
+//
+// File layout (all integers in native byte order, files of the other byte order are rejected via the byte order mark):
+//     header:     the 8 bytes "PMHINV01", n (uint64), m (uint32), byte order mark 0x01020304 (uint32)
+//     directory:  for every register i, the offset of its block (uint64) and its number of distinct values (uint64)
+//     blocks:     for every register i, 8-byte aligned:
+//                     the distinct values in ascending order (uint64),
+//                     for every value the end of its posting list relative to the start of the posting lists (uint32),
+//                     padding to a multiple of 8 bytes,
+//                     the posting lists, every list is the sequence of ids in ascending order, where the first id and
+//                     the differences of consecutive ids are encoded as variable-length integers (7 bits per byte,
+//                     the highest bit is set in all but the last byte)
+// The index is built register by register and written sequentially, and it is memory-mapped read-only for queries.
+
+namespace posting_index {
+
+static const char MAGIC[8] = {'P', 'M', 'H', 'I', 'N', 'V', '0', '1'};
+static const uint64_t HEADER_SIZE = 8 + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+static const uint32_t BYTE_ORDER_MARK = UINT32_C(0x01020304);
+
+inline void appendVarint(std::vector<uint8_t>& bytes, uint64_t x) {
+    while (x >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(x) | 0x80);
+        x >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(x));
+}
+
+// reads a variable-length integer, never beyond end, p must be less than end
+inline uint64_t readVarint(const uint8_t*& p, const uint8_t* end) {
+    uint64_t x = 0;
+    uint32_t shift = 0;
+    while (p + 1 < end && (*p & 0x80)) {
+        if (shift < 64) x |= static_cast<uint64_t>(*p & 0x7F) << shift;
+        ++p;
+        shift += 7;
+    }
+    if (shift < 64) x |= static_cast<uint64_t>(*p & 0x7F) << shift;
+    ++p;
+    return x;
+}
+
+// offset of the posting lists of a block relative to the start of the block
+inline uint64_t getPostingsOffset(uint64_t numValues) {
+    return numValues * sizeof(uint64_t) + ((numValues * sizeof(uint32_t) + 7) & ~UINT64_C(7));
+}
+
+// block of one register as written to the file
+struct Block {
+    std::vector<uint64_t> values;
+    std::vector<uint32_t> postingEnds;
+    std::vector<uint8_t> postings;
+
+    uint64_t getSize() const {
+        return values.size() * sizeof(uint64_t) + ((postingEnds.size() * sizeof(uint32_t) + 7) & ~UINT64_C(7)) + ((postings.size() + 7) & ~UINT64_C(7));
+    }
+};
+
+inline Block buildBlock(const uint64_t* signatures, uint64_t n, uint32_t m, uint32_t i) {
+    std::vector<std::pair<uint64_t, uint64_t>> entries(n);
+    for (uint64_t j = 0; j < n; ++j) entries[j] = std::make_pair(signatures[j * m + i], j);
+    std::sort(entries.begin(), entries.end());
+    Block block;
+    for (uint64_t x = 0; x < n; ) {
+        uint64_t y = x;
+        uint64_t previous = 0;
+        for (; y < n && entries[y].first == entries[x].first; ++y) {
+            appendVarint(block.postings, entries[y].second - previous);
+            previous = entries[y].second;
+        }
+        block.values.push_back(entries[x].first);
+        block.postingEnds.push_back(block.postings.size());
+        x = y;
+    }
+    return block;
+}
+
+} // namespace posting_index
+
+// Builds the index of n signatures of size m stored contiguously, signature j starts at signatures + j * m.
+// The blocks of numParallelRegisters registers are built in parallel. Returns false if the file could not be written.
+inline bool writePostingIndex(const std::string& fileName, const uint64_t* signatures, uint64_t n, uint32_t m, uint32_t numParallelRegisters = 64) {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    out.write(posting_index::MAGIC, 8);
+    out.write(reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(&m), sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(&posting_index::BYTE_ORDER_MARK), sizeof(uint32_t));
+    std::vector<uint64_t> directory(2 * static_cast<uint64_t>(m), 0);
+    out.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(uint64_t));
+    uint64_t offset = posting_index::HEADER_SIZE + directory.size() * sizeof(uint64_t);
+    const char zeros[8] = {};
+    for (uint32_t first = 0; first < m; first += numParallelRegisters) {
+        const uint32_t last = std::min(m, first + numParallelRegisters);
+        std::vector<posting_index::Block> blocks(last - first);
+        OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+        for (int64_t i = first; i < static_cast<int64_t>(last); ++i) blocks[i - first] = posting_index::buildBlock(signatures, n, m, i);
+        for (uint32_t i = first; i < last; ++i) {
+            const auto& block = blocks[i - first];
+            directory[2 * i] = offset;
+            directory[2 * i + 1] = block.values.size();
+            out.write(reinterpret_cast<const char*>(block.values.data()), block.values.size() * sizeof(uint64_t));
+            out.write(reinterpret_cast<const char*>(block.postingEnds.data()), block.postingEnds.size() * sizeof(uint32_t));
+            out.write(zeros, (8 - (block.postingEnds.size() * sizeof(uint32_t)) % 8) % 8);
+            out.write(reinterpret_cast<const char*>(block.postings.data()), block.postings.size());
+            out.write(zeros, (8 - block.postings.size() % 8) % 8);
+            offset += block.getSize();
+        }
+    }
+    out.seekp(posting_index::HEADER_SIZE);
+    out.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(uint64_t));
+    out.close();
+    return out.good();
+}
+
+// Read-only memory mapping of an index written by writePostingIndex. good() returns false and getError() describes
+// the problem if the file could not be mapped or is not a valid index.
+class PostingIndex {
+    void* address = MAP_FAILED;
+    uint64_t mappedSize = 0;
+    uint64_t n = 0;
+    uint32_t m = 0;
+    const uint64_t* directory = nullptr;
+    std::string error;
+
+    bool fail(const std::string& message) {
+        if (address != MAP_FAILED) munmap(address, mappedSize);
+        address = MAP_FAILED;
+        error = message;
+        return false;
+    }
+
+    bool open(const std::string& fileName) {
+        const int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) return fail("cannot open " + fileName);
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<uint64_t>(status.st_size) < posting_index::HEADER_SIZE) {
+            ::close(fd);
+            return fail(fileName + " is too small for an index");
+        }
+        mappedSize = status.st_size;
+        address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) return fail("cannot map " + fileName);
+        const char* data = static_cast<const char*>(address);
+        if (std::memcmp(data, posting_index::MAGIC, 8) != 0) return fail(fileName + " is not an index");
+        uint32_t byteOrderMark;
+        std::memcpy(&byteOrderMark, data + 20, sizeof(uint32_t));
+        if (byteOrderMark != posting_index::BYTE_ORDER_MARK) return fail(fileName + " has a different byte order");
+        std::memcpy(&n, data + 8, sizeof(uint64_t));
+        std::memcpy(&m, data + 16, sizeof(uint32_t));
+        directory = reinterpret_cast<const uint64_t*>(data + posting_index::HEADER_SIZE);
+        if (posting_index::HEADER_SIZE + 2 * static_cast<uint64_t>(m) * sizeof(uint64_t) > mappedSize) return fail(fileName + " is truncated");
+        // the posting lists are decoded without further checks, hence their ends must lie within the mapping
+        for (uint32_t i = 0; i < m; ++i) {
+            const uint64_t offset = directory[2 * i];
+            const uint64_t numValues = directory[2 * i + 1];
+            if (offset % 8 != 0 || offset > mappedSize || numValues > (mappedSize - offset) / (sizeof(uint64_t) + sizeof(uint32_t))) return fail(fileName + " is truncated or corrupt");
+            const uint64_t postingsOffset = offset + posting_index::getPostingsOffset(numValues);
+            if (postingsOffset > mappedSize) return fail(fileName + " is truncated or corrupt");
+            const uint32_t* postingEnds = reinterpret_cast<const uint32_t*>(data + offset + numValues * sizeof(uint64_t));
+            for (uint64_t k = 0; k < numValues; ++k) {
+                if ((k > 0 && postingEnds[k] < postingEnds[k - 1]) || postingEnds[k] > mappedSize - postingsOffset) return fail(fileName + " is truncated or corrupt");
+            }
+        }
+        return true;
+    }
+
+    // calls consumer(id) for all ids of the posting list of value at register i, ids of a corrupt list that are not
+    // less than n are skipped
+    template<typename F>
+    void forEachPosting(uint32_t i, uint64_t value, F&& consumer) const {
+        const uint64_t numValues = directory[2 * i + 1];
+        const char* block = static_cast<const char*>(address) + directory[2 * i];
+        const uint64_t* values = reinterpret_cast<const uint64_t*>(block);
+        const uint32_t* postingEnds = reinterpret_cast<const uint32_t*>(values + numValues);
+        const uint8_t* postings = reinterpret_cast<const uint8_t*>(block) + posting_index::getPostingsOffset(numValues);
+        const uint64_t* it = std::lower_bound(values, values + numValues, value);
+        if (it == values + numValues || *it != value) return;
+        const uint64_t k = it - values;
+        const uint8_t* p = postings + ((k > 0) ? postingEnds[k - 1] : 0);
+        const uint8_t* end = postings + postingEnds[k];
+        uint64_t id = 0;
+        while (p < end) {
+            id += posting_index::readVarint(p, end);
+            if (id < n) consumer(id);
+        }
+    }
+
+public:
+
+    struct Hit {
+        uint64_t id;
+        uint32_t count; // number of equal components
+    };
+
+    explicit PostingIndex(const std::string& fileName) {
+        open(fileName);
+    }
+
+    PostingIndex(const PostingIndex&) = delete;
+    PostingIndex& operator=(const PostingIndex&) = delete;
+
+    ~PostingIndex() {
+        if (address != MAP_FAILED) munmap(address, mappedSize);
+    }
+
+    bool good() const {
+        return address != MAP_FAILED;
+    }
+
+    const std::string& getError() const {
+        return error;
+    }
+
+    uint64_t size() const {
+        return n;
+    }
+
+    uint32_t getSignatureSize() const {
+        return m;
+    }
+
+    // sets counts[j] to the number of equal components of the query and signature j, counts must have size n
+    void countEqualComponents(const uint64_t* query, uint32_t* counts) const {
+        std::fill(counts, counts + n, 0);
+        for (uint32_t i = 0; i < m; ++i) forEachPosting(i, query[i], [counts](uint64_t id) {counts[id] += 1;});
+    }
+
+    // Returns the at most k signatures with the most equal components with the query, at least minCount,
+    // ordered by decreasing count and increasing id. Only signatures sharing at least one value are touched.
+    std::vector<Hit> query(const uint64_t* query, uint64_t k, uint32_t minCount = 1) const {
+        std::vector<uint32_t> counts(n, 0);
+        std::vector<uint64_t> touched;
+        for (uint32_t i = 0; i < m; ++i) {
+            forEachPosting(i, query[i], [&](uint64_t id) {
+                if (counts[id]++ == 0) touched.push_back(id);
+            });
+        }
+        std::vector<Hit> hits;
+        for (uint64_t id : touched) if (counts[id] >= std::max(minCount, UINT32_C(1))) hits.push_back(Hit{id, counts[id]});
+        auto isBetter = [](const Hit& a, const Hit& b) {return a.count > b.count || (a.count == b.count && a.id < b.id);};
+        if (hits.size() > k) {
+            std::nth_element(hits.begin(), hits.begin() + k, hits.end(), isBetter);
+            hits.resize(k);
+        }
+        std::sort(hits.begin(), hits.end(), isBetter);
+        return hits;
+    }
+
+    uint64_t getSizeInBytes() const {
+        return mappedSize;
+    }
+};
+
+#endif // _POSTING_INDEX_HPP_
@@ -0,0 +1,143 @@
+#include "posting_index.hpp"
+#include "signature_comparison.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cassert>
+
+using namespace std;
+
+// Checks the counts and top hits of the inverted index against a naive comparison with all signatures, and
+// compares the query time with a scan of all signatures for a database with groups of similar signatures. Corrupt
+// posting lists must be rejected when mapping or skipped.
+
+// n signatures in groups of groupSize, every signature shares each component with the first of its group with probability p
+vector<uint64_t> generateSignatures(mt19937_64& rng, uint64_t n, uint32_t m, uint64_t groupSize, double p) {
+    vector<uint64_t> signatures(n * m);
+    for(uint64_t j = 0; j < n; ++j) {
+        for(uint32_t i = 0; i < m; ++i) {
+            const bool copy = (j % groupSize != 0) && uniform_real_distribution<double>(0., 1.)(rng) < p;
+            signatures[j * m + i] = copy ? signatures[(j - j % groupSize) * m + i] : rng();
+        }
+    }
+    return signatures;
+}
+
+int main(int argc, char* argv[]) {
+
+    const string fileName = (argc > 1) ? string(argv[1]) : string("posting_index_test.pmi");
+    mt19937_64 rng(UINT64_C(0x91a4c70f2e8d36b5));
+
+    for(uint64_t n : {1, 2, 100, 1000}) {
+        for(uint32_t m : {1, 3, 64}) {
+            // small alphabet such that posting lists are long, and large ids with multi-byte varints
+            vector<uint64_t> signatures(n * m);
+            for(auto& x : signatures) x = rng() % 5;
+            assert(writePostingIndex(fileName, signatures.data(), n, m, 2));
+            PostingIndex index(fileName);
+            assert(index.good() && index.size() == n && index.getSignatureSize() == m);
+            for(uint64_t q = 0; q < 5; ++q) {
+                vector<uint64_t> query(m);
+                for(auto& x : query) x = rng() % 6;
+                vector<uint32_t> expected(n);
+                for(uint64_t j = 0; j < n; ++j) expected[j] = countEqualComponents(query.data(), signatures.data() + j * m, m);
+                vector<uint32_t> counts(n);
+                index.countEqualComponents(query.data(), counts.data());
+                assert(counts == expected);
+
+                const uint64_t k = 7;
+                const uint32_t minCount = m / 4;
+                const auto hits = index.query(query.data(), k, minCount);
+                vector<PostingIndex::Hit> expectedHits;
+                for(uint64_t j = 0; j < n; ++j) if (expected[j] >= max(minCount, UINT32_C(1))) expectedHits.push_back(PostingIndex::Hit{j, expected[j]});
+                stable_sort(expectedHits.begin(), expectedHits.end(), [](const PostingIndex::Hit& a, const PostingIndex::Hit& b) {return a.count > b.count;});
+                if (expectedHits.size() > k) expectedHits.resize(k);
+                assert(hits.size() == expectedHits.size());
+                for(uint64_t h = 0; h < hits.size(); ++h) assert(hits[h].id == expectedHits[h].id && hits[h].count == expectedHits[h].count);
+            }
+        }
+    }
+
+    // invalid files
+    {
+        vector<uint64_t> signatures(10 * 4, 1);
+        assert(writePostingIndex(fileName, signatures.data(), 10, 4));
+        {
+            fstream f(fileName, ios::binary | ios::in | ios::out);
+            f.write("X", 1);
+        }
+        assert(!PostingIndex(fileName).good());
+        assert(!PostingIndex(fileName + ".missing").good());
+
+        // other byte order
+        const uint32_t byteOrderMark = UINT32_C(0x04030201);
+        assert(writePostingIndex(fileName, signatures.data(), 10, 4));
+        {
+            fstream f(fileName, ios::binary | ios::in | ios::out);
+            f.seekp(20);
+            f.write(reinterpret_cast<const char*>(&byteOrderMark), sizeof(uint32_t));
+        }
+        assert(!PostingIndex(fileName).good() && PostingIndex(fileName).getError().find("byte order") != string::npos);
+
+        // every register has the single value 1, its block starts after the header and the directory of 4 registers
+        // with the value, the end of the posting list, padding, and the 10 one-byte ids
+        const uint64_t blockOffset = 8 + 8 + 8 + 4 * 16;
+        const uint32_t postingEnd = 1000;
+        assert(writePostingIndex(fileName, signatures.data(), 10, 4));
+        {
+            fstream f(fileName, ios::binary | ios::in | ios::out);
+            f.seekp(blockOffset + 8);
+            f.write(reinterpret_cast<const char*>(&postingEnd), sizeof(uint32_t));
+        }
+        assert(!PostingIndex(fileName).good());
+
+        // an id beyond the number of signatures is skipped
+        assert(writePostingIndex(fileName, signatures.data(), 10, 4));
+        {
+            fstream f(fileName, ios::binary | ios::in | ios::out);
+            f.seekp(blockOffset + 16 + 9);
+            f.write("\x7f", 1);
+        }
+        PostingIndex index(fileName);
+        assert(index.good());
+        vector<uint32_t> counts(10);
+        index.countEqualComponents(signatures.data(), counts.data());
+        assert(counts == vector<uint32_t>({4, 4, 4, 4, 4, 4, 4, 4, 4, 3}));
+    }
+
+    // query time compared to a scan, groups of 10 similar signatures
+    {
+        const uint64_t n = 200000;
+        const uint32_t m = 128;
+        const auto signatures = generateSignatures(rng, n, m, 10, 0.9);
+        auto start = chrono::steady_clock::now();
+        assert(writePostingIndex(fileName, signatures.data(), n, m));
+        auto built = chrono::steady_clock::now();
+        PostingIndex index(fileName);
+        const uint64_t numQueries = 100;
+        uint64_t checksum = 0;
+        auto queried = chrono::steady_clock::now();
+        for(uint64_t q = 0; q < numQueries; ++q) {
+            const auto hits = index.query(signatures.data() + (q * 997) % n * m, 10);
+            assert(!hits.empty() && hits[0].count == m);
+            checksum += hits.size();
+        }
+        auto end = chrono::steady_clock::now();
+        vector<uint32_t> counts(n);
+        for(uint64_t q = 0; q < numQueries; ++q) {
+            countEqualComponentsOneToMany(signatures.data() + (q * 997) % n * m, signatures.data(), index.size(), m, counts.data());
+            checksum += counts[0];
+        }
+        auto scanned = chrono::steady_clock::now();
+        cout << "n = " << n << ", m = " << m << ", build = " << chrono::duration<double>(built - start).count() << " s";
+        cout << ", index size = " << index.getSizeInBytes() / double(n * m * sizeof(uint64_t)) << " x signatures";
+        cout << ", index query = " << chrono::duration<double>(end - queried).count() / numQueries * 1e3 << " ms";
+        cout << ", scan = " << chrono::duration<double>(scanned - end).count() / numQueries * 1e3 << " ms (checksum = " << checksum << ")" << endl;
+    }
+    remove(fileName.c_str());
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "bitstream_random.hpp"
+#include "minhash.hpp"
+#include "data_generation.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace std;
+
+// Compares the estimation error of ProbMinHash with registers stored in single precision (SinglePrecision, FloatBitsPrecision)
+// against the double precision baseline. For each case, the same data and the same random sequences are used for all precisions.
+// Besides the mean and the variance of the Jaccard estimate, the fraction of signature components that differ from the
+// double precision signature is reported.
+
+struct ExtractFunction {
+    uint64_t operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<0>(d);
+    }
+};
+
+class RNGFunction {
+    const uint64_t seed;
+public:
+
+    RNGFunction(uint64_t seed) : seed(seed) {}
+
+    WyrandBitStream operator()(const uint64_t& x) const {
+        return WyrandBitStream(x, seed);
+    }
+};
+
+struct WeightFunction {
+    double operator()(const std::tuple<uint64_t,double>& d) const {
+        return std::get<1>(d);
+    }
+};
+
+template<template<typename, typename, typename, typename, typename, typename> typename H, typename W>
+void testCase(const Weights& w, const string& algorithmDescription, uint32_t m, uint64_t numIterations, uint64_t seed) {
+
+    const string precisionDescriptions[] = {"double", "float", "float bits"};
+
+    uint64_t seedSize = 256;
+
+    // arbitrary fixed values, such that the results are reproducible
+    seed_seq initialSeedSequence{
+        UINT32_C(0x3f7a2c91), UINT32_C(0x8e04b6d5), UINT32_C(0x51c9e73a), UINT32_C(0xd2b80f46),
+        UINT32_C(0x7c16a5e8), UINT32_C(0x09f3d42b), UINT32_C(0xa65e917c), UINT32_C(0x4bd20c63)};
+
+    mt19937 initialRng(initialSeedSequence);
+    vector<uint32_t> seeds(numIterations * seedSize);
+    generate(seeds.begin(), seeds.end(), initialRng);
+
+    // sums of estimates, squared estimates, and components different from the double precision signatures
+    vector<double> sumEstimates(3);
+    vector<double> sumSquaredEstimates(3);
+    vector<uint64_t> numDifferentComponents(3);
+
+    #pragma omp parallel
+    {
+        H<uint64_t, ExtractFunction, RNGFunction, W, DynamicSize, DoublePrecision> hDouble(m, ExtractFunction(), RNGFunction(seed));
+        H<uint64_t, ExtractFunction, RNGFunction, W, DynamicSize, SinglePrecision> hSingle(m, ExtractFunction(), RNGFunction(seed));
+        H<uint64_t, ExtractFunction, RNGFunction, W, DynamicSize, FloatBitsPrecision> hFloatBits(m, ExtractFunction(), RNGFunction(seed));
+
+        #pragma omp for
+        for (uint64_t i = 0; i < numIterations; ++i) {
+
+            seed_seq seedSequence(seeds.begin() + i * seedSize, seeds.begin() + (i + 1) * seedSize);
+            mt19937_64 rng(seedSequence);
+
+            const tuple<vector<tuple<uint64_t,double>>,vector<tuple<uint64_t,double>>> data = generateData(rng, w);
+
+            const vector<tuple<uint64_t,double>>& d1 = get<0>(data);
+            const vector<tuple<uint64_t,double>>& d2 = get<1>(data);
+
+            const vector<uint64_t> signatures1[] = {hDouble(d1), hSingle(d1), hFloatBits(d1)};
+            const vector<uint64_t> signatures2[] = {hDouble(d2), hSingle(d2), hFloatBits(d2)};
+
+            for (uint32_t p = 0; p < 3; ++p) {
+                uint32_t numEqual = 0;
+                uint32_t numDifferent = 0;
+                for (uint32_t j = 0; j < m; ++j)  {
+                    if (signatures1[p][j] == signatures2[p][j]) numEqual += 1;
+                    if (signatures1[p][j] != signatures1[0][j]) numDifferent += 1;
+                    if (signatures2[p][j] != signatures2[0][j]) numDifferent += 1;
+                }
+                const double estimate = static_cast<double>(numEqual) / m;
+
+                #pragma omp atomic
+                sumEstimates[p] += estimate;
+                #pragma omp atomic
+                sumSquaredEstimates[p] += estimate * estimate;
+                #pragma omp atomic
+                numDifferentComponents[p] += numDifferent;
+            }
+        }
+    }
+
+    cout << setprecision(numeric_limits< double >::max_digits10) << scientific;
+    for (uint32_t p = 0; p < 3; ++p) {
+        const double mean = sumEstimates[p] / numIterations;
+        const double variance = sumSquaredEstimates[p] / numIterations - mean * mean;
+        cout << w.getId() << ";";
+        cout << algorithmDescription << ";";
+        cout << precisionDescriptions[p] << ";";
+        cout << m << ";";
+        cout << numIterations << ";";
+        cout << w.getJp() << ";";
+        cout << mean << ";";
+        cout << mean - w.getJp() << ";";
+        cout << mean - sumEstimates[0] / numIterations << ";";
+        cout << variance << ";";
+        cout << static_cast<double>(numDifferentComponents[p]) / (2 * m * numIterations) << endl;
+    }
+    cout << flush;
+}
+
+void testCase(const Weights& w, uint32_t hashSize, uint64_t numIterations) {
+    if (w.allWeightsZeroOrOne()) {
+        testCase<ProbMinHash2, UnaryWeightFunction>(w, "ProbMinHash2", hashSize, numIterations, UINT64_C(0xc8d7cc411fc10f3d));
+        testCase<ProbMinHash4, UnaryWeightFunction>(w, "ProbMinHash4", hashSize, numIterations, UINT64_C(0x7f6ad5700f5c4cf0));
+    } else {
+        testCase<ProbMinHash2, WeightFunction>(w, "ProbMinHash2", hashSize, numIterations, UINT64_C(0x930bb771b6666420));
+        testCase<ProbMinHash4, WeightFunction>(w, "ProbMinHash4", hashSize, numIterations, UINT64_C(0x02f7adcab92fdcbb));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    cout << "caseId" << ";";
+    cout << "algorithmDescription" << ";";
+    cout << "precision" << ";";
+    cout << "hashSize" << ";";
+    cout << "numIterations" << ";";
+    cout << "Jp" << ";";
+    cout << "meanEstimate" << ";";
+    cout << "bias" << ";";
+    cout << "biasChangeVsDouble" << ";";
+    cout << "varianceEstimate" << ";";
+    cout << "fractionDifferentComponents";
+    cout << endl;
+    cout << flush;
+
+    uint32_t hashSizes[] = {16, 256, 4096};
+
+    uint64_t numIterations = 1000;
+
+    vector<Weights> cases = {
+        getWeightsCase_075be894225e78f7(),
+        getWeightsCase_0a92d95c38b0bec5(),
+        getWeightsCase_29baac0d70950228(),
+        getWeightsCase_4e8536ff3d0c07af(),
+        getWeightsCase_52d5eb9e59e690e7(),
+        getWeightsCase_83f19a65b7f42e88(),
+        getWeightsCase_ae7f50b05c6ea2dd(),
+        getWeightsCase_dae81d77e5c7e0c3(),
+        getWeightsCase_a9415c152258dac1(),
+        getWeightsCase_431c7f212064fc5d(),
+        getWeightsCase_8d6bb210472266c3(),
+        getWeightsCase_8a224349623eeb24()
+        };
+
+    for (uint32_t hashSize : hashSizes) {
+        for (const Weights& w : cases) {
+            testCase(w, hashSize, numIterations);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef _PRECISION_POLICY_HPP_
+#define _PRECISION_POLICY_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+// Precision policies for the register values of MaxValueTracker. Hash values are always
+// generated in double precision and only converted when compared with or stored into registers.
+// As all conversions are monotonic, the early termination conditions remain valid. However, as
+// registers are only updated for strictly smaller values, ties caused by rounding are won by the
+// element that was processed first.
+
+// register values as double (default), gives exact results
+struct DoublePrecision {
+    typedef double RegisterType;
+
+    static double toRegister(double h) {
+        return h;
+    }
+};
+
+// register values as float, halves the memory of the registers
+struct SinglePrecision {
+    typedef float RegisterType;
+
+    static float toRegister(double h) {
+        return static_cast<float>(h);
+    }
+};
+
+// register values as bit patterns of the corresponding float values, which are ordered like unsigned
+// integers for non-negative values, allows integer comparisons
+struct FloatBitsPrecision {
+    typedef uint32_t RegisterType;
+
+    static uint32_t toRegister(double h) {
+        const float f = static_cast<float>(h);
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(uint32_t));
+        return bits;
+    }
+};
+
+#endif // _PRECISION_POLICY_HPP_
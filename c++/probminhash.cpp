@@ -0,0 +1,976 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <csignal>
+
+#include "genome_sketching.hpp"
+#include "bbit_signature.hpp"
+#include "all_vs_all.hpp"
+#include "distance_writer.hpp"
+#include "clustering.hpp"
+#include "neighbor_joining.hpp"
+#include "lsh_index.hpp"
+#include "sketch_file.hpp"
+#include "sketch_cache.hpp"
+#include "sketch_database.hpp"
+#include "posting_index.hpp"
+#include "batch_query.hpp"
+#include "query_server.hpp"
+
+// Herramienta de línea de comandos para calcular y comparar firmas de genomas.
+//
+// uso: probminhash compare [-k 16,21,31] [-m 1024] [-a probminhash1,minhash] [-t 0.9] [-e 0.001] [-b 8] archivo1.fna archivo2.fna ...
+//
+// Cada genoma se lee, decodifica y sus k-mers se hashean y cuentan una sola vez para todos los valores de k
+// y todos los algoritmos. Con -t solo se muestran los pares con similitud mayor o igual al umbral, y la comparación
+// de cada par se detiene apenas el resultado está decidido con probabilidad de error a lo más -e. Con -b se
+// comparan firmas de b bits por componente (b-bit minwise hashing), que ocupan 64/b veces menos memoria.
+//
+// uso: probminhash search [-k 21] [-l 64,1024,4096] [-t 0.9] consulta.fna archivo1.fna archivo2.fna ...
+//
+// Busca los genomas con similitud mayor o igual al umbral usando firmas anidadas de ProbMinHash4: primero se
+// comparan solo los primeros 64 componentes y solo los candidatos prometedores se comparan con más componentes.
+//
+// uso: probminhash sketch [-k 21] [-m 1024] [-a probminhash1] [-f lista.txt] [-c cache] -o firmas.pmh archivo1.fna ...
+//
+// Calcula las firmas de los genomas en paralelo y las guarda en un archivo binario (ver sketch_file.hpp) junto con
+// k, m, el algoritmo y la semilla, de modo que las consultas posteriores no vuelvan a leer los archivos FASTA.
+// Con -c las firmas se guardan también en un caché por contenido (ver sketch_cache.hpp) y en las siguientes
+// ejecuciones solo se calculan las firmas de los archivos nuevos o modificados (también en allvsall).
+//
+// uso: probminhash allvsall [-k 21] [-m 1024] [-a probminhash1] [-f lista.txt] [-c cache] [-d firmas.pmh] [-o matriz.bin] [-F conteos] [-t 0.9] [-C clusters.tsv [-medoides]] [-nj arbol.nwk] [-lsh] archivo1.fna ...
+//
+// Compara todos los pares de genomas (los archivos indicados y los listados en lista.txt, uno por línea) en
+// bloques que caben en el caché y en paralelo. Con -o se escribe la matriz completa en formato binario
+// (ver CondensedMatrixWriter en distance_writer.hpp), con -t se muestran solo los pares que alcanzan el umbral.
+// Con -F se elige otro formato para -o (ver distance_writer.hpp): f16 o f32 escriben el triángulo inferior de las
+// distancias de Jaccard como float16 o float32, aristas solo los pares que alcanzan el umbral de -t y phylip la
+// matriz triangular inferior en formato PHYLIP. En todos los formatos la matriz se escribe por bloques de filas desde
+// un hilo aparte mientras se comparan los bloques siguientes. Con -C (requiere -t) los genomas se agrupan en clusters
+// (componentes conexas de los pares que alcanzan el umbral) a medida que se comparan, con una estructura union-find
+// concurrente (ver clustering.hpp), y se escribe el cluster de cada genoma en lugar de los pares; con -medoides
+// además el medoide de su cluster, el genoma más parecido en promedio a los demás miembros. Con -nj (sin -o, -t ni
+// -lsh) se construye el árbol de neighbor joining de las distancias de Mash entre las firmas (ver
+// neighbor_joining.hpp) y se escribe en formato Newick.
+// Con -lsh (requiere -t, sin -o) solo se comparan los pares que comparten al menos una banda de la firma
+// (ver LshIndex en lsh_index.hpp), lo que evita la comparación cuadrática a costa de perder algunos pares
+// cercanos al umbral. Con -d las firmas se leen (mapeadas en memoria) de un archivo creado con sketch, en lugar
+// de calcularlas, y k, m y el algoritmo se toman del archivo.
+//
+// uso: probminhash add -d base [-k 21] [-m 1024] [-a probminhash1] [-f lista.txt] [-c cache] archivo1.fna ...
+//      probminhash remove -d base archivo1.fna ...
+//      probminhash update -d base [-t 0.9]
+//
+// Base de datos persistente de firmas en un directorio (ver sketch_database.hpp). add agrega las firmas de nuevos
+// genomas sin reescribir las existentes, remove marca genomas como eliminados y update calcula solo las similitudes
+// de los genomas agregados desde la última actualización con todos los demás y las agrega al archivo de distancias.
+// Con -t se muestran los pares nuevos que alcanzan el umbral.
+//
+// uso: probminhash index -d firmas.pmh -o indice.pmi
+//      probminhash screen -d firmas.pmh [-i indice.pmi] [-n 10] [-t 0.1] muestra1.fna ...
+//
+// index construye un índice invertido de las firmas de un archivo creado con sketch, que asocia cada par
+// (componente, valor) con la lista comprimida de genomas que lo tienen (ver posting_index.hpp). screen calcula la firma
+// de cada muestra con los parámetros del archivo y muestra los -n genomas con más componentes iguales. Con -i se
+// recorren solo las m listas de la consulta en lugar de todas las firmas. Sin -i se comparan todas las muestras con
+// todas las firmas, recorriendo el archivo por bloques que caben en el caché una sola vez para todas las muestras
+// (ver batch_query.hpp). Con -t solo se muestran los que alcanzan el umbral.
+//
+// uso: probminhash serve -d firmas.pmh -s socket [-w 0]
+//      probminhash query -s socket [-n 10] [-t 0.1] muestra1.fna ...
+//      probminhash stats -s socket
+//
+// serve mantiene el archivo de firmas mapeado en memoria y responde consultas por un socket Unix hasta recibir
+// SIGINT o SIGTERM (ver query_server.hpp). Las consultas que llegan al mismo tiempo se responden juntas con una sola
+// pasada por el archivo, -w indica cuántos microsegundos esperar más consultas antes de procesar un lote. Si el
+// archivo cambia se vuelve a cargar sin detener el servidor. query envía el contenido de cada muestra, que el
+// servidor procesa con los parámetros del archivo, y muestra los resultados como screen. stats muestra los contadores
+// y percentiles de la latencia de las consultas (en microsegundos).
+
+struct Options {
+    std::vector<uint32_t> ks = {21};         // largos de k-mer
+    uint32_t m = 1024;                       // tamaño de la firma
+    std::vector<std::string> algorithms = {"probminhash1"}; // algoritmos de minhash
+    std::vector<uint32_t> levels = {64, 1024, 4096}; // niveles de las firmas anidadas (search)
+    double threshold = 0.9;                  // umbral de similitud
+    bool hasThreshold = false;               // true si se indicó -t
+    double errorRate = 1e-3;                 // probabilidad de error de la comparación con umbral (compare)
+    uint32_t bits = 64;                      // bits por componente de la firma (compare)
+    std::string output;                      // archivo binario de la matriz (allvsall)
+    std::string format = "conteos";          // formato de la matriz: conteos, f16, f32, aristas o phylip (allvsall)
+    std::string clusters;                    // archivo de los clusters (allvsall)
+    bool medoids = false;                    // agregar el medoide de cada cluster (allvsall)
+    std::string tree;                        // archivo del árbol de neighbor joining (allvsall)
+    bool lsh = false;                        // comparar solo los candidatos de LSH (allvsall)
+    std::string database;                    // archivo de firmas creado con sketch (allvsall)
+    std::string cacheDirectory;              // directorio del caché de firmas (sketch, allvsall)
+    std::string index;                       // índice invertido (screen)
+    uint64_t numResults = 10;                // cantidad de resultados por consulta (screen, query)
+    std::string socket;                      // socket Unix del servidor (serve, query, stats)
+    uint64_t batchWindow = 0;                // espera en microsegundos para agrupar consultas (serve)
+    std::vector<std::string> files;          // archivos FASTA
+};
+
+void printUsage() {
+    std::cerr << "uso: probminhash compare [-k 16,21,31] [-m 1024] [-a algoritmo1,algoritmo2] [-t 0.9] [-e 0.001] [-b 8] archivo1.fna archivo2.fna ...\n";
+    std::cerr << "     probminhash search [-k 21] [-l 64,1024,4096] [-t 0.9] consulta.fna archivo1.fna ...\n";
+    std::cerr << "     probminhash sketch [-k 21] [-m 1024] [-a algoritmo] [-f lista.txt] [-c cache] -o firmas.pmh archivo1.fna ...\n";
+    std::cerr << "     probminhash allvsall [-k 21] [-m 1024] [-a algoritmo] [-f lista.txt] [-c cache] [-d firmas.pmh] [-o matriz.bin] [-F conteos|f16|f32|aristas|phylip] [-t 0.9] [-C clusters.tsv [-medoides]] [-nj arbol.nwk] [-lsh] archivo1.fna ...\n";
+    std::cerr << "     probminhash add -d base [-k 21] [-m 1024] [-a algoritmo] [-f lista.txt] [-c cache] archivo1.fna ...\n";
+    std::cerr << "     probminhash remove -d base archivo1.fna ...\n";
+    std::cerr << "     probminhash update -d base [-t 0.9]\n";
+    std::cerr << "     probminhash index -d firmas.pmh -o indice.pmi\n";
+    std::cerr << "     probminhash screen -d firmas.pmh [-i indice.pmi] [-n 10] [-t 0.1] muestra1.fna ...\n";
+    std::cerr << "     probminhash serve -d firmas.pmh -s socket [-w 0]\n";
+    std::cerr << "     probminhash query -s socket [-n 10] [-t 0.1] muestra1.fna ...\n";
+    std::cerr << "     probminhash stats -s socket\n";
+    std::cerr << "algoritmos: probminhash1, probminhash2, probminhash4 (ponderados), minhash, superminhash, oph (no ponderados)\n";
+}
+
+// Separa una lista separada por comas
+std::vector<std::string> splitList(const std::string &s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) items.push_back(item);
+    return items;
+}
+
+// Convierte una lista separada por comas (por ejemplo "16,21,31") en los largos de k-mer
+std::vector<uint32_t> parseKs(const std::string &s) {
+    std::vector<uint32_t> ks;
+    for (const auto &item : splitList(s)) {
+        int k = std::stoi(item);
+        if (k < 1 || k > (int)MAX_K) {
+            std::cerr << "k debe estar entre 1 y " << MAX_K << "\n";
+            exit(1);
+        }
+        ks.push_back(k);
+    }
+    return ks;
+}
+
+// Convierte una lista separada por comas (por ejemplo "64,1024,4096") en los niveles de las firmas anidadas
+std::vector<uint32_t> parseLevels(const std::string &s) {
+    std::vector<uint32_t> levels;
+    for (const auto &item : splitList(s)) {
+        int m = std::stoi(item);
+        if (m < 2 || (!levels.empty() && m < (int)levels.back() + 2)) {
+            std::cerr << "los niveles deben ser crecientes, con diferencias de al menos 2\n";
+            exit(1);
+        }
+        levels.push_back(m);
+    }
+    return levels;
+}
+
+Options parseOptions(int argc, char* argv[], int first) {
+    Options options;
+    for (int i = first; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-k" || arg == "-m" || arg == "-a" || arg == "-l" || arg == "-t" || arg == "-e" || arg == "-b" || arg == "-f" || arg == "-o" || arg == "-d" || arg == "-c" || arg == "-i" || arg == "-n" || arg == "-s" || arg == "-w" || arg == "-F" || arg == "-C" || arg == "-nj") && i + 1 >= argc) {
+            printUsage();
+            exit(1);
+        }
+        if (arg == "-k") options.ks = parseKs(argv[++i]);
+        else if (arg == "-m") options.m = std::stoul(argv[++i]);
+        else if (arg == "-a") options.algorithms = splitList(argv[++i]);
+        else if (arg == "-l") options.levels = parseLevels(argv[++i]);
+        else if (arg == "-t") {
+            options.threshold = std::stod(argv[++i]);
+            options.hasThreshold = true;
+        }
+        else if (arg == "-e") options.errorRate = std::stod(argv[++i]);
+        else if (arg == "-b") options.bits = std::stoul(argv[++i]);
+        else if (arg == "-o") options.output = argv[++i];
+        else if (arg == "-F") options.format = argv[++i];
+        else if (arg == "-C") options.clusters = argv[++i];
+        else if (arg == "-medoides") options.medoids = true;
+        else if (arg == "-nj") options.tree = argv[++i];
+        else if (arg == "-lsh") options.lsh = true;
+        else if (arg == "-d") options.database = argv[++i];
+        else if (arg == "-c") options.cacheDirectory = argv[++i];
+        else if (arg == "-i") options.index = argv[++i];
+        else if (arg == "-n") options.numResults = std::stoull(argv[++i]);
+        else if (arg == "-s") options.socket = argv[++i];
+        else if (arg == "-w") options.batchWindow = std::stoull(argv[++i]);
+        else if (arg == "-f") {
+            std::ifstream in(argv[++i]);
+            if (!in) {
+                std::cerr << "No se pudo abrir " << argv[i] << "\n";
+                exit(1);
+            }
+            std::string line;
+            while (std::getline(in, line)) {
+                if (!line.empty()) options.files.push_back(line);
+            }
+        }
+        else options.files.push_back(arg);
+    }
+    if ((options.files.empty() && options.database.empty() && options.socket.empty()) || options.ks.empty() || options.algorithms.empty() || options.m < 2 || !(options.errorRate > 0)
+            || !(options.bits == 64 || BBitSignature::isValidNumBits(options.bits))) {
+        printUsage();
+        exit(1);
+    }
+    return options;
+}
+
+// Agrega el algoritmo con el nombre dado, retorna false si no se conoce. ProbMinHash1/2/4 y SuperMinHash se
+// instancian con m fijo en tiempo de compilación cuando dispatchSize lo permite (por ejemplo m = 1024, el valor
+// por defecto), lo que da las mismas firmas más rápido.
+bool addAlgorithm(MultiAlgorithmSketcher &sketcher, const std::string &name, uint32_t m) {
+    typedef MinHash<uint64_t, ExtractFunction, RngFunction> MH;
+    typedef OnePermutationHashingWithOptimalDensification<uint64_t, ExtractFunction, RngFunction, RngFunctionForSignatureComponents> OPH;
+    if (name == "probminhash1" || name == "probminhash2" || name == "probminhash4" || name == "superminhash") {
+        dispatchSize(m, [&](auto size) {
+            typedef decltype(size) S;
+            typedef ProbMinHash1<uint64_t, ExtractFunction, RngFunction, WeightFunction, S> PMH1;
+            typedef ProbMinHash2<uint64_t, ExtractFunction, RngFunction, WeightFunction, S> PMH2;
+            typedef ProbMinHash4<uint64_t, ExtractFunction, RngFunction, WeightFunction, S> PMH4;
+            typedef SuperMinHash<uint64_t, ExtractFunction, RngFunction, S> SMH;
+            if (name == "probminhash1") sketcher.addAlgorithm<PMH1>(name, [size](uint32_t) {return new PMH1(size, ExtractFunction(), RngFunction(), WeightFunction());});
+            else if (name == "probminhash2") sketcher.addAlgorithm<PMH2>(name, [size](uint32_t) {return new PMH2(size, ExtractFunction(), RngFunction(), WeightFunction());});
+            else if (name == "probminhash4") sketcher.addAlgorithm<PMH4>(name, [size](uint32_t) {return new PMH4(size, ExtractFunction(), RngFunction(), WeightFunction());});
+            else sketcher.addAlgorithm<SMH>(name, [size](uint32_t) {return new SMH(size, ExtractFunction(), RngFunction());});
+        });
+    }
+    else if (name == "minhash") sketcher.addAlgorithm<MH>(name, [m](uint32_t) {return new MH(m, ExtractFunction(), RngFunction());});
+    else if (name == "oph") sketcher.addAlgorithm<OPH>(name, [m](uint32_t) {return new OPH(m, ExtractFunction(), RngFunction(), RngFunctionForSignatureComponents());});
+    else return false;
+    return true;
+}
+
+int runCompare(const Options &options) {
+    MultiAlgorithmSketcher sketcher(options.ks);
+    for (const auto &name : options.algorithms) {
+        if (!addAlgorithm(sketcher, name, options.m)) {
+            std::cerr << "Algoritmo desconocido: " << name << "\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    // signatures[i][a][j] es la firma del archivo i con el algoritmo a y k = ks[j]
+    std::vector<std::vector<std::vector<std::vector<uint64_t>>>> signatures;
+    for (const auto &f : options.files) {
+        auto start = std::chrono::steady_clock::now();
+        std::string genome = readGenome(f);
+        auto read = std::chrono::steady_clock::now();
+        signatures.push_back(sketcher(genome));
+        auto end = std::chrono::steady_clock::now();
+        std::cerr << f << ": lectura " << std::chrono::duration<double>(read - start).count() << " s, ";
+        std::cerr << "firmas " << std::chrono::duration<double>(end - read).count() << " s\n";
+    }
+
+    // similitud entre todos los pares, para cada algoritmo y cada k
+    size_t n = options.files.size();
+    if (options.bits != 64) {
+        for (size_t a = 0; a < options.algorithms.size(); a++) {
+            for (size_t j = 0; j < options.ks.size(); j++) {
+                std::vector<BBitSignature> packed;
+                for (size_t x = 0; x < n; x++) packed.emplace_back(signatures[x][a][j], options.bits);
+                for (size_t x = 0; x < n; x++) {
+                    for (size_t y = x + 1; y < n; y++) {
+                        double sim = estimateJaccardBBit(packed[x], packed[y]);
+                        if (options.hasThreshold && sim < options.threshold) continue;
+                        std::cout << "k=" << options.ks[j] << "\t" << options.algorithms[a] << "\t" << options.files[x] << "\t" << options.files[y] << "\t" << sim << "\n";
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+    ThresholdComparator comparator(options.m, options.threshold, options.errorRate);
+    for (size_t a = 0; a < options.algorithms.size(); a++) {
+        for (size_t j = 0; j < options.ks.size(); j++) {
+            for (size_t x = 0; x < n; x++) {
+                for (size_t y = x + 1; y < n; y++) {
+                    // los pares bajo el umbral se descartan con pocos componentes, los demás se muestran con la firma completa
+                    if (options.hasThreshold && !comparator(signatures[x][a][j], signatures[y][a][j]).similar) continue;
+                    double sim = estimateJaccard(signatures[x][a][j], signatures[y][a][j]);
+                    std::cout << "k=" << options.ks[j] << "\t" << options.algorithms[a] << "\t" << options.files[x] << "\t" << options.files[y] << "\t" << sim << "\n";
+                }
+            }
+        }
+    }
+    if (options.hasThreshold) {
+        std::cerr << "componentes comparados " << comparator.getNumComparedComponents() << ", ahorrados " << comparator.getNumSavedComponents() << "\n";
+    }
+    return 0;
+}
+
+// Parámetros de las firmas que se guardan en el archivo de firmas. Los k-mers se codifican con 2 bits por base, solo
+// en la hebra directa, y se hashean con wyhash64(kmer, k); los algoritmos usan RngFunction con semilla 123456789.
+SketchFileInfo getSketchFileInfo(const Options &options) {
+    SketchFileInfo info;
+    info.k = options.ks[0];
+    info.m = options.m;
+    info.algorithm = options.algorithms[0];
+    info.seed = UINT64_C(123456789);
+    info.weighted = options.algorithms[0].compare(0, 11, "probminhash") == 0;
+    info.canonical = false;
+    info.hashScheme = "2bit-forward-wyhash64";
+    return info;
+}
+
+// Calcula en paralelo las firmas de todos los archivos con el primer algoritmo y el primer k, una tras otra:
+// la firma i empieza en signatures[i * m]. Cada thread usa su propia instancia del algoritmo. Con -c las firmas de
+// los archivos que no cambiaron se toman del caché y solo se calculan las de los archivos nuevos o modificados.
+bool sketchGenomes(const Options &options, std::vector<uint64_t> &signatures) {
+    const size_t n = options.files.size();
+    const uint32_t m = options.m;
+    signatures.assign(n * m, 0);
+    const SketchFileInfo info = getSketchFileInfo(options);
+    std::unique_ptr<SketchCache> cache;
+    if (!options.cacheDirectory.empty()) {
+        cache.reset(new SketchCache(options.cacheDirectory));
+        if (!cache->good()) {
+            std::cerr << "No se pudo usar el caché " << options.cacheDirectory << "\n";
+            return false;
+        }
+    }
+    bool ok = true;
+    OMP_PRAGMA(omp parallel)
+    {
+        MultiAlgorithmSketcher sketcher(std::vector<uint32_t>{options.ks[0]});
+        if (!addAlgorithm(sketcher, options.algorithms[0], m)) {
+            OMP_PRAGMA(omp atomic write)
+            ok = false;
+        }
+        else {
+            OMP_PRAGMA(omp for schedule(dynamic, 1))
+            for (int64_t i = 0; i < (int64_t)n; i++) {
+                std::vector<uint64_t> signature;
+                if (!cache || !cache->lookup(options.files[i], info, signature)) {
+                    signature = sketcher(readGenome(options.files[i]))[0][0];
+                    if (cache && !cache->store(options.files[i], info, signature)) {
+                        OMP_PRAGMA(omp critical)
+                        std::cerr << "No se pudo guardar la firma de " << options.files[i] << " en el caché\n";
+                    }
+                }
+                std::copy(signature.begin(), signature.end(), signatures.begin() + i * m);
+            }
+        }
+    }
+    if (!ok) {
+        std::cerr << "Algoritmo desconocido: " << options.algorithms[0] << "\n";
+        printUsage();
+    }
+    if (ok && cache) {
+        std::cerr << "caché: " << cache->getNumHits() << " firmas encontradas, " << cache->getNumMisses() << " calculadas, ";
+        std::cerr << cache->getNumHashedFiles() << " archivos hasheados\n";
+    }
+    return ok;
+}
+
+int runSketch(const Options &options) {
+    if (options.ks.size() != 1 || options.algorithms.size() != 1 || options.output.empty() || options.files.empty()) {
+        std::cerr << "sketch requiere un solo k, un solo algoritmo y -o\n";
+        printUsage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> signatures;
+    if (!sketchGenomes(options, signatures)) return 1;
+    if (!writeSketchFile(options.output, getSketchFileInfo(options), options.files, signatures.data())) {
+        std::cerr << "No se pudo escribir " << options.output << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << "firmas de " << options.files.size() << " genomas: " << std::chrono::duration<double>(end - start).count() << " s\n";
+    return 0;
+}
+
+// Abre la base de datos indicada con -d, retorna nullptr si no se puede usar
+std::unique_ptr<SketchDatabase> openDatabase(const Options &options) {
+    if (options.database.empty()) {
+        std::cerr << "falta la base de datos (-d)\n";
+        printUsage();
+        return nullptr;
+    }
+    std::unique_ptr<SketchDatabase> database(new SketchDatabase(options.database));
+    if (!database->good()) {
+        std::cerr << "No se pudo abrir la base de datos " << options.database << ": " << database->getError() << "\n";
+        return nullptr;
+    }
+    return database;
+}
+
+int runAdd(const Options &options) {
+    if (options.ks.size() != 1 || options.algorithms.size() != 1 || options.files.empty()) {
+        std::cerr << "add requiere un solo k, un solo algoritmo y al menos un archivo\n";
+        printUsage();
+        return 1;
+    }
+    auto database = openDatabase(options);
+    if (!database) return 1;
+    const SketchFileInfo info = getSketchFileInfo(options);
+    if (database->size() > 0 && !database->getInfo().isCompatible(info)) {
+        const SketchFileInfo &d = database->getInfo();
+        std::cerr << "La base de datos usa k=" << d.k << ", m=" << d.m << " y " << d.algorithm << "\n";
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> signatures;
+    if (!sketchGenomes(options, signatures)) return 1;
+    if (!database->append(info, options.files, signatures.data())) {
+        std::cerr << "No se pudieron agregar las firmas: " << database->getError() << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << "agregados " << options.files.size() << " genomas, total " << database->size() << ": ";
+    std::cerr << std::chrono::duration<double>(end - start).count() << " s\n";
+    return 0;
+}
+
+int runRemove(const Options &options) {
+    auto database = openDatabase(options);
+    if (!database) return 1;
+    std::unordered_map<std::string, uint64_t> ids;
+    for (uint64_t id = 0; id < database->size(); id++) {
+        if (!database->isRemoved(id)) ids[database->getName(id)] = id;
+    }
+    int result = 0;
+    for (const auto &f : options.files) {
+        auto it = ids.find(f);
+        if (it == ids.end()) {
+            std::cerr << f << " no está en la base de datos\n";
+            result = 1;
+        }
+        else if (!database->remove(it->second)) {
+            std::cerr << "No se pudo eliminar " << f << ": " << database->getError() << "\n";
+            return 1;
+        }
+    }
+    return result;
+}
+
+int runUpdate(const Options &options) {
+    auto database = openDatabase(options);
+    if (!database) return 1;
+    auto start = std::chrono::steady_clock::now();
+    const uint64_t first = database->getNumDistanceRows();
+    const uint32_t m = database->getInfo().m;
+    const uint32_t minCount = static_cast<uint32_t>(std::ceil(options.threshold * m - 1e-9));
+    bool ok = database->updateDistances([&](uint64_t i, const uint16_t *counts) {
+        if (!options.hasThreshold || database->isRemoved(i)) return;
+        for (uint64_t j = 0; j < i; j++) {
+            if (counts[j] < minCount || database->isRemoved(j)) continue;
+            std::cout << database->getName(j) << "\t" << database->getName(i) << "\t" << double(counts[j]) / m << "\n";
+        }
+    });
+    if (!ok) {
+        std::cerr << "No se pudieron actualizar las distancias: " << database->getError() << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    const uint64_t n = database->size();
+    const uint64_t numNewPairs = n * (n - std::min<uint64_t>(n, 1)) / 2 - first * (first - std::min<uint64_t>(first, 1)) / 2;
+    std::cerr << "distancias de " << numNewPairs << " pares nuevos, " << n << " genomas: ";
+    std::cerr << std::chrono::duration<double>(end - start).count() << " s\n";
+    return 0;
+}
+
+int runIndex(const Options &options) {
+    if (options.database.empty() || options.output.empty()) {
+        std::cerr << "index requiere -d y -o\n";
+        printUsage();
+        return 1;
+    }
+    MappedSketchFile file(options.database);
+    if (!file.good()) {
+        std::cerr << "No se pudo leer " << options.database << ": " << file.getError() << "\n";
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!writePostingIndex(options.output, file.getRegisters(), file.size(), file.getInfo().m)) {
+        std::cerr << "No se pudo escribir " << options.output << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << "índice de " << file.size() << " genomas: " << std::chrono::duration<double>(end - start).count() << " s\n";
+    return 0;
+}
+
+int runScreen(const Options &options) {
+    if (options.database.empty() || options.files.empty()) {
+        std::cerr << "screen requiere -d y al menos una muestra\n";
+        printUsage();
+        return 1;
+    }
+    MappedSketchFile file(options.database);
+    if (!file.good()) {
+        std::cerr << "No se pudo leer " << options.database << ": " << file.getError() << "\n";
+        return 1;
+    }
+    const SketchFileInfo &info = file.getInfo();
+    std::unique_ptr<PostingIndex> index;
+    if (!options.index.empty()) {
+        index.reset(new PostingIndex(options.index));
+        if (!index->good()) {
+            std::cerr << "No se pudo leer " << options.index << ": " << index->getError() << "\n";
+            return 1;
+        }
+        if (index->size() != file.size() || index->getSignatureSize() != info.m) {
+            std::cerr << options.index << " no corresponde a " << options.database << "\n";
+            return 1;
+        }
+    }
+    // las muestras se procesan con los mismos parámetros que las firmas del archivo
+    Options sampleOptions = options;
+    sampleOptions.ks = {info.k};
+    sampleOptions.m = info.m;
+    sampleOptions.algorithms = {info.algorithm};
+    if (!getSketchFileInfo(sampleOptions).isCompatible(info)) {
+        std::cerr << "Las firmas de " << options.database << " se calcularon con otros parámetros\n";
+        return 1;
+    }
+    std::vector<uint64_t> signatures;
+    if (!sketchGenomes(sampleOptions, signatures)) return 1;
+    const uint32_t minCount = options.hasThreshold ? static_cast<uint32_t>(std::ceil(options.threshold * info.m - 1e-9)) : 1;
+    auto start = std::chrono::steady_clock::now();
+    // sin índice, todas las muestras se comparan juntas con cada bloque de firmas, leyendo el archivo una sola vez
+    std::vector<std::vector<BatchQueryHit>> hits;
+    if (index) {
+        for (size_t q = 0; q < options.files.size(); q++) {
+            hits.emplace_back();
+            for (const auto &hit : index->query(signatures.data() + q * info.m, options.numResults, minCount)) hits.back().push_back(BatchQueryHit{hit.id, hit.count});
+        }
+    } else {
+        hits = computeBatchTopK(signatures.data(), options.files.size(), file.getRegisters(), file.size(), info.m, options.numResults, minCount);
+    }
+    for (size_t q = 0; q < options.files.size(); q++) {
+        for (const auto &hit : hits[q]) {
+            std::cout << options.files[q] << "\t" << file.getName(hit.id) << "\t" << double(hit.count) / info.m << "\n";
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << "consultas: " << std::chrono::duration<double>(end - start).count() << " s\n";
+    return 0;
+}
+
+std::atomic<bool> stopRequested(false);
+
+void requestStop(int) {
+    stopRequested = true;
+}
+
+int runServe(const Options &options) {
+    if (options.database.empty() || options.socket.empty()) {
+        std::cerr << "serve requiere -d y -s\n";
+        printUsage();
+        return 1;
+    }
+    // las consultas FASTA se procesan con los parámetros del archivo cargado en ese momento
+    auto sketchFunction = [&options](const std::string &fasta, const SketchFileInfo &info, std::vector<uint64_t> &signature) {
+        Options sampleOptions = options;
+        sampleOptions.ks = {info.k};
+        sampleOptions.m = info.m;
+        sampleOptions.algorithms = {info.algorithm};
+        if (!getSketchFileInfo(sampleOptions).isCompatible(info)) return false;
+        MultiAlgorithmSketcher sketcher(sampleOptions.ks);
+        if (!addAlgorithm(sketcher, info.algorithm, info.m)) return false;
+        std::istringstream in(fasta);
+        signature = sketcher(parseGenome(in))[0][0];
+        return true;
+    };
+    QueryServerOptions serverOptions;
+    serverOptions.batchWindow = std::chrono::microseconds(options.batchWindow);
+    QueryServer server(options.socket, options.database, sketchFunction, serverOptions);
+    if (!server.good()) {
+        std::cerr << "No se pudo iniciar el servidor: " << server.getError() << "\n";
+        return 1;
+    }
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::cerr << "escuchando en " << options.socket << "\n";
+    while (!stopRequested) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    server.stop();
+    std::cerr << server.getStats();
+    return 0;
+}
+
+int runQuery(const Options &options) {
+    if (options.socket.empty() || options.files.empty()) {
+        std::cerr << "query requiere -s y al menos una muestra\n";
+        printUsage();
+        return 1;
+    }
+    QueryClient client(options.socket);
+    if (!client.good()) {
+        std::cerr << "No se pudo conectar a " << options.socket << "\n";
+        return 1;
+    }
+    for (const auto &f : options.files) {
+        std::ifstream in(f, std::ios::binary);
+        if (!in) {
+            std::cerr << "No se pudo abrir " << f << "\n";
+            return 1;
+        }
+        std::ostringstream fasta;
+        fasta << in.rdbuf();
+        QueryServerResponse response;
+        if (!client.queryFasta(fasta.str(), options.numResults, 1, response)) {
+            std::cerr << "Error de comunicación con " << options.socket << "\n";
+            return 1;
+        }
+        if (response.status != QueryStatus::OK) {
+            std::cerr << "El servidor no pudo procesar " << f << " (estado " << static_cast<uint32_t>(response.status) << ")\n";
+            return 1;
+        }
+        // los resultados están ordenados, el umbral solo descarta los últimos
+        for (const auto &hit : response.hits) {
+            const double similarity = double(hit.count) / response.m;
+            if (options.hasThreshold && similarity < options.threshold) break;
+            std::cout << f << "\t" << hit.name << "\t" << similarity << "\n";
+        }
+    }
+    return 0;
+}
+
+int runStats(const Options &options) {
+    QueryClient client(options.socket);
+    std::string stats;
+    if (!client.good() || !client.getStats(stats)) {
+        std::cerr << "No se pudo conectar a " << options.socket << "\n";
+        return 1;
+    }
+    std::cout << stats;
+    return 0;
+}
+
+// Agrega a out la línea de un par con su similitud count / m
+void appendPair(std::string &out, const std::string &nameA, const std::string &nameB, uint32_t count, uint32_t m) {
+    char similarity[32];
+    std::snprintf(similarity, sizeof(similarity), "%g", double(count) / m);
+    out += nameA;
+    out += '\t';
+    out += nameB;
+    out += '\t';
+    out += similarity;
+    out += '\n';
+}
+
+// Procesa en paralelo las filas iBegin, ..., iEnd - 1 de un bloque con processRow(i, row), que agrega a row los pares
+// de la fila i que alcanzan el umbral, y si print es true las escribe luego en orden con una sola escritura
+template<typename F>
+void processRowsInParallel(std::vector<std::string> &rows, uint64_t iBegin, uint64_t iEnd, bool print, F &&processRow) {
+    rows.assign(iEnd - iBegin, std::string());
+    OMP_PRAGMA(omp parallel for schedule(dynamic, 1))
+    for (int64_t r = 0; r < (int64_t)rows.size(); r++) processRow(iBegin + r, rows[r]);
+    if (!print) return;
+    std::string pairs;
+    for (const auto &row : rows) pairs += row;
+    std::cout << pairs;
+}
+
+// Compara solo los pares candidatos de LSH. Las bandas y filas se eligen para el umbral dando más peso a los
+// falsos negativos que a los falsos positivos, ya que estos últimos se descartan con la comparación exacta.
+int runAllVsAllLsh(const Options &options, const uint64_t *signatures, const std::vector<std::string> &names, uint32_t m, std::chrono::steady_clock::time_point sketched, ConcurrentUnionFind *clusters) {
+    const size_t n = names.size();
+    const auto parameters = getOptimalLshParameters(m, options.threshold, 0.1, 0.9);
+    LshIndex index(parameters.first, parameters.second);
+    for (size_t i = 0; i < n; i++) index.add(signatures + i * m);
+    index.build();
+    const auto candidates = index.getCandidatePairs();
+    auto indexed = std::chrono::steady_clock::now();
+    std::cerr << "LSH con " << parameters.first << " bandas de " << parameters.second << " filas: " << candidates.size() << " candidatos, ";
+    std::cerr << std::chrono::duration<double>(indexed - sketched).count() << " s\n";
+
+    const uint32_t minCount = static_cast<uint32_t>(std::ceil(options.threshold * m - 1e-9));
+    std::mutex outputMutex;
+    OMP_PRAGMA(omp parallel)
+    {
+        // cada hilo acumula sus pares y los escribe de a 1 MB
+        std::string pairs;
+        OMP_PRAGMA(omp for schedule(dynamic, 1024))
+        for (int64_t c = 0; c < (int64_t)candidates.size(); c++) {
+            const uint32_t i = candidates[c].first;
+            const uint32_t j = candidates[c].second;
+            const uint32_t count = countEqualComponents(signatures + uint64_t(i) * m, signatures + uint64_t(j) * m, m);
+            if (count < minCount) continue;
+            if (clusters) {
+                clusters->unite(i, j);
+                continue;
+            }
+            appendPair(pairs, names[i], names[j], count, m);
+            if (pairs.size() >= (1 << 20)) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << pairs;
+                pairs.clear();
+            }
+        }
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << pairs;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << "comparación de " << candidates.size() << " pares: " << std::chrono::duration<double>(end - indexed).count() << " s\n";
+    return 0;
+}
+
+// Compara todos los pares por bloques de filas del triángulo inferior y los entrega a writer (ver distance_writer.hpp),
+// con -t (salvo en el formato aristas) muestra además los pares que alcanzan el umbral o los agrega a los clusters.
+// Como en runAllVsAllCounts, las filas de cada bloque se procesan en paralelo.
+template<typename W>
+int writeDistances(W &writer, const Options &options, const uint64_t *signatures, const std::vector<std::string> &names, uint32_t m, std::chrono::steady_clock::time_point sketched, ConcurrentUnionFind *clusters) {
+    if (!writer.good()) {
+        std::cerr << "No se pudo escribir " << options.output << "\n";
+        return 1;
+    }
+    const size_t n = names.size();
+    const uint32_t minCount = static_cast<uint32_t>(std::ceil(options.threshold * m - 1e-9));
+    const bool printPairs = options.hasThreshold && options.format != "aristas" && !clusters;
+    auto getRowOffset = [](uint64_t i) {return (i > 0) ? getLowerTriangleIndex(i, 0) : 0;};
+    std::vector<std::string> rows;
+    computeAllVsAllRowBlocks(signatures, n, m, [&](uint64_t iBegin, uint64_t iEnd, const uint32_t *counts) {
+        writer(iBegin, iEnd, counts);
+        if (!printPairs && !clusters) return;
+        const uint64_t offset = getRowOffset(iBegin);
+        processRowsInParallel(rows, iBegin, iEnd, printPairs, [&](uint64_t i, std::string &row) {
+            const uint32_t *rowCounts = counts + (getRowOffset(i) - offset);
+            for (uint64_t j = 0; j < i; j++) {
+                if (rowCounts[j] < minCount) continue;
+                if (clusters) clusters->unite(i, j);
+                else appendPair(row, names[j], names[i], rowCounts[j], m);
+            }
+        });
+    });
+    if (!writer.finish()) {
+        std::cerr << "No se pudo escribir " << options.output << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    const double numPairs = double(n) * (n - 1) / 2;
+    std::cerr << "comparación y escritura de " << numPairs << " pares: " << std::chrono::duration<double>(end - sketched).count() << " s, ";
+    std::cerr << numPairs / std::chrono::duration<double>(end - sketched).count() << " pares/s\n";
+    return 0;
+}
+
+// Compara todos los pares por bloques de filas del triángulo superior, con -o escribe la matriz de conteos (ver
+// CondensedMatrixWriter en distance_writer.hpp) y con -t muestra los pares que alcanzan el umbral o los agrega a los
+// clusters. Las filas de cada bloque se procesan en paralelo y sus pares se escriben en orden con una sola escritura.
+int runAllVsAllCounts(const Options &options, const uint64_t *signatures, const std::vector<std::string> &names, uint32_t m, std::chrono::steady_clock::time_point sketched, ConcurrentUnionFind *clusters) {
+    const size_t n = names.size();
+    std::unique_ptr<CondensedMatrixWriter> writer;
+    if (!options.output.empty()) {
+        writer.reset(new CondensedMatrixWriter(options.output, n, m));
+        if (!writer->good()) {
+            std::cerr << "No se pudo escribir " << options.output << "\n";
+            return 1;
+        }
+    }
+    const uint32_t minCount = static_cast<uint32_t>(std::ceil(options.threshold * m - 1e-9));
+    std::vector<std::string> rows;
+    computeAllVsAllCondensedRowBlocks(signatures, n, m, [&](uint64_t iBegin, uint64_t iEnd, const uint32_t *counts) {
+        if (writer) (*writer)(iBegin, iEnd, counts);
+        if (!options.hasThreshold) return;
+        const uint64_t offset = getCondensedRowOffset(iBegin, n);
+        processRowsInParallel(rows, iBegin, iEnd, !clusters, [&](uint64_t i, std::string &row) {
+            const uint32_t *rowCounts = counts + (getCondensedRowOffset(i, n) - offset);
+            for (uint64_t j = i + 1; j < n; j++) {
+                const uint32_t count = rowCounts[j - i - 1];
+                if (count < minCount) continue;
+                if (clusters) clusters->unite(i, j);
+                else appendPair(row, names[i], names[j], count, m);
+            }
+        });
+    });
+    if (writer && !writer->finish()) {
+        std::cerr << "No se pudo escribir " << options.output << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    const double numPairs = double(n) * (n - 1) / 2;
+    std::cerr << "comparación de " << numPairs << " pares: " << std::chrono::duration<double>(end - sketched).count() << " s, ";
+    std::cerr << numPairs / std::chrono::duration<double>(end - sketched).count() << " pares/s\n";
+    return 0;
+}
+
+// Escribe el cluster de cada genoma en el archivo de -C, con -medoides también el medoide de su cluster
+int writeClusters(const Options &options, ConcurrentUnionFind &clusters, const uint64_t *signatures, const std::vector<std::string> &names, uint32_t m) {
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<uint64_t> clusterIds = clusters.getClusterIds();
+    const uint64_t numClusters = clusterIds.empty() ? 0 : *std::max_element(clusterIds.begin(), clusterIds.end()) + 1;
+    std::vector<uint64_t> medoids;
+    if (options.medoids) medoids = computeMedoids(signatures, m, clusterIds);
+    std::vector<uint64_t> sizes(numClusters);
+    std::ofstream out(options.clusters);
+    for (size_t i = 0; i < names.size(); i++) {
+        sizes[clusterIds[i]]++;
+        out << names[i] << "\t" << clusterIds[i];
+        if (options.medoids) out << "\t" << names[medoids[clusterIds[i]]];
+        out << "\n";
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "No se pudo escribir " << options.clusters << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << numClusters << " clusters, el mayor con " << (sizes.empty() ? 0 : *std::max_element(sizes.begin(), sizes.end())) << " genomas: ";
+    std::cerr << std::chrono::duration<double>(end - start).count() << " s\n";
+    return 0;
+}
+
+// Construye el árbol de neighbor joining de las distancias de Mash entre las firmas y lo escribe en formato Newick
+int runAllVsAllTree(const Options &options, const uint64_t *signatures, const std::vector<std::string> &names, uint32_t m, uint32_t k, std::chrono::steady_clock::time_point sketched) {
+    const size_t n = names.size();
+    std::vector<float> distances = computeMashDistanceMatrix(signatures, n, m, k);
+    auto compared = std::chrono::steady_clock::now();
+    std::cerr << "distancias de Mash de " << double(n) * (n - 1) / 2 << " pares: " << std::chrono::duration<double>(compared - sketched).count() << " s\n";
+    const NeighborJoiningTree tree = computeNeighborJoining(distances, n);
+    std::ofstream out(options.tree);
+    out << getNewick(tree, names) << "\n";
+    out.close();
+    if (!out) {
+        std::cerr << "No se pudo escribir " << options.tree << "\n";
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << "neighbor joining de " << n << " genomas: " << std::chrono::duration<double>(end - compared).count() << " s\n";
+    return 0;
+}
+
+int runAllVsAll(const Options &options) {
+    if (options.ks.size() != 1 || options.algorithms.size() != 1 || (options.output.empty() && !options.hasThreshold && options.tree.empty())) {
+        std::cerr << "allvsall requiere un solo k, un solo algoritmo y -o, -t o -nj\n";
+        printUsage();
+        return 1;
+    }
+    if (!options.tree.empty() && (!options.output.empty() || options.hasThreshold || options.lsh)) {
+        std::cerr << "-nj no admite -o, -t ni -lsh\n";
+        printUsage();
+        return 1;
+    }
+    if (options.lsh && (!options.hasThreshold || !options.output.empty())) {
+        std::cerr << "-lsh requiere -t y no admite -o\n";
+        printUsage();
+        return 1;
+    }
+    const std::string &format = options.format;
+    if (format != "conteos" && (options.output.empty() || !(format == "f16" || format == "f32" || format == "aristas" || format == "phylip") || (format == "aristas" && !options.hasThreshold))) {
+        std::cerr << "-F requiere -o y uno de los formatos conteos, f16, f32, aristas (con -t) o phylip\n";
+        printUsage();
+        return 1;
+    }
+    if ((!options.clusters.empty() && !options.hasThreshold) || (options.medoids && options.clusters.empty())) {
+        std::cerr << "-C requiere -t y -medoides requiere -C\n";
+        printUsage();
+        return 1;
+    }
+    if (!options.database.empty() && !options.files.empty()) {
+        std::cerr << "-d no admite archivos FASTA adicionales\n";
+        printUsage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    // firmas de todos los genomas una tras otra, la firma i empieza en signatures[i * m]
+    const uint64_t *signatures;
+    std::vector<uint64_t> sketchedSignatures;
+    std::unique_ptr<MappedSketchFile> database;
+    std::vector<std::string> names;
+    uint32_t m;
+    uint32_t k;
+    if (!options.database.empty()) {
+        database.reset(new MappedSketchFile(options.database));
+        if (!database->good()) {
+            std::cerr << "No se pudo leer " << options.database << ": " << database->getError() << "\n";
+            return 1;
+        }
+        signatures = database->getRegisters();
+        names = database->getNames();
+        m = database->getInfo().m;
+        k = database->getInfo().k;
+    }
+    else {
+        if (!sketchGenomes(options, sketchedSignatures)) return 1;
+        signatures = sketchedSignatures.data();
+        names = options.files;
+        m = options.m;
+        k = options.ks[0];
+    }
+    const size_t n = names.size();
+    auto sketched = std::chrono::steady_clock::now();
+    std::cerr << "firmas de " << n << " genomas: " << std::chrono::duration<double>(sketched - start).count() << " s\n";
+
+    if (!options.tree.empty()) return runAllVsAllTree(options, signatures, names, m, k, sketched);
+
+    // con -C los pares que alcanzan el umbral se agregan a los clusters a medida que se comparan
+    std::unique_ptr<ConcurrentUnionFind> clusters;
+    if (!options.clusters.empty()) clusters.reset(new ConcurrentUnionFind(n));
+    int status;
+    if (options.lsh) status = runAllVsAllLsh(options, signatures, names, m, sketched, clusters.get());
+    else if (format == "f16" || format == "f32") {
+        DenseDistanceWriter writer(options.output, n, m, (format == "f16") ? 2 : 4);
+        status = writeDistances(writer, options, signatures, names, m, sketched, clusters.get());
+    }
+    else if (format == "aristas") {
+        EdgeListWriter writer(options.output, n, m, static_cast<uint32_t>(std::ceil(options.threshold * m - 1e-9)));
+        status = writeDistances(writer, options, signatures, names, m, sketched, clusters.get());
+    }
+    else if (format == "phylip") {
+        PhylipWriter writer(options.output, names, m);
+        status = writeDistances(writer, options, signatures, names, m, sketched, clusters.get());
+    }
+    else status = runAllVsAllCounts(options, signatures, names, m, sketched, clusters.get());
+    if (status == 0 && clusters) status = writeClusters(options, *clusters, signatures, names, m);
+    return status;
+}
+
+int runSearch(const Options &options) {
+    if (options.files.size() < 2 || options.levels.empty() || !(options.threshold >= 0 && options.threshold <= 1)) {
+        printUsage();
+        return 1;
+    }
+    typedef NestedProbMinHash<ProbMinHash4, uint64_t, ExtractFunction, RngFunction, WeightFunction> H;
+    MultiAlgorithmSketcher sketcher(options.ks);
+    const std::vector<uint32_t> levels = options.levels;
+    sketcher.addAlgorithm<H>("probminhash4", [levels](uint32_t) {return new H(levels, ExtractFunction(), RngFunction(), WeightFunction());});
+
+    // database[j][i] es la firma del archivo i + 1 para k = ks[j], query[j] la de la consulta
+    std::vector<std::vector<uint64_t>> query;
+    std::vector<std::vector<std::vector<uint64_t>>> database(options.ks.size());
+    for (size_t i = 0; i < options.files.size(); i++) {
+        auto signatures = sketcher(readGenome(options.files[i]));
+        if (i == 0) query = signatures[0];
+        else for (size_t j = 0; j < options.ks.size(); j++) database[j].push_back(signatures[0][j]);
+    }
+
+    for (size_t j = 0; j < options.ks.size(); j++) {
+        uint64_t numComparedComponents = 0;
+        for (const auto &r : searchNested(query[j], database[j], levels, options.threshold, 3., &numComparedComponents)) {
+            std::cout << "k=" << options.ks[j] << "\t" << options.files[0] << "\t" << options.files[r.index + 1] << "\t" << r.similarity << "\n";
+        }
+        std::cerr << "k=" << options.ks[j] << ": componentes comparados " << numComparedComponents << " de " << uint64_t(levels.back()) * database[j].size() << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    std::string command = argv[1];
+    if (command == "sketch") return runSketch(parseOptions(argc, argv, 2));
+    if (command == "index") return runIndex(parseOptions(argc, argv, 2));
+    if (command == "screen") return runScreen(parseOptions(argc, argv, 2));
+    if (command == "serve") return runServe(parseOptions(argc, argv, 2));
+    if (command == "query") return runQuery(parseOptions(argc, argv, 2));
+    if (command == "stats") return runStats(parseOptions(argc, argv, 2));
+    if (command == "add") return runAdd(parseOptions(argc, argv, 2));
+    if (command == "remove") return runRemove(parseOptions(argc, argv, 2));
+    if (command == "update") return runUpdate(parseOptions(argc, argv, 2));
+    if (command == "compare") return runCompare(parseOptions(argc, argv, 2));
+    if (command == "search") return runSearch(parseOptions(argc, argv, 2));
+    if (command == "allvsall") return runAllVsAll(parseOptions(argc, argv, 2));
+
+    std::cerr << "Comando desconocido: " << command << "\n";
+    printUsage();
+    return 1;
+}
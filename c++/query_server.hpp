@@ -0,0 +1,623 @@
+#ifndef _QUERY_SERVER_HPP_
+#define _QUERY_SERVER_HPP_
+
+#include "sketch_file.hpp"
+#include "batch_query.hpp"
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+// Long-lived server answering top-k queries against a memory-mapped sketch file over a Unix domain socket.
+//
+// Protocol (all integers in native byte order, client and server share the machine through the Unix domain socket), a
+// connection may send any number of requests one after the other:
+//     request:   QueryRequestHeader (24 bytes) followed by payloadSize bytes
+//                    QUERY_SKETCH: the m registers of the query (uint64), computed with the parameters of the
+//                                  sketch file, which are reported by STATS
+//                    QUERY_FASTA:  the content of a FASTA file, which is sketched by the server with the parameters
+//                                  of the sketch file
+//                    STATS:        empty
+//     response:  QueryResponseHeader (24 bytes) followed by payloadSize bytes
+//                    queries: numHits records of id (uint64), count (uint32), length of the name (uint32) and the name,
+//                             ordered by decreasing count and increasing id
+//                    STATS:   lines "key<TAB>value", with the generation and the parameters of the sketch file, the
+//                             numbers of signatures, requests and batches, and percentiles of the latency of queries
+//                             in microseconds
+//
+// Every connection is served by its own thread, which reads the request, sketches FASTA queries, and appends the query
+// to a queue. A single batch thread takes all queued queries, at most maxBatchSize, and answers them with one
+// cache-blocked scan (see batch_query.hpp), such that concurrent requests share the memory traffic of the scan.
+// Queries arriving during a scan form the next batch, hence batching adds no latency under low load. Optionally,
+// the batch thread waits up to batchWindow after the first query of a batch for more queries.
+//
+// The sketch file is checked for changes every reloadInterval (modification time, size, inode). A changed file is
+// mapped and replaces the current one if it is valid, running queries keep the old mapping until they complete. New
+// versions should be written to a temporary file and renamed, such that the server never sees a partial file. A query
+// is bound to the parameters of the sketch file at its arrival, if a new version with other parameters is loaded before
+// its batch is scanned, it is answered with INCOMPATIBLE.
+
+static const char QUERY_REQUEST_MAGIC[4] = {'P', 'M', 'Q', '1'};
+static const char QUERY_RESPONSE_MAGIC[4] = {'P', 'M', 'R', '1'};
+
+enum class QueryRequestType : uint32_t {QUERY_SKETCH = 1, QUERY_FASTA = 2, STATS = 3};
+
+enum class QueryStatus : uint32_t {
+    OK = 0,
+    BAD_REQUEST = 1,    // unknown type or invalid payload size
+    SKETCH_FAILED = 2,  // the FASTA query could not be sketched
+    INCOMPATIBLE = 3    // the query size or the parameters it was computed with do not match the current sketch file
+};
+
+struct QueryRequestHeader {
+    char magic[4];
+    uint32_t type;
+    uint32_t numResults;
+    uint32_t minCount;
+    uint64_t payloadSize;
+};
+
+struct QueryResponseHeader {
+    char magic[4];
+    uint32_t status;
+    uint32_t numHits;
+    uint32_t m;          // signature size of the sketch file that answered the query
+    uint64_t payloadSize;
+};
+
+static_assert(sizeof(QueryRequestHeader) == 24, "Unexpected size of QueryRequestHeader!");
+static_assert(sizeof(QueryResponseHeader) == 24, "Unexpected size of QueryResponseHeader!");
+
+struct QueryServerHit {
+    uint64_t id;
+    uint32_t count; // number of equal components
+    std::string name;
+};
+
+struct QueryServerResponse {
+    QueryStatus status;
+    uint32_t m;     // signature size of the sketch file that answered the query
+    std::vector<QueryServerHit> hits;
+};
+
+struct QueryServerOptions {
+    uint32_t maxBatchSize = 256;
+    std::chrono::microseconds batchWindow{0};
+    std::chrono::milliseconds reloadInterval{1000};
+    uint64_t maxPayloadSize = UINT64_C(1) << 28;  // larger requests, e.g. FASTA queries, are rejected
+    uint64_t numLatencySamples = UINT64_C(1) << 16; // percentiles are computed over the most recent queries
+};
+
+namespace query_server {
+
+// reads exactly size bytes, returns false on end of file, error, or if stopping is set while waiting
+inline bool readFully(int fd, void* data, uint64_t size, const std::atomic<bool>* stopping = nullptr) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        if (stopping != nullptr) {
+            pollfd pfd{fd, POLLIN, 0};
+            const int ready = poll(&pfd, 1, 100);
+            if (stopping->load()) return false;
+            if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+            if (ready < 0) return false;
+        }
+        const ssize_t numRead = ::read(fd, p, size);
+        if (numRead < 0 && errno == EINTR) continue;
+        if (numRead <= 0) return false;
+        p += numRead;
+        size -= numRead;
+    }
+    return true;
+}
+
+// Reads size bytes in chunks of 1 MiB and appends them to data, or discards them if data is null. Memory is only
+// allocated for bytes actually received, not for the size announced by the client.
+inline bool readChunks(int fd, uint64_t size, std::string* data, const std::atomic<bool>* stopping = nullptr) {
+    const uint64_t chunkSize = UINT64_C(1) << 20;
+    std::string discarded;
+    while (size > 0) {
+        const uint64_t numBytes = std::min(chunkSize, size);
+        std::string& target = (data != nullptr) ? *data : discarded;
+        const uint64_t offset = (data != nullptr) ? target.size() : 0;
+        if (target.capacity() < offset + numBytes) target.reserve(std::max(2 * target.capacity(), offset + numBytes));
+        target.resize(offset + numBytes);
+        if (!readFully(fd, &target[offset], numBytes, stopping)) return false;
+        size -= numBytes;
+    }
+    return true;
+}
+
+inline bool writeFully(int fd, const void* data, uint64_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t numWritten = ::send(fd, p, size, MSG_NOSIGNAL);
+        if (numWritten < 0 && errno == EINTR) continue;
+        if (numWritten <= 0) return false;
+        p += numWritten;
+        size -= numWritten;
+    }
+    return true;
+}
+
+inline bool makeAddress(const std::string& socketPath, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, socketPath.data(), socketPath.size());
+    return true;
+}
+
+template<typename T>
+void append(std::string& bytes, const T& value) {
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Latencies of the most recent queries in a ring buffer.
+class LatencyRecorder {
+    std::mutex mutex;
+    std::vector<uint64_t> samples;
+    uint64_t numRecorded = 0;
+
+public:
+    explicit LatencyRecorder(uint64_t capacity) : samples(std::max(capacity, UINT64_C(1))) {}
+
+    void record(uint64_t microseconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        samples[numRecorded++ % samples.size()] = microseconds;
+    }
+
+    // returns the given quantiles (between 0 and 1) of the recorded latencies, 0 if nothing was recorded
+    std::vector<uint64_t> getQuantiles(const std::vector<double>& quantiles) {
+        std::vector<uint64_t> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sorted.assign(samples.begin(), samples.begin() + std::min(numRecorded, static_cast<uint64_t>(samples.size())));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<uint64_t> result;
+        for (double q : quantiles) {
+            result.push_back(sorted.empty() ? 0 : sorted[std::min(static_cast<uint64_t>(q * sorted.size()), static_cast<uint64_t>(sorted.size() - 1))]);
+        }
+        return result;
+    }
+};
+
+} // namespace query_server
+
+class QueryServer {
+public:
+    // computes the signature of the FASTA content with the parameters of the sketch file, returns false on failure,
+    // called concurrently from the connection threads
+    typedef std::function<bool(const std::string& fasta, const SketchFileInfo& info, std::vector<uint64_t>& signature)> SketchFunction;
+
+private:
+    struct Database {
+        std::unique_ptr<MappedSketchFile> file;
+        uint64_t generation;
+    };
+
+    struct Result {
+        QueryStatus status;
+        std::vector<BatchQueryHit> hits;
+        std::shared_ptr<const Database> database;
+    };
+
+    struct PendingQuery {
+        std::vector<uint64_t> query;
+        SketchFileInfo info; // parameters of the sketch file at the arrival of the query
+        uint32_t numResults;
+        uint32_t minCount;
+        std::chrono::steady_clock::time_point arrival;
+        std::promise<Result> result;
+    };
+
+    const std::string socketPath;
+    const std::string fileName;
+    const SketchFunction sketchFunction;
+    const QueryServerOptions options;
+
+    std::string error;
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> stoppingBatches{false};
+
+    std::mutex databaseMutex;
+    std::shared_ptr<const Database> database;
+    struct stat databaseStatus;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<PendingQuery> queue;
+
+    std::thread acceptThread;
+    std::thread batchThread;
+    // connection threads, finished threads are joined by the accept thread
+    struct Connection {
+        std::thread thread;
+        std::atomic<bool> isFinished{false};
+    };
+    std::list<std::unique_ptr<Connection>> connections;
+
+    std::atomic<uint64_t> numRequests{0};
+    std::atomic<uint64_t> numBatches{0};
+    query_server::LatencyRecorder latencies;
+
+    std::shared_ptr<const Database> getDatabase() {
+        std::lock_guard<std::mutex> lock(databaseMutex);
+        return database;
+    }
+
+    static bool isSameFile(const struct stat& a, const struct stat& b) {
+        return a.st_ino == b.st_ino && a.st_dev == b.st_dev && a.st_size == b.st_size
+            && a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+    }
+
+    // maps the sketch file if it changed, returns false and sets message if the current file could not be mapped
+    bool reload(std::string& message) {
+        struct stat status;
+        if (stat(fileName.c_str(), &status) != 0) {
+            message = "cannot access " + fileName;
+            return false;
+        }
+        const uint64_t generation = database ? database->generation : 0;
+        if (database && isSameFile(status, databaseStatus)) return true;
+        std::unique_ptr<MappedSketchFile> file(new MappedSketchFile(fileName));
+        if (!file->good()) {
+            message = file->getError();
+            return false;
+        }
+        std::shared_ptr<const Database> newDatabase(new Database{std::move(file), generation + 1});
+        std::lock_guard<std::mutex> lock(databaseMutex);
+        database = newDatabase;
+        databaseStatus = status;
+        return true;
+    }
+
+    void runAccept() {
+        while (!stopping) {
+            for (auto it = connections.begin(); it != connections.end(); ) {
+                if (!(*it)->isFinished) {
+                    ++it;
+                    continue;
+                }
+                (*it)->thread.join();
+                it = connections.erase(it);
+            }
+            pollfd pfd{listenFd, POLLIN, 0};
+            if (poll(&pfd, 1, 100) <= 0) continue;
+            const int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) continue;
+            connections.emplace_back(new Connection());
+            Connection* connection = connections.back().get();
+            connection->thread = std::thread(&QueryServer::runConnection, this, fd, connection);
+        }
+    }
+
+    void runBatches() {
+        auto lastReload = std::chrono::steady_clock::now();
+        while (true) {
+            std::vector<PendingQuery> batch;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait_for(lock, std::chrono::milliseconds(100), [this] {return stoppingBatches || !queue.empty();});
+                if (stoppingBatches && queue.empty()) return;
+                if (!queue.empty() && options.batchWindow.count() > 0) {
+                    queueCondition.wait_until(lock, queue.front().arrival + options.batchWindow, [this] {return stoppingBatches || queue.size() >= options.maxBatchSize;});
+                }
+                while (!queue.empty() && batch.size() < options.maxBatchSize) {
+                    batch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+            if (!batch.empty()) process(batch);
+            const auto now = std::chrono::steady_clock::now();
+            if (now - lastReload >= options.reloadInterval) {
+                // an invalid new version is ignored, the previous one remains in use
+                std::string message;
+                reload(message);
+                lastReload = now;
+            }
+        }
+    }
+
+    // answers all queries of the batch with a single scan with the largest k, at most the number of signatures, and
+    // the smallest minimum count
+    void process(std::vector<PendingQuery>& batch) {
+        const std::shared_ptr<const Database> current = getDatabase();
+        const MappedSketchFile& file = *current->file;
+        const uint32_t m = file.getInfo().m;
+        std::vector<uint64_t> queries;
+        std::vector<uint64_t> indices;
+        uint64_t numResults = 0;
+        uint32_t minCount = UINT32_MAX;
+        for (uint64_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].query.size() != m || !batch[i].info.isCompatible(file.getInfo())) {
+                batch[i].result.set_value(Result{QueryStatus::INCOMPATIBLE, {}, current});
+                continue;
+            }
+            queries.insert(queries.end(), batch[i].query.begin(), batch[i].query.end());
+            indices.push_back(i);
+            numResults = std::max(numResults, static_cast<uint64_t>(batch[i].numResults));
+            minCount = std::min(minCount, batch[i].minCount);
+        }
+        if (indices.empty()) return;
+        numResults = std::min(numResults, file.size());
+        numBatches += 1;
+        const auto hits = computeBatchTopK(queries.data(), indices.size(), file.getRegisters(), file.size(), m, numResults, minCount);
+        for (uint64_t q = 0; q < indices.size(); ++q) {
+            PendingQuery& pending = batch[indices[q]];
+            Result result{QueryStatus::OK, {}, current};
+            for (const auto& hit : hits[q]) {
+                if (result.hits.size() >= pending.numResults) break;
+                if (hit.count >= pending.minCount) result.hits.push_back(hit);
+            }
+            pending.result.set_value(std::move(result));
+        }
+    }
+
+    static bool sendResponse(int fd, QueryStatus status, uint32_t m, uint32_t numHits, const std::string& payload) {
+        QueryResponseHeader header;
+        std::memcpy(header.magic, QUERY_RESPONSE_MAGIC, 4);
+        header.status = static_cast<uint32_t>(status);
+        header.numHits = numHits;
+        header.m = m;
+        header.payloadSize = payload.size();
+        return query_server::writeFully(fd, &header, sizeof(header)) && query_server::writeFully(fd, payload.data(), payload.size());
+    }
+
+    // answers a single request, returns false if the connection should be closed
+    bool handleRequest(int fd) {
+        QueryRequestHeader request;
+        if (!query_server::readFully(fd, &request, sizeof(request), &stopping)) return false;
+        const auto start = std::chrono::steady_clock::now();
+        if (std::memcmp(request.magic, QUERY_REQUEST_MAGIC, 4) != 0 || request.payloadSize > options.maxPayloadSize) {
+            sendResponse(fd, QueryStatus::BAD_REQUEST, 0, 0, "");
+            return false;
+        }
+        const auto type = static_cast<QueryRequestType>(request.type);
+        // a sketch query larger than a signature of the current sketch file is incompatible and not kept in memory
+        const bool isTooLarge = type == QueryRequestType::QUERY_SKETCH && request.payloadSize > getDatabase()->file->getInfo().m * sizeof(uint64_t);
+        std::string payload;
+        if (!query_server::readChunks(fd, request.payloadSize, isTooLarge ? nullptr : &payload, &stopping)) return false;
+        numRequests += 1;
+
+        bool ok;
+        if (type == QueryRequestType::STATS) {
+            ok = sendResponse(fd, QueryStatus::OK, getDatabase()->file->getInfo().m, 0, getStats());
+        }
+        else if (type == QueryRequestType::QUERY_SKETCH || type == QueryRequestType::QUERY_FASTA) {
+            PendingQuery pending;
+            pending.info = getDatabase()->file->getInfo();
+            pending.numResults = request.numResults;
+            pending.minCount = request.minCount;
+            std::future<Result> future = pending.result.get_future();
+            QueryStatus status = QueryStatus::OK;
+            if (type == QueryRequestType::QUERY_SKETCH) {
+                if (isTooLarge) status = QueryStatus::INCOMPATIBLE;
+                else if (payload.size() % sizeof(uint64_t) != 0) status = QueryStatus::BAD_REQUEST;
+                pending.query.resize(payload.size() / sizeof(uint64_t));
+                std::memcpy(pending.query.data(), payload.data(), pending.query.size() * sizeof(uint64_t));
+            }
+            else if (!sketchFunction || !sketchFunction(payload, pending.info, pending.query)) {
+                status = QueryStatus::SKETCH_FAILED;
+            }
+            if (status != QueryStatus::OK) {
+                ok = sendResponse(fd, status, (status == QueryStatus::INCOMPATIBLE) ? pending.info.m : 0, 0, "");
+            }
+            else {
+                pending.arrival = std::chrono::steady_clock::now();
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    queue.push_back(std::move(pending));
+                }
+                queueCondition.notify_one();
+                const Result result = future.get();
+                std::string hits;
+                for (const auto& hit : result.hits) {
+                    const std::string name = result.database->file->getName(hit.id);
+                    query_server::append(hits, hit.id);
+                    query_server::append(hits, hit.count);
+                    query_server::append(hits, static_cast<uint32_t>(name.size()));
+                    hits += name;
+                }
+                ok = sendResponse(fd, result.status, result.database->file->getInfo().m, result.hits.size(), hits);
+            }
+            latencies.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+        else {
+            ok = sendResponse(fd, QueryStatus::BAD_REQUEST, 0, 0, "");
+        }
+        return ok;
+    }
+
+    void runConnection(int fd, Connection* connection) {
+        while (!stopping && handleRequest(fd)) {}
+        ::close(fd);
+        connection->isFinished = true;
+    }
+
+public:
+
+    // maps the sketch file and listens on the socket, good() returns false and getError() describes the problem on failure
+    QueryServer(const std::string& socketPath, const std::string& fileName, SketchFunction sketchFunction, QueryServerOptions options = QueryServerOptions()) :
+            socketPath(socketPath), fileName(fileName), sketchFunction(sketchFunction), options(options), latencies(options.numLatencySamples) {
+        if (!reload(error)) return;
+        sockaddr_un address;
+        if (!query_server::makeAddress(socketPath, address)) {
+            error = "socket path too long: " + socketPath;
+            return;
+        }
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        // a socket file left behind by a previous server is replaced
+        ::unlink(socketPath.c_str());
+        if (listenFd < 0 || bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 128) != 0) {
+            error = "cannot listen on " + socketPath;
+            if (listenFd >= 0) ::close(listenFd);
+            listenFd = -1;
+            return;
+        }
+        acceptThread = std::thread(&QueryServer::runAccept, this);
+        batchThread = std::thread(&QueryServer::runBatches, this);
+    }
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    ~QueryServer() {
+        stop();
+    }
+
+    bool good() const {
+        return listenFd >= 0;
+    }
+
+    const std::string& getError() const {
+        return error;
+    }
+
+    // stops accepting connections, waits for running requests and removes the socket file
+    void stop() {
+        if (listenFd < 0) return;
+        stopping = true;
+        acceptThread.join();
+        for (auto& connection : connections) connection->thread.join();
+        connections.clear();
+        stoppingBatches = true;
+        queueCondition.notify_all();
+        batchThread.join();
+        ::close(listenFd);
+        listenFd = -1;
+        ::unlink(socketPath.c_str());
+    }
+
+    // statistics in the format of the STATS response
+    std::string getStats() {
+        const auto current = getDatabase();
+        const std::vector<double> quantiles = {0.5, 0.9, 0.99, 0.999, 1.};
+        const auto values = latencies.getQuantiles(quantiles);
+        std::ostringstream out;
+        const SketchFileInfo& info = current->file->getInfo();
+        out << "generation\t" << current->generation << '\n';
+        out << "k\t" << info.k << '\n';
+        out << "m\t" << info.m << '\n';
+        out << "algorithm\t" << info.algorithm << '\n';
+        out << "seed\t" << info.seed << '\n';
+        out << "weighted\t" << info.weighted << '\n';
+        out << "canonical\t" << info.canonical << '\n';
+        out << "hash_scheme\t" << info.hashScheme << '\n';
+        out << "signatures\t" << current->file->size() << '\n';
+        out << "requests\t" << numRequests << '\n';
+        out << "batches\t" << numBatches << '\n';
+        out << "latency_p50_us\t" << values[0] << '\n';
+        out << "latency_p90_us\t" << values[1] << '\n';
+        out << "latency_p99_us\t" << values[2] << '\n';
+        out << "latency_p999_us\t" << values[3] << '\n';
+        out << "latency_max_us\t" << values[4] << '\n';
+        return out.str();
+    }
+};
+
+// Client of a QueryServer, a connection can be used for any number of requests, but not concurrently.
+class QueryClient {
+    int fd = -1;
+
+    bool request(QueryRequestType type, uint32_t numResults, uint32_t minCount, const void* payload, uint64_t payloadSize, QueryResponseHeader& header, std::string& response) {
+        if (fd < 0) return false;
+        QueryRequestHeader request;
+        std::memcpy(request.magic, QUERY_REQUEST_MAGIC, 4);
+        request.type = static_cast<uint32_t>(type);
+        request.numResults = numResults;
+        request.minCount = minCount;
+        request.payloadSize = payloadSize;
+        if (!query_server::writeFully(fd, &request, sizeof(request)) || !query_server::writeFully(fd, payload, payloadSize)
+                || !query_server::readFully(fd, &header, sizeof(header)) || std::memcmp(header.magic, QUERY_RESPONSE_MAGIC, 4) != 0) {
+            return false;
+        }
+        response.resize(header.payloadSize);
+        return query_server::readFully(fd, &response[0], response.size());
+    }
+
+    bool query(QueryRequestType type, const void* payload, uint64_t payloadSize, uint32_t numResults, uint32_t minCount, QueryServerResponse& result) {
+        QueryResponseHeader header;
+        std::string response;
+        if (!request(type, numResults, minCount, payload, payloadSize, header, response)) return false;
+        result.status = static_cast<QueryStatus>(header.status);
+        result.m = header.m;
+        result.hits.clear();
+        uint64_t offset = 0;
+        for (uint32_t h = 0; h < header.numHits; ++h) {
+            QueryServerHit hit;
+            uint32_t nameLength;
+            if (offset + 16 > response.size()) return false;
+            std::memcpy(&hit.id, &response[offset], 8);
+            std::memcpy(&hit.count, &response[offset + 8], 4);
+            std::memcpy(&nameLength, &response[offset + 12], 4);
+            offset += 16;
+            if (offset + nameLength > response.size()) return false;
+            hit.name = response.substr(offset, nameLength);
+            offset += nameLength;
+            result.hits.push_back(std::move(hit));
+        }
+        return true;
+    }
+
+public:
+
+    explicit QueryClient(const std::string& socketPath) {
+        sockaddr_un address;
+        if (!query_server::makeAddress(socketPath, address)) return;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    ~QueryClient() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool good() const {
+        return fd >= 0;
+    }
+
+    // Top numResults signatures with at least minCount equal components. Returns false if the communication failed,
+    // otherwise response.status tells whether the query was answered.
+    bool querySketch(const std::vector<uint64_t>& signature, uint32_t numResults, uint32_t minCount, QueryServerResponse& response) {
+        return query(QueryRequestType::QUERY_SKETCH, signature.data(), signature.size() * sizeof(uint64_t), numResults, minCount, response);
+    }
+
+    // as querySketch, the FASTA content is sketched by the server
+    bool queryFasta(const std::string& fasta, uint32_t numResults, uint32_t minCount, QueryServerResponse& response) {
+        return query(QueryRequestType::QUERY_FASTA, fasta.data(), fasta.size(), numResults, minCount, response);
+    }
+
+    bool getStats(std::string& stats) {
+        QueryResponseHeader header;
+        return request(QueryRequestType::STATS, 0, 0, nullptr, 0, header, stats);
+    }
+};
+
+#endif // _QUERY_SERVER_HPP_
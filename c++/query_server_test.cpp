@@ -0,0 +1,231 @@
+#include "query_server.hpp"
+#include "batch_query.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+using namespace std;
+
+// Starts a server on a sketch file, and checks sketch, FASTA, and statistics requests, concurrent clients, and the
+// reloading of a new version of the sketch file, also while a query is sketched. The FASTA queries of this test
+// contain the id of a signature instead of a sequence, the server returns this signature as its sketch.
+
+vector<uint64_t> generateSignatures(mt19937_64& rng, uint64_t n, uint32_t m) {
+    vector<uint64_t> signatures(n * m);
+    for(auto& x : signatures) x = rng() % 8;
+    return signatures;
+}
+
+bool writeDatabase(const string& fileName, const vector<uint64_t>& signatures, uint64_t n, uint32_t m, uint32_t k = 21) {
+    SketchFileInfo info;
+    info.k = k;
+    info.m = m;
+    info.algorithm = "probminhash1";
+    vector<string> names;
+    for(uint64_t j = 0; j < n; ++j) names.push_back("genome" + to_string(j));
+    // a new version is renamed over the old one, such that the server never maps a partial file
+    const string temporaryFileName = fileName + ".tmp";
+    return writeSketchFile(temporaryFileName, info, names, signatures.data()) && rename(temporaryFileName.c_str(), fileName.c_str()) == 0;
+}
+
+void checkHits(const vector<QueryServerHit>& hits, const vector<BatchQueryHit>& expected) {
+    assert(hits.size() == expected.size());
+    for(uint64_t h = 0; h < hits.size(); ++h) {
+        assert(hits[h].id == expected[h].id && hits[h].count == expected[h].count);
+        assert(hits[h].name == "genome" + to_string(expected[h].id));
+    }
+}
+
+uint64_t getStat(const string& stats, const string& key) {
+    const string line = "\n" + stats;
+    const size_t position = line.find("\n" + key + "\t");
+    assert(position != string::npos);
+    return stoull(line.substr(position + key.size() + 2));
+}
+
+// sends only the header of a request announcing payloadSize bytes, returns the status of the response
+QueryStatus sendHeader(const string& socketPath, QueryRequestType type, uint64_t payloadSize) {
+    sockaddr_un address;
+    assert(query_server::makeAddress(socketPath, address));
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    QueryRequestHeader request;
+    memcpy(request.magic, QUERY_REQUEST_MAGIC, 4);
+    request.type = static_cast<uint32_t>(type);
+    request.numResults = 10;
+    request.minCount = 0;
+    request.payloadSize = payloadSize;
+    QueryResponseHeader response;
+    assert(query_server::writeFully(fd, &request, sizeof(request)) && query_server::readFully(fd, &response, sizeof(response)));
+    close(fd);
+    return static_cast<QueryStatus>(response.status);
+}
+
+int main(int argc, char* argv[]) {
+
+    const string directory = (argc > 1) ? string(argv[1]) : string(".");
+    const string fileName = directory + "/query_server_test.pmh";
+    const string socketPath = directory + "/query_server_test.sock";
+    mt19937_64 rng(UINT64_C(0x2c6f91b8e05d3a47));
+
+    uint32_t m = 64;
+    uint64_t n = 3000;
+    vector<uint64_t> signatures = generateSignatures(rng, n, m);
+    assert(writeDatabase(fileName, signatures, n, m));
+
+    // the sketching of a query with header ">wait" is suspended until isReleased is set
+    atomic<bool> isWaiting(false);
+    atomic<bool> isReleased(false);
+    QueryServer::SketchFunction sketchFunction = [&](const string& fasta, const SketchFileInfo& info, vector<uint64_t>& signature) {
+        if (fasta.compare(0, 5, ">wait") == 0) {
+            isWaiting = true;
+            while (!isReleased) this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        const uint64_t id = stoull(fasta.substr(fasta.find('\n') + 1));
+        if ((id + 1) * info.m > signatures.size()) return false;
+        signature.assign(signatures.begin() + id * info.m, signatures.begin() + (id + 1) * info.m);
+        return true;
+    };
+    QueryServerOptions options;
+    options.reloadInterval = chrono::milliseconds(10);
+    QueryServer server(socketPath, fileName, sketchFunction, options);
+    assert(server.good());
+    assert(!QueryServer(socketPath + "2", directory + "/missing.pmh", sketchFunction).good());
+
+    // sketch and FASTA queries
+    {
+        QueryClient client(socketPath);
+        assert(client.good());
+        for(uint64_t q = 0; q < 20; ++q) {
+            const uint32_t numResults = q % 7;
+            const uint32_t minCount = (q % 3) * 10;
+            const auto expected = computeBatchTopK(signatures.data() + q * m, 1, signatures.data(), n, m, numResults, minCount)[0];
+            QueryServerResponse response;
+            assert(client.querySketch(vector<uint64_t>(signatures.begin() + q * m, signatures.begin() + (q + 1) * m), numResults, minCount, response));
+            assert(response.status == QueryStatus::OK && response.m == m);
+            checkHits(response.hits, expected);
+            assert(client.queryFasta(">query\n" + to_string(q) + "\n", numResults, minCount, response));
+            assert(response.status == QueryStatus::OK && response.m == m);
+            checkHits(response.hits, expected);
+        }
+        QueryServerResponse response;
+        assert(client.querySketch(vector<uint64_t>(m + 1), 10, 0, response) && response.status == QueryStatus::INCOMPATIBLE);
+        assert(client.queryFasta(">query\n" + to_string(n) + "\n", 10, 0, response) && response.status == QueryStatus::SKETCH_FAILED);
+        string stats;
+        assert(client.getStats(stats));
+        assert(getStat(stats, "generation") == 1 && getStat(stats, "signatures") == n && getStat(stats, "requests") == 43);
+        assert(getStat(stats, "latency_p50_us") <= getStat(stats, "latency_p99_us") && getStat(stats, "latency_p99_us") <= getStat(stats, "latency_max_us"));
+    }
+    assert(!QueryClient(socketPath + "2").good());
+
+    // a huge number of results is limited to the number of signatures, and the server keeps answering
+    {
+        QueryClient client(socketPath);
+        const vector<uint64_t> query(signatures.begin(), signatures.begin() + m);
+        QueryServerResponse response;
+        assert(client.querySketch(query, UINT32_MAX, 1, response) && response.status == QueryStatus::OK);
+        checkHits(response.hits, computeBatchTopK(query.data(), 1, signatures.data(), n, m, UINT64_MAX, 1)[0]);
+        assert(client.querySketch(query, 3, 0, response) && response.status == QueryStatus::OK && response.hits.size() == 3);
+    }
+
+    // a payload larger than the limit is rejected before anything is allocated
+    {
+        assert(sendHeader(socketPath, QueryRequestType::QUERY_FASTA, UINT64_C(1) << 40) == QueryStatus::BAD_REQUEST);
+        assert(sendHeader(socketPath, QueryRequestType::QUERY_SKETCH, UINT64_MAX) == QueryStatus::BAD_REQUEST);
+        QueryClient client(socketPath);
+        QueryServerResponse response;
+        assert(client.querySketch(vector<uint64_t>(signatures.begin(), signatures.begin() + m), 3, 0, response) && response.status == QueryStatus::OK);
+    }
+
+    // concurrent clients, whose queries are answered in batches
+    {
+        const uint64_t numClients = 8;
+        const uint64_t numQueriesPerClient = 50;
+        QueryClient statsClient(socketPath);
+        string stats;
+        assert(statsClient.getStats(stats));
+        const uint64_t numBatchesBefore = getStat(stats, "batches");
+        vector<thread> clients;
+        for(uint64_t c = 0; c < numClients; ++c) {
+            clients.emplace_back([&, c] {
+                QueryClient client(socketPath);
+                assert(client.good());
+                for(uint64_t i = 0; i < numQueriesPerClient; ++i) {
+                    const uint64_t q = (c * numQueriesPerClient + i) % n;
+                    QueryServerResponse response;
+                    assert(client.queryFasta(">query\n" + to_string(q) + "\n", 5, 0, response) && response.status == QueryStatus::OK);
+                    checkHits(response.hits, computeBatchTopK(signatures.data() + q * m, 1, signatures.data(), n, m, 5)[0]);
+                }
+            });
+        }
+        for(auto& client : clients) client.join();
+        assert(statsClient.getStats(stats));
+        const uint64_t numBatches = getStat(stats, "batches") - numBatchesBefore;
+        assert(numBatches > 0 && numBatches <= numClients * numQueriesPerClient);
+        cout << "queries = " << numClients * numQueriesPerClient << ", batches = " << numBatches;
+        cout << ", latency p50 = " << getStat(stats, "latency_p50_us") << " us, p99 = " << getStat(stats, "latency_p99_us") << " us" << endl;
+    }
+
+    // a new version of the sketch file with a different signature size is loaded while a client is connected
+    {
+        QueryClient client(socketPath);
+        const vector<uint64_t> newSignatures = generateSignatures(rng, n / 2, 2 * m);
+        assert(writeDatabase(fileName, newSignatures, n / 2, 2 * m));
+        string stats;
+        for(int i = 0; i < 500; ++i) {
+            // the reload is checked after batches and whenever the batch thread wakes up
+            assert(client.getStats(stats));
+            if (getStat(stats, "generation") == 2) break;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        assert(getStat(stats, "generation") == 2 && getStat(stats, "signatures") == n / 2);
+        QueryServerResponse response;
+        assert(client.querySketch(vector<uint64_t>(signatures.begin(), signatures.begin() + m), 10, 0, response) && response.status == QueryStatus::INCOMPATIBLE);
+        assert(client.querySketch(vector<uint64_t>(newSignatures.begin(), newSignatures.begin() + 2 * m), 3, 0, response) && response.status == QueryStatus::OK);
+        assert(response.m == 2 * m);
+        checkHits(response.hits, computeBatchTopK(newSignatures.data(), 1, newSignatures.data(), n / 2, 2 * m, 3)[0]);
+
+        // an invalid version is ignored
+        {
+            FILE* file = fopen((fileName + ".tmp").c_str(), "wb");
+            fputs("invalid", file);
+            fclose(file);
+            rename((fileName + ".tmp").c_str(), fileName.c_str());
+        }
+        this_thread::sleep_for(chrono::milliseconds(200));
+        assert(client.getStats(stats) && getStat(stats, "generation") == 2);
+        assert(client.querySketch(vector<uint64_t>(newSignatures.begin(), newSignatures.begin() + 2 * m), 3, 0, response) && response.status == QueryStatus::OK);
+
+        // a query sketched with the parameters of the previous version is not compared with a new version of the same
+        // signature size but another k
+        assert(getStat(stats, "k") == 21 && getStat(stats, "m") == 2 * m);
+        thread waitingClient([&] {
+            QueryClient client(socketPath);
+            QueryServerResponse response;
+            assert(client.queryFasta(">wait\n0\n", 3, 0, response) && response.status == QueryStatus::INCOMPATIBLE);
+        });
+        while (!isWaiting) this_thread::sleep_for(chrono::milliseconds(1));
+        assert(writeDatabase(fileName, newSignatures, n / 2, 2 * m, 31));
+        for(int i = 0; i < 500; ++i) {
+            assert(client.getStats(stats));
+            if (getStat(stats, "generation") == 3) break;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        assert(getStat(stats, "generation") == 3 && getStat(stats, "k") == 31);
+        isReleased = true;
+        waitingClient.join();
+    }
+
+    server.stop();
+    assert(!QueryClient(socketPath).good());
+    remove(fileName.c_str());
+    return 0;
+}
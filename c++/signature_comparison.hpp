@@ -0,0 +1,199 @@
+#ifndef _SIGNATURE_COMPARISON_HPP_
+#define _SIGNATURE_COMPARISON_HPP_
+
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIGNATURE_COMPARISON_X86
+#include <immintrin.h>
+#endif
+
+// Kernels counting the number of equal components of signatures with 64-, 32- or 16-bit registers.
+// Besides a portable scalar version, AVX2 and AVX-512 versions are compiled using target attributes and
+// selected at runtime depending on the features of the CPU, hence no special compiler flags are needed.
+// For comparing one query with many signatures that are stored contiguously, the query is compared with
+// 4 signatures at a time, such that every loaded block of the query is used 4 times.
+
+enum class SimdLevel {SCALAR, AVX2, AVX512};
+
+inline const char* getSimdLevelName(SimdLevel level) {
+    switch(level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+// returns the highest SIMD level supported by the CPU, determined once
+inline SimdLevel getSupportedSimdLevel() {
+#ifdef SIGNATURE_COMPARISON_X86
+    static const SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return SimdLevel::AVX2;
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+namespace signature_comparison {
+
+template<typename T>
+uint32_t countEqualScalar(const T* a, const T* b, uint32_t m) {
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < m; ++i) {
+        count += (a[i] == b[i]);
+    }
+    return count;
+}
+
+// compares query with the 4 signatures s0, s1, s2, s3
+template<typename T>
+void countEqual4Scalar(const T* query, const T* s0, const T* s1, const T* s2, const T* s3, uint32_t m, uint32_t* counts) {
+    uint32_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    for(uint32_t i = 0; i < m; ++i) {
+        const T q = query[i];
+        c0 += (q == s0[i]);
+        c1 += (q == s1[i]);
+        c2 += (q == s2[i]);
+        c3 += (q == s3[i]);
+    }
+    counts[0] = c0;
+    counts[1] = c1;
+    counts[2] = c2;
+    counts[3] = c3;
+}
+
+#ifdef SIGNATURE_COMPARISON_X86
+
+// number of equal components given two 256-bit blocks, every equal byte sets one bit of the mask
+template<typename T>
+__attribute__((target("avx2,popcnt"))) inline uint32_t countEqualAvx2Block(__m256i x, __m256i y) {
+    __m256i eq;
+    if constexpr(sizeof(T) == 8) eq = _mm256_cmpeq_epi64(x, y);
+    else if constexpr(sizeof(T) == 4) eq = _mm256_cmpeq_epi32(x, y);
+    else eq = _mm256_cmpeq_epi16(x, y);
+    return __builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(eq)));
+}
+
+template<typename T>
+__attribute__((target("avx2,popcnt"))) uint32_t countEqualAvx2(const T* a, const T* b, uint32_t m) {
+    constexpr uint32_t n = 32 / sizeof(T);
+    uint32_t byteCount = 0;
+    uint32_t i = 0;
+    for(; i + n <= m; i += n) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        byteCount += countEqualAvx2Block<T>(x, y);
+    }
+    return byteCount / sizeof(T) + countEqualScalar(a + i, b + i, m - i);
+}
+
+template<typename T>
+__attribute__((target("avx2,popcnt"))) void countEqual4Avx2(const T* query, const T* s0, const T* s1, const T* s2, const T* s3, uint32_t m, uint32_t* counts) {
+    constexpr uint32_t n = 32 / sizeof(T);
+    uint32_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    uint32_t i = 0;
+    for(; i + n <= m; i += n) {
+        const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query + i));
+        c0 += countEqualAvx2Block<T>(q, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s0 + i)));
+        c1 += countEqualAvx2Block<T>(q, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s1 + i)));
+        c2 += countEqualAvx2Block<T>(q, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s2 + i)));
+        c3 += countEqualAvx2Block<T>(q, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s3 + i)));
+    }
+    countEqual4Scalar(query + i, s0 + i, s1 + i, s2 + i, s3 + i, m - i, counts);
+    counts[0] += c0 / sizeof(T);
+    counts[1] += c1 / sizeof(T);
+    counts[2] += c2 / sizeof(T);
+    counts[3] += c3 / sizeof(T);
+}
+
+// number of equal components given two 512-bit blocks
+template<typename T>
+__attribute__((target("avx512f,avx512bw,popcnt"))) inline uint32_t countEqualAvx512Block(__m512i x, __m512i y) {
+    if constexpr(sizeof(T) == 8) return __builtin_popcount(_mm512_cmpeq_epi64_mask(x, y));
+    else if constexpr(sizeof(T) == 4) return __builtin_popcount(_mm512_cmpeq_epi32_mask(x, y));
+    else return __builtin_popcount(_mm512_cmpeq_epi16_mask(x, y));
+}
+
+template<typename T>
+__attribute__((target("avx512f,avx512bw,popcnt"))) uint32_t countEqualAvx512(const T* a, const T* b, uint32_t m) {
+    constexpr uint32_t n = 64 / sizeof(T);
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for(; i + n <= m; i += n) {
+        const __m512i x = _mm512_loadu_si512(a + i);
+        const __m512i y = _mm512_loadu_si512(b + i);
+        count += countEqualAvx512Block<T>(x, y);
+    }
+    return count + countEqualScalar(a + i, b + i, m - i);
+}
+
+template<typename T>
+__attribute__((target("avx512f,avx512bw,popcnt"))) void countEqual4Avx512(const T* query, const T* s0, const T* s1, const T* s2, const T* s3, uint32_t m, uint32_t* counts) {
+    constexpr uint32_t n = 64 / sizeof(T);
+    uint32_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    uint32_t i = 0;
+    for(; i + n <= m; i += n) {
+        const __m512i q = _mm512_loadu_si512(query + i);
+        c0 += countEqualAvx512Block<T>(q, _mm512_loadu_si512(s0 + i));
+        c1 += countEqualAvx512Block<T>(q, _mm512_loadu_si512(s1 + i));
+        c2 += countEqualAvx512Block<T>(q, _mm512_loadu_si512(s2 + i));
+        c3 += countEqualAvx512Block<T>(q, _mm512_loadu_si512(s3 + i));
+    }
+    countEqual4Scalar(query + i, s0 + i, s1 + i, s2 + i, s3 + i, m - i, counts);
+    counts[0] += c0;
+    counts[1] += c1;
+    counts[2] += c2;
+    counts[3] += c3;
+}
+
+#endif // SIGNATURE_COMPARISON_X86
+
+} // namespace signature_comparison
+
+// Returns the number of positions i < m with a[i] == b[i]. T must be an unsigned integer type of 16, 32 or 64 bits.
+// If the requested SIMD level is not supported by the CPU, the scalar kernel is used.
+template<typename T>
+uint32_t countEqualComponents(const T* a, const T* b, uint32_t m, SimdLevel level = getSupportedSimdLevel()) {
+    static_assert(std::is_same<T, uint64_t>::value || std::is_same<T, uint32_t>::value || std::is_same<T, uint16_t>::value, "Require T to be uint64_t, uint32_t, or uint16_t!");
+#ifdef SIGNATURE_COMPARISON_X86
+    if (level > getSupportedSimdLevel()) level = SimdLevel::SCALAR;
+    if (level == SimdLevel::AVX512) return signature_comparison::countEqualAvx512(a, b, m);
+    if (level == SimdLevel::AVX2) return signature_comparison::countEqualAvx2(a, b, m);
+#endif
+    return signature_comparison::countEqualScalar(a, b, m);
+}
+
+// Compares the query with numSignatures signatures of size m that are stored contiguously in signatures,
+// counts[j] is set to the number of equal components of the query and the j-th signature.
+template<typename T>
+void countEqualComponentsOneToMany(const T* query, const T* signatures, uint64_t numSignatures, uint32_t m, uint32_t* counts, SimdLevel level = getSupportedSimdLevel()) {
+    static_assert(std::is_same<T, uint64_t>::value || std::is_same<T, uint32_t>::value || std::is_same<T, uint16_t>::value, "Require T to be uint64_t, uint32_t, or uint16_t!");
+    if (level > getSupportedSimdLevel()) level = SimdLevel::SCALAR;
+    uint64_t j = 0;
+    for(; j + 4 <= numSignatures; j += 4) {
+        const T* s = signatures + j * m;
+#ifdef SIGNATURE_COMPARISON_X86
+        if (level == SimdLevel::AVX512) {
+            signature_comparison::countEqual4Avx512(query, s, s + m, s + 2 * m, s + 3 * m, m, counts + j);
+            continue;
+        }
+        if (level == SimdLevel::AVX2) {
+            signature_comparison::countEqual4Avx2(query, s, s + m, s + 2 * m, s + 3 * m, m, counts + j);
+            continue;
+        }
+#endif
+        signature_comparison::countEqual4Scalar(query, s, s + m, s + 2 * m, s + 3 * m, m, counts + j);
+    }
+    for(; j < numSignatures; ++j) {
+        counts[j] = countEqualComponents(query, signatures + j * m, m, level);
+    }
+}
+
+#endif // _SIGNATURE_COMPARISON_HPP_
@@ -0,0 +1,93 @@
+#include "signature_comparison.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+// Checks all comparison kernels supported by the CPU against a naive loop and reports the number of
+// comparisons per second for pairwise comparisons and for one query compared with many signatures.
+
+template<typename T>
+void testKernels(mt19937_64& rng, const vector<SimdLevel>& levels) {
+    for(uint32_t m : {0, 1, 3, 4, 5, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 1024, 1031}) {
+        for(uint64_t numSignatures : {1, 3, 4, 5, 11}) {
+            vector<T> query(m);
+            vector<T> signatures(m * numSignatures);
+            for(auto& x : query) x = rng();
+            for(uint64_t j = 0; j < numSignatures; ++j) {
+                const double p = static_cast<double>(j) / numSignatures;
+                for(uint32_t i = 0; i < m; ++i) signatures[j * m + i] = (uniform_real_distribution<double>(0., 1.)(rng) < p) ? query[i] : static_cast<T>(rng());
+            }
+            vector<uint32_t> expected(numSignatures);
+            for(uint64_t j = 0; j < numSignatures; ++j) {
+                for(uint32_t i = 0; i < m; ++i) if (query[i] == signatures[j * m + i]) expected[j] += 1;
+            }
+            for(SimdLevel level : levels) {
+                vector<uint32_t> counts(numSignatures);
+                countEqualComponentsOneToMany(query.data(), signatures.data(), numSignatures, m, counts.data(), level);
+                assert(counts == expected);
+                for(uint64_t j = 0; j < numSignatures; ++j) {
+                    assert(countEqualComponents(query.data(), signatures.data() + j * m, m, level) == expected[j]);
+                }
+            }
+        }
+    }
+}
+
+template<typename T>
+void benchmark(mt19937_64& rng, const vector<SimdLevel>& levels) {
+    for(uint32_t m : {128, 256, 512, 1024, 2048, 4096}) {
+        // 16 MB of signatures, components from a small alphabet such that about 1/16 of them are equal
+        const uint64_t numSignatures = (UINT64_C(16) << 20) / (m * sizeof(T));
+        vector<T> signatures(numSignatures * m);
+        for(auto& x : signatures) x = rng() & 0xF;
+        vector<uint32_t> counts(numSignatures);
+        const uint64_t numRepetitions = 8;
+        for(SimdLevel level : levels) {
+            uint64_t checksum = 0;
+            auto start = chrono::steady_clock::now();
+            for(uint64_t r = 0; r < numRepetitions; ++r) {
+                const T* query = signatures.data() + r * m;
+                for(uint64_t j = 0; j < numSignatures; ++j) checksum += countEqualComponents(query, signatures.data() + j * m, m, level);
+            }
+            auto end = chrono::steady_clock::now();
+            const double pairwise = numSignatures * numRepetitions / chrono::duration<double>(end - start).count();
+
+            start = chrono::steady_clock::now();
+            for(uint64_t r = 0; r < numRepetitions; ++r) {
+                countEqualComponentsOneToMany(signatures.data() + r * m, signatures.data(), numSignatures, m, counts.data(), level);
+                checksum += counts[r];
+            }
+            end = chrono::steady_clock::now();
+            const double oneToMany = numSignatures * numRepetitions / chrono::duration<double>(end - start).count();
+
+            cout << "bits = " << sizeof(T) * 8 << ", m = " << m << ", kernel = " << getSimdLevelName(level);
+            cout << ", pairwise = " << pairwise << " comparisons/s, one-to-many = " << oneToMany << " comparisons/s";
+            cout << " (checksum = " << checksum << ")" << endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    vector<SimdLevel> levels = {SimdLevel::SCALAR};
+    if (getSupportedSimdLevel() >= SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+    if (getSupportedSimdLevel() >= SimdLevel::AVX512) levels.push_back(SimdLevel::AVX512);
+    cout << "supported = " << getSimdLevelName(getSupportedSimdLevel()) << endl;
+
+    mt19937_64 rng(UINT64_C(0x3e81c4b7f06a2d59));
+
+    testKernels<uint64_t>(rng, levels);
+    testKernels<uint32_t>(rng, levels);
+    testKernels<uint16_t>(rng, levels);
+
+    cout << scientific;
+    benchmark<uint64_t>(rng, levels);
+    benchmark<uint32_t>(rng, levels);
+    benchmark<uint16_t>(rng, levels);
+
+    return 0;
+}
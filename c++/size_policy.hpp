@@ -0,0 +1,83 @@
+#ifndef _SIZE_POLICY_HPP_
+#define _SIZE_POLICY_HPP_
+
+#include <cstdint>
+#include <cassert>
+#include <array>
+#include <memory>
+
+// Signature size m only known at runtime.
+class DynamicSize {
+    uint32_t m;
+public:
+    static constexpr uint32_t fixedValue = 0;
+
+    DynamicSize(uint32_t m) : m(m) {}
+
+    operator uint32_t() const {
+        return m;
+    }
+};
+
+// Signature size m known at compile time. Allows the compiler to constant-fold
+// bounds and the modulus in getUniformLemire(m, rng), and register arrays
+// can be stored inline instead of on the heap.
+template<uint32_t M>
+class FixedSize {
+    static_assert(M > 0, "Require M > 0!");
+public:
+    static constexpr uint32_t fixedValue = M;
+
+    FixedSize() {}
+
+    FixedSize(uint32_t m) {
+        assert(m == M);
+    }
+
+    constexpr operator uint32_t() const {
+        return M;
+    }
+};
+
+// array with inline storage for N > 0 and heap storage for N == 0
+template<typename T, uint32_t N>
+class RegisterArray {
+    std::array<T, N> values;
+public:
+    explicit RegisterArray(uint32_t size) {
+        assert(size == N);
+    }
+
+    T* get() {return values.data();}
+    const T* get() const {return values.data();}
+    T& operator[](uint32_t idx) {return values[idx];}
+    const T& operator[](uint32_t idx) const {return values[idx];}
+};
+
+template<typename T>
+class RegisterArray<T, 0> {
+    const std::unique_ptr<T[]> values;
+public:
+    explicit RegisterArray(uint32_t size) : values(new T[size]) {}
+
+    T* get() {return values.get();}
+    const T* get() const {return values.get();}
+    T& operator[](uint32_t idx) {return values[idx];}
+    const T& operator[](uint32_t idx) const {return values[idx];}
+};
+
+// Calls f with a FixedSize instance if m is one of the precompiled signature sizes,
+// otherwise with a DynamicSize instance. The size policy type can be obtained
+// using decltype within f.
+template<typename F>
+auto dispatchSize(uint32_t m, F&& f) {
+    switch(m) {
+        case 128: return f(FixedSize<128>());
+        case 256: return f(FixedSize<256>());
+        case 1024: return f(FixedSize<1024>());
+        case 4096: return f(FixedSize<4096>());
+        default: return f(DynamicSize(m));
+    }
+}
+
+#endif // _SIZE_POLICY_HPP_
@@ -0,0 +1,224 @@
+#ifndef _SKETCH_CACHE_HPP_
+#define _SKETCH_CACHE_HPP_
+
+#include "sketch_file.hpp"
+#include "wyhash/wyhash.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Content-addressed cache of signatures in a local directory.
+//
+// Every signature is stored as a sketch file with a single signature (see sketch_file.hpp) named after a hash of
+// the content hash of the input file and all parameters of the signature (k, m, algorithm, seed, weighted and
+// canonical flags, hash scheme). Hence, renamed or copied files hit the cache, and changed files or parameters miss.
+// The parameters are also stored in the entry and compared on lookup, such that hash collisions of keys are detected.
+//
+// Hashing the content requires reading the whole file. To avoid this for unchanged files, the cache keeps an index
+// from (path, size, modification time) to the content hash, such that most lookups only need a stat call.
+// The index is stored as text file "index.tsv" in the cache directory by flush() and by the destructor.
+// Entries are written to temporary files and renamed, hence concurrent processes never see partial entries.
+// All methods are thread-safe.
+class SketchCache {
+    struct StatEntry {
+        uint64_t size;
+        int64_t modificationTime; // nanoseconds
+        uint64_t contentHash;
+    };
+
+    const std::string directory;
+    bool isGood;
+    std::mutex mutex;
+    std::unordered_map<std::string, StatEntry> statIndex;
+    bool isIndexModified = false;
+    std::atomic<uint64_t> numHashedFiles{0};
+    std::atomic<uint64_t> numHits{0};
+    std::atomic<uint64_t> numMisses{0};
+    std::atomic<uint64_t> numTemporaryFiles{0};
+
+    std::string getIndexFileName() const {
+        return directory + "/index.tsv";
+    }
+
+    static bool getStat(const std::string& fileName, uint64_t& size, int64_t& modificationTime) {
+        struct stat status;
+        if (stat(fileName.c_str(), &status) != 0) return false;
+        size = status.st_size;
+        modificationTime = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+        return true;
+    }
+
+    static std::string toHex(uint64_t x) {
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(x));
+        return buffer;
+    }
+
+    std::string getEntryFileName(uint64_t contentHash, const SketchFileInfo& info) const {
+        std::ostringstream key;
+        key << contentHash << '\t' << info.k << '\t' << info.m << '\t' << info.algorithm << '\t' << info.seed << '\t';
+        key << info.weighted << '\t' << info.canonical << '\t' << info.hashScheme;
+        const std::string s = key.str();
+        return directory + "/" + toHex(wyhash(s.data(), s.size(), 0)) + ".pmh";
+    }
+
+    void loadIndex() {
+        std::ifstream in(getIndexFileName());
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string contentHash;
+            StatEntry entry;
+            if (!(fields >> contentHash >> entry.size >> entry.modificationTime) || fields.get() != '\t') continue;
+            // lines with a malformed hash, e.g. partially written ones, are skipped like other malformed lines
+            char* end = nullptr;
+            if (!std::isxdigit(static_cast<unsigned char>(contentHash[0]))) continue;
+            errno = 0;
+            entry.contentHash = std::strtoull(contentHash.c_str(), &end, 16);
+            if (*end != '\0' || errno == ERANGE) continue;
+            std::string path;
+            std::getline(fields, path);
+            statIndex[path] = entry;
+        }
+    }
+
+public:
+
+    // Hash of the content of a file, computed from 1 MiB chunks, each chunk is hashed with the hash of the
+    // previous chunk as seed. Returns false if the file cannot be read.
+    static bool computeContentHash(const std::string& fileName, uint64_t& contentHash) {
+        std::ifstream in(fileName, std::ios::binary);
+        if (!in) return false;
+        std::vector<char> buffer(UINT64_C(1) << 20);
+        uint64_t hash = UINT64_C(0x6a09e667f3bcc908);
+        while (in) {
+            in.read(buffer.data(), buffer.size());
+            const std::streamsize numRead = in.gcount();
+            if (numRead > 0) hash = wyhash(buffer.data(), numRead, hash);
+        }
+        if (!in.eof()) return false;
+        contentHash = hash;
+        return true;
+    }
+
+    // creates the directory if it does not exist
+    explicit SketchCache(const std::string& directory) : directory(directory) {
+        mkdir(directory.c_str(), 0755);
+        struct stat status;
+        isGood = stat(directory.c_str(), &status) == 0 && S_ISDIR(status.st_mode) && access(directory.c_str(), W_OK) == 0;
+        if (isGood) loadIndex();
+    }
+
+    SketchCache(const SketchCache&) = delete;
+    SketchCache& operator=(const SketchCache&) = delete;
+
+    ~SketchCache() {
+        flush();
+    }
+
+    bool good() const {
+        return isGood;
+    }
+
+    // Content hash of the file, taken from the index if the size and the modification time did not change.
+    bool getContentHash(const std::string& fileName, uint64_t& contentHash) {
+        uint64_t size;
+        int64_t modificationTime;
+        if (!getStat(fileName, size, modificationTime)) return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = statIndex.find(fileName);
+            if (it != statIndex.end() && it->second.size == size && it->second.modificationTime == modificationTime) {
+                contentHash = it->second.contentHash;
+                return true;
+            }
+        }
+        if (!computeContentHash(fileName, contentHash)) return false;
+        numHashedFiles += 1;
+        std::lock_guard<std::mutex> lock(mutex);
+        statIndex[fileName] = StatEntry{size, modificationTime, contentHash};
+        isIndexModified = true;
+        return true;
+    }
+
+    // Returns true and sets signature if the cache contains the signature of the file with the given parameters.
+    bool lookup(const std::string& fileName, const SketchFileInfo& info, std::vector<uint64_t>& signature) {
+        uint64_t contentHash;
+        if (!isGood || !getContentHash(fileName, contentHash)) {
+            numMisses += 1;
+            return false;
+        }
+        const std::string entryFileName = getEntryFileName(contentHash, info);
+        if (access(entryFileName.c_str(), R_OK) != 0) {
+            numMisses += 1;
+            return false;
+        }
+        MappedSketchFile entry(entryFileName);
+        if (!entry.good() || entry.size() != 1 || !entry.getInfo().isCompatible(info)) {
+            numMisses += 1;
+            return false;
+        }
+        signature.assign(entry.getSignature(0), entry.getSignature(0) + info.m);
+        numHits += 1;
+        return true;
+    }
+
+    // Stores the signature of the file with the given parameters, returns false if it could not be written.
+    bool store(const std::string& fileName, const SketchFileInfo& info, const std::vector<uint64_t>& signature) {
+        uint64_t contentHash;
+        if (!isGood || signature.size() != info.m || !getContentHash(fileName, contentHash)) return false;
+        const std::string entryFileName = getEntryFileName(contentHash, info);
+        const std::string temporaryFileName = entryFileName + ".tmp" + std::to_string(getpid()) + "_" + std::to_string(numTemporaryFiles++);
+        if (!writeSketchFile(temporaryFileName, info, {fileName}, signature.data())) {
+            std::remove(temporaryFileName.c_str());
+            return false;
+        }
+        return std::rename(temporaryFileName.c_str(), entryFileName.c_str()) == 0;
+    }
+
+    // writes the index of content hashes if it has changed
+    bool flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!isGood || !isIndexModified) return true;
+        const std::string temporaryFileName = getIndexFileName() + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream out(temporaryFileName, std::ios::trunc);
+            for (const auto& e : statIndex) {
+                out << toHex(e.second.contentHash) << '\t' << e.second.size << '\t' << e.second.modificationTime << '\t' << e.first << '\n';
+            }
+            out.close();
+            if (!out.good()) return false;
+        }
+        if (std::rename(temporaryFileName.c_str(), getIndexFileName().c_str()) != 0) return false;
+        isIndexModified = false;
+        return true;
+    }
+
+    uint64_t getNumHits() const {
+        return numHits;
+    }
+
+    uint64_t getNumMisses() const {
+        return numMisses;
+    }
+
+    // number of files whose content had to be hashed, because they were not in the index or changed
+    uint64_t getNumHashedFiles() const {
+        return numHashedFiles;
+    }
+};
+
+#endif // _SKETCH_CACHE_HPP_
@@ -0,0 +1,129 @@
+#include "sketch_cache.hpp"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+
+#include <sys/time.h>
+
+using namespace std;
+
+// Checks hits and misses of the sketch cache for unchanged, touched, modified, and renamed files and for different
+// parameters, and that the index of content hashes avoids hashing unchanged files after reopening the cache.
+
+void writeFile(const string& fileName, const string& content) {
+    ofstream out(fileName, ios::binary | ios::trunc);
+    out << content;
+}
+
+// sets the modification time explicitly, as consecutive writes may have the same time stamp
+void setModificationTime(const string& fileName, long seconds) {
+    struct timeval times[2] = {{seconds, 0}, {seconds, 0}};
+    utimes(fileName.c_str(), times);
+}
+
+int main(int argc, char* argv[]) {
+
+    const string directory = (argc > 1) ? string(argv[1]) : string("sketch_cache_test");
+    const string genomeA = directory + "_a.fna";
+    const string genomeB = directory + "_b.fna";
+
+    SketchFileInfo info;
+    info.k = 21;
+    info.m = 8;
+    info.algorithm = "probminhash1";
+    info.seed = 123456789;
+    info.weighted = true;
+    info.hashScheme = "2bit-forward-wyhash64";
+    const vector<uint64_t> signatureA = {1, 2, 3, 4, 5, 6, 7, 8};
+    const vector<uint64_t> signatureB = {8, 7, 6, 5, 4, 3, 2, 1};
+
+    writeFile(genomeA, ">a\nACGTACGTAC\n");
+    writeFile(genomeB, ">b\nTTTTGGGGCC\n");
+    setModificationTime(genomeA, 1000000);
+    setModificationTime(genomeB, 1000000);
+
+    {
+        SketchCache cache(directory);
+        assert(cache.good());
+        vector<uint64_t> signature;
+        assert(!cache.lookup(genomeA, info, signature));
+        assert(cache.store(genomeA, info, signatureA));
+        assert(cache.store(genomeB, info, signatureB));
+        assert(cache.lookup(genomeA, info, signature) && signature == signatureA);
+        assert(cache.lookup(genomeB, info, signature) && signature == signatureB);
+        assert(cache.getNumHashedFiles() == 2);
+
+        // other parameters
+        SketchFileInfo other = info;
+        other.m = 16;
+        assert(!cache.lookup(genomeA, other, signature));
+        other = info;
+        other.canonical = true;
+        assert(!cache.lookup(genomeA, other, signature));
+        other = info;
+        other.algorithm = "minhash";
+        assert(!cache.lookup(genomeA, other, signature));
+        assert(cache.getNumHashedFiles() == 2);
+        assert(cache.flush());
+    }
+
+    {
+        // the content hashes are taken from the index
+        SketchCache cache(directory);
+        vector<uint64_t> signature;
+        assert(cache.lookup(genomeA, info, signature) && signature == signatureA);
+        assert(cache.lookup(genomeB, info, signature) && signature == signatureB);
+        assert(cache.getNumHashedFiles() == 0);
+
+        // touched file with the same content is hashed again and found
+        setModificationTime(genomeA, 2000000);
+        assert(cache.lookup(genomeA, info, signature) && signature == signatureA);
+        assert(cache.getNumHashedFiles() == 1);
+
+        // modified file with the same size is not found
+        writeFile(genomeB, ">b\nTTTTGGGGCA\n");
+        setModificationTime(genomeB, 3000000);
+        assert(!cache.lookup(genomeB, info, signature));
+        assert(cache.getNumHashedFiles() == 2);
+
+        // a copy of a cached file is found by its content
+        const string copy = directory + "_copy.fna";
+        writeFile(copy, ">a\nACGTACGTAC\n");
+        assert(cache.lookup(copy, info, signature) && signature == signatureA);
+        remove(copy.c_str());
+
+        // missing file
+        assert(!cache.lookup(directory + "_missing.fna", info, signature));
+        assert(cache.getNumHits() == 4 && cache.getNumMisses() == 2);
+    }
+
+    {
+        // malformed lines of the index are skipped
+        {
+            ofstream out(directory + "/index.tsv", ios::app);
+            out << "xyz\t12\t34\t" << genomeB << "\n";
+            out << "12ab" << string(40, 'f') << "\t12\t34\t" << genomeB << "\n";
+            out << "12\t";
+        }
+        SketchCache cache(directory);
+        assert(cache.good());
+        vector<uint64_t> signature;
+        assert(cache.lookup(genomeA, info, signature) && signature == signatureA);
+    }
+
+    // clean up
+    {
+        ifstream in(directory + "/index.tsv");
+        assert(in.good());
+    }
+    remove(genomeA.c_str());
+    remove(genomeB.c_str());
+    filesystem::remove_all(directory);
+
+    return 0;
+}
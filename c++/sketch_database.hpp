@@ -0,0 +1,281 @@
+#ifndef _SKETCH_DATABASE_HPP_
+#define _SKETCH_DATABASE_HPP_
+
+#include "sketch_file.hpp"
+#include "signature_comparison.hpp"
+#include "all_vs_all.hpp"
+#include "omp_pragma.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Persistent, append-only database of signatures in a directory.
+//
+// Files:
+//     manifest.tsv       segment file names and their numbers of signatures, one segment per line
+//     segment_NNNNNN.pmh immutable sketch files (see sketch_file.hpp), one per append
+//     tombstones.bin     ids of removed signatures (uint64), appended on removal
+//     distances.bin      numbers of equal components of all pairs as lower triangle, see below
+//
+// Signatures get consecutive ids in the order they are appended, ids are never reused. Removing a signature only
+// records a tombstone, its registers and distances stay in place and are skipped by readers.
+// An append first writes the new segment and then replaces the manifest by renaming a temporary file, hence an
+// interrupted append leaves the database unchanged.
+//
+// The distance file starts with the 8 bytes "PMHTRI01" and m (uint32), followed by the rows i = 1, 2, ... of the
+// lower triangle, row i contains the numbers of equal components (uint16) of signature i and the signatures
+// j = 0, ..., i - 1, hence the pair (i, j) with j < i is located at index i * (i - 1) / 2 + j. As appended signatures
+// only add rows at the end, updateDistances() compares just the new signatures with all others in
+// O(numNew * size()) time and appends their rows. Incomplete rows of an interrupted update are overwritten.
+class SketchDatabase {
+    struct Segment {
+        std::string fileName;
+        uint64_t begin; // id of the first signature
+        std::unique_ptr<MappedSketchFile> file;
+    };
+
+    static constexpr uint64_t distanceHeaderSize = 8 + sizeof(uint32_t);
+
+    const std::string directory;
+    std::vector<Segment> segments;
+    uint64_t numSignatures = 0;
+    std::unordered_set<uint64_t> tombstones;
+    SketchFileInfo info;
+    std::string error;
+
+    std::string getPath(const std::string& fileName) const {
+        return directory + "/" + fileName;
+    }
+
+    bool fail(const std::string& message) {
+        error = message;
+        return false;
+    }
+
+    bool mapSegment(const std::string& fileName, uint64_t expectedSize) {
+        std::unique_ptr<MappedSketchFile> file(new MappedSketchFile(getPath(fileName)));
+        if (!file->good()) return fail(file->getError());
+        if (file->size() != expectedSize) return fail(fileName + " does not match the manifest");
+        if (segments.empty()) info = file->getInfo();
+        else if (!file->getInfo().isCompatible(info)) return fail(fileName + " has incompatible parameters");
+        segments.push_back(Segment{fileName, numSignatures, std::move(file)});
+        numSignatures += expectedSize;
+        return true;
+    }
+
+    bool load() {
+        std::ifstream manifest(getPath("manifest.tsv"));
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream fields(line);
+            std::string fileName;
+            uint64_t size;
+            if (!(fields >> fileName >> size)) return fail("invalid manifest line: " + line);
+            if (!mapSegment(fileName, size)) return false;
+        }
+        std::ifstream in(getPath("tombstones.bin"), std::ios::binary);
+        uint64_t id;
+        while (in.read(reinterpret_cast<char*>(&id), sizeof(uint64_t))) tombstones.insert(id);
+        return true;
+    }
+
+    bool writeManifest() const {
+        const std::string temporaryFileName = getPath("manifest.tsv.tmp" + std::to_string(getpid()));
+        {
+            std::ofstream out(temporaryFileName, std::ios::trunc);
+            for (const auto& s : segments) out << s.fileName << '\t' << s.file->size() << '\n';
+            out.close();
+            if (!out.good()) return false;
+        }
+        return std::rename(temporaryFileName.c_str(), getPath("manifest.tsv").c_str()) == 0;
+    }
+
+    // number of complete rows in the distance file, creates the file if it does not exist
+    bool openDistances(std::fstream& file, uint64_t& numRows) {
+        const std::string fileName = getPath("distances.bin");
+        struct stat status;
+        if (stat(fileName.c_str(), &status) != 0) {
+            std::ofstream out(fileName, std::ios::binary);
+            out.write("PMHTRI01", 8);
+            out.write(reinterpret_cast<const char*>(&info.m), sizeof(uint32_t));
+            if (!out.good()) return fail("cannot write " + fileName);
+            status.st_size = distanceHeaderSize;
+        }
+        file.open(fileName, std::ios::binary | std::ios::in | std::ios::out);
+        char magic[8];
+        uint32_t m = 0;
+        file.read(magic, 8);
+        file.read(reinterpret_cast<char*>(&m), sizeof(uint32_t));
+        if (!file || std::string(magic, 8) != "PMHTRI01" || m != info.m) return fail(fileName + " is not a distance file of this database");
+        // row i has i entries, the file contains the rows 1, ..., numRows - 1 completely
+        const uint64_t numEntries = (static_cast<uint64_t>(status.st_size) - distanceHeaderSize) / sizeof(uint16_t);
+        numRows = 1;
+        while ((numRows + 1) * numRows / 2 <= numEntries && numRows < numSignatures) numRows += 1;
+        if (numSignatures == 0) numRows = 0;
+        return true;
+    }
+
+public:
+
+    // opens the database in the given directory, which is created if it does not exist
+    explicit SketchDatabase(const std::string& directory) : directory(directory) {
+        mkdir(directory.c_str(), 0755);
+        struct stat status;
+        if (stat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) fail("cannot create " + directory);
+        else load();
+    }
+
+    bool good() const {
+        return error.empty();
+    }
+
+    const std::string& getError() const {
+        return error;
+    }
+
+    // parameters of the signatures, only valid if the database is not empty
+    const SketchFileInfo& getInfo() const {
+        return info;
+    }
+
+    // number of ids, including removed signatures
+    uint64_t size() const {
+        return numSignatures;
+    }
+
+    uint64_t getNumSegments() const {
+        return segments.size();
+    }
+
+    uint64_t getNumRemoved() const {
+        return tombstones.size();
+    }
+
+    bool isRemoved(uint64_t id) const {
+        return tombstones.count(id) > 0;
+    }
+
+    const uint64_t* getSignature(uint64_t id) const {
+        assert(id < numSignatures);
+        auto it = std::upper_bound(segments.begin(), segments.end(), id, [](uint64_t x, const Segment& s) {return x < s.begin;}) - 1;
+        return it->file->getSignature(id - it->begin);
+    }
+
+    std::string getName(uint64_t id) const {
+        assert(id < numSignatures);
+        auto it = std::upper_bound(segments.begin(), segments.end(), id, [](uint64_t x, const Segment& s) {return x < s.begin;}) - 1;
+        return it->file->getName(id - it->begin);
+    }
+
+    // Appends n signatures of size info.m stored contiguously as a new segment, the first one gets the id size().
+    // Fails if the parameters differ from those of the signatures already in the database.
+    bool append(const SketchFileInfo& newInfo, const std::vector<std::string>& names, const uint64_t* registers) {
+        if (!good()) return false;
+        if (names.empty()) return true;
+        if (!segments.empty() && !newInfo.isCompatible(info)) return fail("the parameters of the new signatures differ from those of the database");
+        char fileName[32];
+        std::snprintf(fileName, sizeof(fileName), "segment_%06llu.pmh", static_cast<unsigned long long>(segments.size()));
+        if (!writeSketchFile(getPath(fileName), newInfo, names, registers)) return fail(std::string("cannot write ") + fileName);
+        if (!mapSegment(fileName, names.size())) return false;
+        if (!writeManifest()) {
+            segments.pop_back();
+            numSignatures -= names.size();
+            return fail("cannot write manifest");
+        }
+        return true;
+    }
+
+    // records the removal of a signature, returns false if the id does not exist
+    bool remove(uint64_t id) {
+        if (!good() || id >= numSignatures) return false;
+        if (isRemoved(id)) return true;
+        std::ofstream out(getPath("tombstones.bin"), std::ios::binary | std::ios::app);
+        out.write(reinterpret_cast<const char*>(&id), sizeof(uint64_t));
+        out.close();
+        if (!out.good()) return fail("cannot write tombstones");
+        tombstones.insert(id);
+        return true;
+    }
+
+    // number of signatures whose distances to all previous signatures are stored, including the first signature
+    uint64_t getNumDistanceRows() {
+        if (!good() || numSignatures == 0) return 0;
+        // the first row is empty
+        struct stat status;
+        if (stat(getPath("distances.bin").c_str(), &status) != 0) return 1;
+        std::fstream file;
+        uint64_t numRows = 0;
+        if (!openDistances(file, numRows)) return 0;
+        return numRows;
+    }
+
+    // Computes the rows of all signatures appended since the last update and appends them to the distance file.
+    // For every new row i in ascending order, consumer(i, counts) is called, where counts[j] is the number of equal
+    // components of the signatures i and j for all j < i, including removed signatures.
+    // The database is traversed in tiles that fit into the cache, and every tile is compared with a batch of
+    // new signatures at once, hence the database is loaded from memory only once per batch.
+    template<typename C>
+    bool updateDistances(C&& consumer, uint64_t maxBatchSizeInBytes = UINT64_C(256) << 20) {
+        if (!good() || numSignatures == 0) return good();
+        if (info.m > UINT16_MAX) return fail("distances require m <= 65535");
+        std::fstream file;
+        uint64_t numRows;
+        if (!openDistances(file, numRows)) return false;
+        const uint32_t m = info.m;
+        const uint64_t tileSize = getDefaultTileSize<uint64_t>(m);
+        file.seekp(distanceHeaderSize + numRows * (numRows - 1) / 2 * sizeof(uint16_t));
+
+        for (uint64_t batchBegin = numRows; batchBegin < numSignatures; ) {
+            // rows [batchBegin, batchEnd) are computed together, row i starts at rows[rowOffsets[i - batchBegin]]
+            uint64_t batchEnd = batchBegin + 1;
+            while (batchEnd < numSignatures && (batchEnd * (batchEnd + 1) / 2 - batchBegin * (batchBegin - 1) / 2) * sizeof(uint16_t) <= maxBatchSizeInBytes) batchEnd += 1;
+            std::vector<uint64_t> rowOffsets(batchEnd - batchBegin + 1, 0);
+            for (uint64_t i = batchBegin; i < batchEnd; ++i) rowOffsets[i - batchBegin + 1] = rowOffsets[i - batchBegin] + i;
+            std::vector<uint16_t> rows(rowOffsets.back());
+
+            // tiles of the signatures j < batchEnd - 1 within segments, such that every tile is contiguous
+            std::vector<std::pair<uint64_t, uint64_t>> tiles;
+            for (const auto& s : segments) {
+                const uint64_t end = std::min(s.begin + s.file->size(), batchEnd - 1);
+                for (uint64_t j = s.begin; j < end; j += tileSize) tiles.emplace_back(j, std::min(j + tileSize, end));
+            }
+            OMP_PRAGMA(omp parallel)
+            {
+                std::vector<uint32_t> counts(tileSize);
+                OMP_PRAGMA(omp for schedule(dynamic, 1))
+                for (int64_t t = 0; t < static_cast<int64_t>(tiles.size()); ++t) {
+                    const uint64_t jBegin = tiles[t].first;
+                    const uint64_t* tileSignatures = getSignature(jBegin);
+                    for (uint64_t i = std::max(batchBegin, jBegin + 1); i < batchEnd; ++i) {
+                        const uint64_t jEnd = std::min(tiles[t].second, i);
+                        countEqualComponentsOneToMany(getSignature(i), tileSignatures, jEnd - jBegin, m, counts.data());
+                        std::copy(counts.begin(), counts.begin() + (jEnd - jBegin), rows.begin() + rowOffsets[i - batchBegin] + jBegin);
+                    }
+                }
+            }
+            file.write(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(uint16_t));
+            file.flush();
+            if (!file.good()) return fail("cannot write distances");
+            for (uint64_t i = batchBegin; i < batchEnd; ++i) consumer(i, rows.data() + rowOffsets[i - batchBegin]);
+            batchBegin = batchEnd;
+        }
+        return true;
+    }
+
+    bool updateDistances() {
+        return updateDistances([](uint64_t, const uint16_t*) {});
+    }
+};
+
+#endif // _SKETCH_DATABASE_HPP_
@@ -0,0 +1,137 @@
+#include "sketch_database.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <filesystem>
+#include <cassert>
+
+using namespace std;
+
+// Checks appending, removing, and reopening of the sketch database, and that the incremental distance update
+// produces the same lower triangle as a naive comparison of all pairs, also after an interrupted update.
+// Reports the time to add new signatures to a larger database compared to the full all-vs-all comparison.
+
+vector<uint64_t> generateSignatures(mt19937_64& rng, uint64_t n, uint32_t m, uint64_t alphabetSize) {
+    vector<uint64_t> signatures(n * m);
+    for(auto& x : signatures) x = rng() % alphabetSize;
+    return signatures;
+}
+
+vector<string> generateNames(uint64_t first, uint64_t n) {
+    vector<string> names;
+    for(uint64_t i = first; i < first + n; ++i) names.push_back("genome_" + to_string(i) + ".fna");
+    return names;
+}
+
+// reads the lower triangle of the distance file
+vector<uint16_t> readDistances(const string& directory) {
+    ifstream in(directory + "/distances.bin", ios::binary);
+    in.seekg(8 + sizeof(uint32_t));
+    vector<uint16_t> values;
+    uint16_t x;
+    while (in.read(reinterpret_cast<char*>(&x), sizeof(uint16_t))) values.push_back(x);
+    return values;
+}
+
+int main(int argc, char* argv[]) {
+
+    const string directory = (argc > 1) ? string(argv[1]) : string("sketch_database_test");
+    filesystem::remove_all(directory);
+    mt19937_64 rng(UINT64_C(0x7d3b915a0ce2f846));
+
+    SketchFileInfo info;
+    info.k = 21;
+    info.m = 50;
+    info.algorithm = "probminhash1";
+    info.seed = 123456789;
+    info.weighted = true;
+    info.hashScheme = "2bit-forward-wyhash64";
+
+    vector<uint64_t> all; // all signatures appended so far
+    const vector<uint64_t> segmentSizes = {1, 40, 7, 123};
+    {
+        SketchDatabase database(directory);
+        assert(database.good() && database.size() == 0 && database.getNumDistanceRows() == 0);
+        assert(database.updateDistances());
+        uint64_t n = 0;
+        for(uint64_t segmentSize : segmentSizes) {
+            const auto signatures = generateSignatures(rng, segmentSize, info.m, 4);
+            assert(database.append(info, generateNames(n, segmentSize), signatures.data()));
+            all.insert(all.end(), signatures.begin(), signatures.end());
+            n += segmentSize;
+            assert(database.size() == n);
+
+            // only the new rows are computed, small batches to test batching
+            const uint64_t first = database.getNumDistanceRows();
+            uint64_t expectedRow = first;
+            assert(database.updateDistances([&](uint64_t i, const uint16_t* counts) {
+                assert(i == expectedRow++);
+                for(uint64_t j = 0; j < i; ++j) assert(counts[j] == countEqualComponents(all.data() + i * info.m, all.data() + j * info.m, info.m));
+            }, 1000));
+            assert(expectedRow == n && database.getNumDistanceRows() == n);
+        }
+        assert(database.remove(3) && database.remove(50) && database.remove(3));
+        assert(!database.remove(database.size()));
+
+        // incompatible parameters
+        SketchFileInfo other = info;
+        other.m = 51;
+        const auto signatures = generateSignatures(rng, 1, other.m, 4);
+        assert(!database.append(other, generateNames(0, 1), signatures.data()));
+    }
+
+    // reopen
+    const uint64_t n = all.size() / info.m;
+    {
+        SketchDatabase database(directory);
+        assert(database.good() && database.size() == n && database.getNumSegments() == segmentSizes.size());
+        assert(database.getInfo().isCompatible(info));
+        assert(database.getNumRemoved() == 2 && database.isRemoved(3) && database.isRemoved(50) && !database.isRemoved(4));
+        for(uint64_t i = 0; i < n; ++i) {
+            assert(equal(database.getSignature(i), database.getSignature(i) + info.m, all.begin() + i * info.m));
+            assert(database.getName(i) == "genome_" + to_string(i) + ".fna");
+        }
+        assert(database.getNumDistanceRows() == n);
+    }
+    vector<uint16_t> expected;
+    for(uint64_t i = 1; i < n; ++i) {
+        for(uint64_t j = 0; j < i; ++j) expected.push_back(countEqualComponents(all.data() + i * info.m, all.data() + j * info.m, info.m));
+    }
+    assert(readDistances(directory) == expected);
+
+    // interrupted update: the incomplete last row is recomputed
+    {
+        const uint64_t numEntries = (n - 1) * (n - 2) / 2 + 5;
+        filesystem::resize_file(directory + "/distances.bin", 8 + sizeof(uint32_t) + numEntries * sizeof(uint16_t));
+        SketchDatabase database(directory);
+        assert(database.getNumDistanceRows() == n - 1);
+        assert(database.updateDistances());
+        assert(readDistances(directory) == expected);
+    }
+    filesystem::remove_all(directory);
+
+    // time of adding new signatures to a larger database
+    {
+        const uint64_t numExisting = 5000;
+        const uint64_t numNew = 100;
+        info.m = 1024;
+        const auto signatures = generateSignatures(rng, numExisting + numNew, info.m, 16);
+        SketchDatabase database(directory);
+        assert(database.append(info, generateNames(0, numExisting), signatures.data()));
+        auto start = chrono::steady_clock::now();
+        assert(database.updateDistances());
+        auto initial = chrono::steady_clock::now();
+        assert(database.append(info, generateNames(numExisting, numNew), signatures.data() + numExisting * info.m));
+        assert(database.updateDistances());
+        auto incremental = chrono::steady_clock::now();
+        cout << "m = " << info.m << ", existing = " << numExisting << ", new = " << numNew;
+        cout << ", initial = " << chrono::duration<double>(initial - start).count() << " s";
+        cout << ", incremental = " << chrono::duration<double>(incremental - initial).count() << " s" << endl;
+    }
+    filesystem::remove_all(directory);
+
+    return 0;
+}
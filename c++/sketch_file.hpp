@@ -0,0 +1,237 @@
+#ifndef _SKETCH_FILE_HPP_
+#define _SKETCH_FILE_HPP_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Versioned binary file of signatures with 64-bit registers, written once and memory-mapped read-only for queries.
+//
+// Layout (all integers in native byte order, files of the other byte order are rejected via byteOrderMark):
+//     offset 0:    header (SketchFileHeader, 192 bytes)
+//     offset 256:  registers of all n signatures one after the other, n * m uint64 values,
+//                  signature i starts at registersOffset + 8 * i * m
+//     namesOffset: n + 1 uint64 offsets relative to the end of this table, followed by the concatenated names,
+//                  name i spans the bytes [offsets[i], offsets[i + 1])
+// The registers start at a multiple of 64 bytes. As mappings start at page boundaries, the registers are cache line
+// aligned in memory, and signatures can be passed directly to the comparison kernels without copying. Mapping the
+// file takes constant time regardless of its size, pages are loaded on first access and shared through the page
+// cache between all processes that map the same file.
+
+static const char SKETCH_FILE_MAGIC[8] = {'P', 'M', 'H', 'S', 'K', 'F', '0', '1'};
+static const uint32_t SKETCH_FILE_VERSION = 1;
+static const uint32_t SKETCH_FILE_BYTE_ORDER_MARK = UINT32_C(0x01020304);
+
+// parameters of the signatures that must match for signatures to be comparable
+struct SketchFileInfo {
+    uint32_t k = 0;              // k-mer length
+    uint32_t m = 0;              // signature size
+    std::string algorithm;       // name of the algorithm, e.g. "probminhash1", at most 31 characters
+    uint64_t seed = 0;           // seed of the random number generator of the algorithm
+    bool weighted = false;       // true if k-mer multiplicities were used as weights
+    bool canonical = false;      // true if k-mers and their reverse complements were identified
+    std::string hashScheme;      // k-mer encoding and hash function, at most 31 characters
+
+    bool isCompatible(const SketchFileInfo& other) const {
+        return k == other.k && m == other.m && algorithm == other.algorithm && seed == other.seed && weighted == other.weighted
+            && canonical == other.canonical && hashScheme == other.hashScheme;
+    }
+};
+
+struct SketchFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t k;
+    uint32_t m;
+    uint64_t seed;
+    uint8_t weighted;
+    uint8_t canonical;
+    uint8_t reserved[6];
+    char algorithm[32];
+    char hashScheme[32];
+    uint64_t numSignatures;
+    uint64_t registersOffset;
+    uint64_t namesOffset;
+    uint64_t fileSize;
+    uint8_t padding[56];
+};
+
+static_assert(sizeof(SketchFileHeader) == 192, "Unexpected size of SketchFileHeader!");
+
+namespace sketch_file {
+
+static const uint64_t REGISTERS_OFFSET = 256;
+
+inline void copyName(char (&destination)[32], const std::string& source) {
+    std::memset(destination, 0, sizeof(destination));
+    std::memcpy(destination, source.data(), std::min(source.size(), sizeof(destination) - 1));
+}
+
+} // namespace sketch_file
+
+// Writes n signatures of size info.m stored contiguously (signature i starts at registers + i * info.m) with their names.
+// Returns false if the file could not be written.
+inline bool writeSketchFile(const std::string& fileName, const SketchFileInfo& info, const std::vector<std::string>& names, const uint64_t* registers) {
+    if (info.algorithm.size() >= 32 || info.hashScheme.size() >= 32) return false;
+    const uint64_t n = names.size();
+    SketchFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SKETCH_FILE_MAGIC, 8);
+    header.version = SKETCH_FILE_VERSION;
+    header.byteOrderMark = SKETCH_FILE_BYTE_ORDER_MARK;
+    header.k = info.k;
+    header.m = info.m;
+    header.seed = info.seed;
+    header.weighted = info.weighted;
+    header.canonical = info.canonical;
+    sketch_file::copyName(header.algorithm, info.algorithm);
+    sketch_file::copyName(header.hashScheme, info.hashScheme);
+    header.numSignatures = n;
+    header.registersOffset = sketch_file::REGISTERS_OFFSET;
+    header.namesOffset = header.registersOffset + n * info.m * sizeof(uint64_t);
+
+    std::vector<uint64_t> nameOffsets(n + 1, 0);
+    for(uint64_t i = 0; i < n; ++i) nameOffsets[i + 1] = nameOffsets[i] + names[i].size();
+    header.fileSize = header.namesOffset + nameOffsets.size() * sizeof(uint64_t) + nameOffsets.back();
+
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const std::vector<char> padding(header.registersOffset - sizeof(header), 0);
+    out.write(padding.data(), padding.size());
+    out.write(reinterpret_cast<const char*>(registers), n * info.m * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(nameOffsets.data()), nameOffsets.size() * sizeof(uint64_t));
+    for(const auto& name : names) out.write(name.data(), name.size());
+    out.close();
+    return out.good();
+}
+
+// Read-only memory mapping of a sketch file. The file is validated when opened, good() returns false and getError()
+// describes the problem if it could not be mapped or is not a valid sketch file.
+class MappedSketchFile {
+    void* address = MAP_FAILED;
+    uint64_t mappedSize = 0;
+    const SketchFileHeader* header = nullptr;
+    const uint64_t* nameOffsets = nullptr;
+    const char* nameData = nullptr;
+    SketchFileInfo info;
+    std::string error;
+
+    void close() {
+        if (address != MAP_FAILED) munmap(address, mappedSize);
+        address = MAP_FAILED;
+        header = nullptr;
+    }
+
+    bool fail(const std::string& message) {
+        close();
+        error = message;
+        return false;
+    }
+
+    bool open(const std::string& fileName) {
+        const int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) return fail("cannot open " + fileName);
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<uint64_t>(status.st_size) < sizeof(SketchFileHeader)) {
+            ::close(fd);
+            return fail(fileName + " is too small for a sketch file");
+        }
+        mappedSize = status.st_size;
+        address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) return fail("cannot map " + fileName);
+
+        header = static_cast<const SketchFileHeader*>(address);
+        if (std::memcmp(header->magic, SKETCH_FILE_MAGIC, 8) != 0) return fail(fileName + " is not a sketch file");
+        if (header->byteOrderMark != SKETCH_FILE_BYTE_ORDER_MARK) return fail(fileName + " has a different byte order");
+        if (header->version != SKETCH_FILE_VERSION) return fail(fileName + " has unsupported version " + std::to_string(header->version));
+        const uint64_t n = header->numSignatures;
+        if (n >= mappedSize / sizeof(uint64_t) || (header->m > 0 && n > mappedSize / sizeof(uint64_t) / header->m)) return fail(fileName + " is truncated or corrupt");
+        // sizes are compared with the remaining bytes of the file, such that no sum of values from the file can wrap around
+        if (header->fileSize != mappedSize || header->registersOffset % 64 != 0 || header->registersOffset < sizeof(SketchFileHeader)
+                || header->registersOffset > mappedSize || n * header->m * sizeof(uint64_t) > mappedSize - header->registersOffset
+                || header->namesOffset != header->registersOffset + n * header->m * sizeof(uint64_t)
+                || (n + 1) * sizeof(uint64_t) > mappedSize - header->namesOffset) {
+            return fail(fileName + " is truncated or corrupt");
+        }
+        nameOffsets = reinterpret_cast<const uint64_t*>(static_cast<const char*>(address) + header->namesOffset);
+        nameData = reinterpret_cast<const char*>(nameOffsets + n + 1);
+        const uint64_t namesSize = mappedSize - header->namesOffset - (n + 1) * sizeof(uint64_t);
+        if (nameOffsets[0] != 0 || nameOffsets[n] != namesSize) {
+            return fail(fileName + " is truncated or corrupt");
+        }
+        // getName relies on monotone offsets, which then all lie within the names
+        for(uint64_t i = 0; i < n; ++i) {
+            if (nameOffsets[i] > nameOffsets[i + 1]) return fail(fileName + " is truncated or corrupt");
+        }
+
+        info.k = header->k;
+        info.m = header->m;
+        info.algorithm = std::string(header->algorithm, strnlen(header->algorithm, sizeof(header->algorithm)));
+        info.seed = header->seed;
+        info.weighted = header->weighted;
+        info.canonical = header->canonical;
+        info.hashScheme = std::string(header->hashScheme, strnlen(header->hashScheme, sizeof(header->hashScheme)));
+        return true;
+    }
+
+public:
+
+    explicit MappedSketchFile(const std::string& fileName) {
+        open(fileName);
+    }
+
+    MappedSketchFile(const MappedSketchFile&) = delete;
+    MappedSketchFile& operator=(const MappedSketchFile&) = delete;
+
+    ~MappedSketchFile() {
+        close();
+    }
+
+    bool good() const {
+        return header != nullptr;
+    }
+
+    const std::string& getError() const {
+        return error;
+    }
+
+    const SketchFileInfo& getInfo() const {
+        return info;
+    }
+
+    uint64_t size() const {
+        return header->numSignatures;
+    }
+
+    // all registers, signature i starts at getRegisters() + i * getInfo().m
+    const uint64_t* getRegisters() const {
+        return reinterpret_cast<const uint64_t*>(static_cast<const char*>(address) + header->registersOffset);
+    }
+
+    const uint64_t* getSignature(uint64_t i) const {
+        return getRegisters() + i * header->m;
+    }
+
+    std::string getName(uint64_t i) const {
+        return std::string(nameData + nameOffsets[i], nameData + nameOffsets[i + 1]);
+    }
+
+    std::vector<std::string> getNames() const {
+        std::vector<std::string> names;
+        names.reserve(size());
+        for(uint64_t i = 0; i < size(); ++i) names.push_back(getName(i));
+        return names;
+    }
+};
+
+#endif // _SKETCH_FILE_HPP_
@@ -0,0 +1,144 @@
+#include "sketch_file.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cassert>
+#include <iterator>
+
+using namespace std;
+
+// Writes sketch files, checks that the mapped signatures, names and parameters are the same, that invalid files are
+// rejected, and reports the time to write and to map a database of many signatures.
+
+int main(int argc, char* argv[]) {
+
+    const string fileName = (argc > 1) ? string(argv[1]) : string("sketch_file_test.pmh");
+    mt19937_64 rng(UINT64_C(0x2c6f0a9d53e8b174));
+
+    SketchFileInfo info;
+    info.k = 21;
+    info.m = 100;
+    info.algorithm = "probminhash1";
+    info.seed = UINT64_C(123456789);
+    info.weighted = true;
+    info.canonical = false;
+    info.hashScheme = "2bit-forward-wyhash64";
+
+    for(uint64_t n : {0, 1, 17}) {
+        vector<uint64_t> signatures(n * info.m);
+        for(auto& x : signatures) x = rng();
+        vector<string> names;
+        for(uint64_t i = 0; i < n; ++i) names.push_back("genome_" + to_string(i) + string(i % 3, 'x'));
+        if (n > 0) names[0] = ""; // empty names are allowed
+        assert(writeSketchFile(fileName, info, names, signatures.data()));
+
+        MappedSketchFile file(fileName);
+        assert(file.good());
+        assert(file.getInfo().isCompatible(info));
+        assert(file.getInfo().algorithm == info.algorithm && file.getInfo().hashScheme == info.hashScheme);
+        assert(file.size() == n);
+        assert(file.getNames() == names);
+        for(uint64_t i = 0; i < n; ++i) {
+            assert(equal(file.getSignature(i), file.getSignature(i) + info.m, signatures.begin() + i * info.m));
+        }
+        assert(reinterpret_cast<uintptr_t>(file.getRegisters()) % 64 == 0);
+    }
+
+    // incompatible parameters
+    {
+        SketchFileInfo other = info;
+        other.seed += 1;
+        assert(!other.isCompatible(info));
+        other = info;
+        other.weighted = false;
+        assert(!other.isCompatible(info));
+    }
+
+    // invalid files
+    {
+        vector<uint64_t> signatures(5 * info.m, 7);
+        const vector<string> names = {"a", "b", "c", "d", "e"};
+        assert(writeSketchFile(fileName, info, names, signatures.data()));
+        vector<char> content;
+        {
+            ifstream in(fileName, ios::binary);
+            content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        auto writeContent = [&](const vector<char>& c) {
+            ofstream out(fileName, ios::binary | ios::trunc);
+            out.write(c.data(), c.size());
+        };
+        // truncated
+        writeContent(vector<char>(content.begin(), content.end() - 1));
+        assert(!MappedSketchFile(fileName).good());
+        // wrong magic
+        vector<char> modified = content;
+        modified[0] = 'X';
+        writeContent(modified);
+        assert(!MappedSketchFile(fileName).good());
+        // unsupported version
+        modified = content;
+        modified[8] = 2;
+        writeContent(modified);
+        assert(!MappedSketchFile(fileName).good());
+        assert(MappedSketchFile(fileName).getError().find("version") != string::npos);
+        // name offsets out of order, the table of 6 offsets precedes the 5 one-byte names at the end
+        modified = content;
+        const uint64_t nameOffset = 100;
+        memcpy(&modified[content.size() - 5 - 6 * sizeof(uint64_t) + 2 * sizeof(uint64_t)], &nameOffset, sizeof(uint64_t));
+        writeContent(modified);
+        assert(!MappedSketchFile(fileName).good());
+        // last name offset such that the end of the names wraps around
+        modified = content;
+        const uint64_t lastNameOffset = UINT64_C(0) - 8;
+        memcpy(&modified[content.size() - 5 - sizeof(uint64_t)], &lastNameOffset, sizeof(uint64_t));
+        writeContent(modified);
+        assert(!MappedSketchFile(fileName).good());
+        // offset of the registers beyond the end of the file, such that the offset of the names wraps around
+        modified = content;
+        const uint64_t registersOffset = UINT64_C(0) - 64;
+        const uint64_t namesOffset = registersOffset + 5 * info.m * sizeof(uint64_t);
+        memcpy(&modified[offsetof(SketchFileHeader, registersOffset)], &registersOffset, sizeof(uint64_t));
+        memcpy(&modified[offsetof(SketchFileHeader, namesOffset)], &namesOffset, sizeof(uint64_t));
+        writeContent(modified);
+        assert(!MappedSketchFile(fileName).good());
+        // too long algorithm name
+        SketchFileInfo invalid = info;
+        invalid.algorithm = string(32, 'a');
+        assert(!writeSketchFile(fileName, invalid, names, signatures.data()));
+        assert(!MappedSketchFile(fileName + ".missing").good());
+    }
+
+    // time to write and to map a database of 100000 signatures
+    {
+        const uint64_t n = 100000;
+        info.m = 128;
+        vector<uint64_t> signatures(n * info.m);
+        for(auto& x : signatures) x = rng();
+        vector<string> names(n);
+        for(uint64_t i = 0; i < n; ++i) names[i] = "genomes/GCF_" + to_string(i) + ".fna";
+        auto start = chrono::steady_clock::now();
+        assert(writeSketchFile(fileName, info, names, signatures.data()));
+        auto written = chrono::steady_clock::now();
+        MappedSketchFile file(fileName);
+        assert(file.good() && file.size() == n);
+        auto mapped = chrono::steady_clock::now();
+        uint64_t checksum = 0;
+        for(uint64_t i = 0; i < n * info.m; ++i) checksum += file.getRegisters()[i];
+        auto scanned = chrono::steady_clock::now();
+        uint64_t expected = 0;
+        for(uint64_t x : signatures) expected += x;
+        assert(checksum == expected);
+        cout << "n = " << n << ", m = " << info.m << ", write = " << chrono::duration<double>(written - start).count() << " s";
+        cout << ", map = " << chrono::duration<double>(mapped - written).count() << " s";
+        cout << ", first scan = " << chrono::duration<double>(scanned - mapped).count() << " s" << endl;
+    }
+    remove(fileName.c_str());
+
+    return 0;
+}
@@ -60,7 +60,8 @@ def drawChart(ax, data, hashSize, mode, isLastRow, isFirstCol):
     else:
         assert(False)
 
-    assert(sorted(algorithms) == sorted(sortedAlgorithms))
+    # variants like "ProbMinHash2 (FixedSize)" are not shown in the chart
+    assert(set(sortedAlgorithms) <= set(algorithms))
 
     algorithms = sortedAlgorithms
 
@@ -68,7 +69,7 @@ def drawChart(ax, data, hashSize, mode, isLastRow, isFirstCol):
     dataSizes.sort()
 
     for k in r.keys():
-        assert(len(r[k]) == len(algorithms))
+        assert(all(algorithm in r[k] for algorithm in algorithms))
 
     ax.set_xscale("log", basex=10)
     ax.set_yscale("log", basey=10)